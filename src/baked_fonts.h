@@ -0,0 +1,34 @@
+#ifndef BAKED_FONTS_H
+#define BAKED_FONTS_H
+
+#include <stddef.h>
+
+#ifdef _WIN32
+#include <SDL.h>
+#else
+#include <SDL2/SDL.h>
+#endif
+
+#include "keysyms.h"
+#include "label_cache.h"
+
+// Generated at build time by tools/bake_fonts.c (build/baked_fonts.c), so
+// the binary finds its fonts from any directory and starts without reading
+// or measuring them.
+
+// The font files, embedded byte for byte
+extern const unsigned char bakedKeyFontData[];
+extern const size_t bakedKeyFontLength;
+extern const unsigned char bakedButtonFontData[];
+extern const size_t bakedButtonFontLength;
+
+// Every key label, cap glyph and the button text, rasterized and measured
+// at one output scale. Image entries use font 0 for the key font and 1 for
+// the button font.
+#define BAKED_FONT_KEY 0
+#define BAKED_FONT_BUTTON 1
+extern const int bakedScaleSteps;
+extern const KeyFontMetrics bakedKeyMetrics;
+extern const LabelAtlasImage bakedLabels;
+
+#endif
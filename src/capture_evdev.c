@@ -0,0 +1,603 @@
+#ifdef __linux__
+
+#define _GNU_SOURCE
+
+#include "capture_evdev.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/input.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/ioctl.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <SDL2/SDL.h>
+
+#define EVDEV_DIR "/dev/input"
+#define EVDEV_MAX_DEVICES 32
+#define EVDEV_READ_BATCH 64
+#define EVDEV_MAX_REPLAY_GAP_MS 1000 // Cap idle gaps when replaying a file
+
+// epoll user data tags for the non-device descriptors
+#define TAG_STOP -1
+#define TAG_INOTIFY -2
+
+typedef struct {
+  int fd;
+  char path[64];
+  bool keyboard; // Otherwise a mouse
+} EvdevDevice;
+
+static EvdevDevice devices[EVDEV_MAX_DEVICES];
+static int epollFd = -1;
+static int inotifyFd = -1;
+static int stopFd = -1;
+static pthread_t inputThread;
+static bool threadRunning = false;
+static char replayFile[512];
+static KeyRing *eventRing = NULL;
+static MouseAggregator *mouseAggregator = NULL; // NULL when mice are ignored
+static bool foundKeyboards = false; // Set by the scan before the thread runs
+
+// KEY_* code to key symbol; codes left out map to KSYM_UNKNOWN
+static const KeySymbol evdevKeyMap[KEY_MAX + 1] = {
+    [KEY_ESC] = KSYM_ESC,
+    [KEY_1] = KSYM_1,
+    [KEY_2] = KSYM_2,
+    [KEY_3] = KSYM_3,
+    [KEY_4] = KSYM_4,
+    [KEY_5] = KSYM_5,
+    [KEY_6] = KSYM_6,
+    [KEY_7] = KSYM_7,
+    [KEY_8] = KSYM_8,
+    [KEY_9] = KSYM_9,
+    [KEY_0] = KSYM_0,
+    [KEY_MINUS] = KSYM_MINUS,
+    [KEY_EQUAL] = KSYM_EQUAL,
+    [KEY_BACKSPACE] = KSYM_BACKSPACE,
+    [KEY_TAB] = KSYM_TAB,
+    [KEY_Q] = KSYM_Q,
+    [KEY_W] = KSYM_W,
+    [KEY_E] = KSYM_E,
+    [KEY_R] = KSYM_R,
+    [KEY_T] = KSYM_T,
+    [KEY_Y] = KSYM_Y,
+    [KEY_U] = KSYM_U,
+    [KEY_I] = KSYM_I,
+    [KEY_O] = KSYM_O,
+    [KEY_P] = KSYM_P,
+    [KEY_LEFTBRACE] = KSYM_LEFT_BRACKET,
+    [KEY_RIGHTBRACE] = KSYM_RIGHT_BRACKET,
+    [KEY_ENTER] = KSYM_RETURN,
+    [KEY_LEFTCTRL] = KSYM_CTRL,
+    [KEY_A] = KSYM_A,
+    [KEY_S] = KSYM_S,
+    [KEY_D] = KSYM_D,
+    [KEY_F] = KSYM_F,
+    [KEY_G] = KSYM_G,
+    [KEY_H] = KSYM_H,
+    [KEY_J] = KSYM_J,
+    [KEY_K] = KSYM_K,
+    [KEY_L] = KSYM_L,
+    [KEY_SEMICOLON] = KSYM_SEMICOLON,
+    [KEY_APOSTROPHE] = KSYM_APOSTROPHE,
+    [KEY_GRAVE] = KSYM_GRAVE,
+    [KEY_LEFTSHIFT] = KSYM_SHIFT,
+    [KEY_BACKSLASH] = KSYM_BACKSLASH,
+    [KEY_Z] = KSYM_Z,
+    [KEY_X] = KSYM_X,
+    [KEY_C] = KSYM_C,
+    [KEY_V] = KSYM_V,
+    [KEY_B] = KSYM_B,
+    [KEY_N] = KSYM_N,
+    [KEY_M] = KSYM_M,
+    [KEY_COMMA] = KSYM_COMMA,
+    [KEY_DOT] = KSYM_PERIOD,
+    [KEY_SLASH] = KSYM_SLASH,
+    [KEY_RIGHTSHIFT] = KSYM_SHIFT,
+    [KEY_KPASTERISK] = KSYM_ASTERISK,
+    [KEY_LEFTALT] = KSYM_ALT,
+    [KEY_SPACE] = KSYM_SPACE,
+    [KEY_CAPSLOCK] = KSYM_CAPS,
+    [KEY_F1] = KSYM_F1,
+    [KEY_F2] = KSYM_F2,
+    [KEY_F3] = KSYM_F3,
+    [KEY_F4] = KSYM_F4,
+    [KEY_F5] = KSYM_F5,
+    [KEY_F6] = KSYM_F6,
+    [KEY_F7] = KSYM_F7,
+    [KEY_F8] = KSYM_F8,
+    [KEY_F9] = KSYM_F9,
+    [KEY_F10] = KSYM_F10,
+    [KEY_NUMLOCK] = KSYM_NUM_LOCK,
+    [KEY_SCROLLLOCK] = KSYM_SCROLL_LOCK,
+    [KEY_KP7] = KSYM_7,
+    [KEY_KP8] = KSYM_8,
+    [KEY_KP9] = KSYM_9,
+    [KEY_KPMINUS] = KSYM_MINUS,
+    [KEY_KP4] = KSYM_4,
+    [KEY_KP5] = KSYM_5,
+    [KEY_KP6] = KSYM_6,
+    [KEY_KPPLUS] = KSYM_PLUS,
+    [KEY_KP1] = KSYM_1,
+    [KEY_KP2] = KSYM_2,
+    [KEY_KP3] = KSYM_3,
+    [KEY_KP0] = KSYM_0,
+    [KEY_KPDOT] = KSYM_PERIOD,
+    [KEY_102ND] = KSYM_BACKSLASH,
+    [KEY_F11] = KSYM_F11,
+    [KEY_F12] = KSYM_F12,
+    [KEY_F13] = KSYM_F13,
+    [KEY_F14] = KSYM_F14,
+    [KEY_F15] = KSYM_F15,
+    [KEY_F16] = KSYM_F16,
+    [KEY_F17] = KSYM_F17,
+    [KEY_F18] = KSYM_F18,
+    [KEY_F19] = KSYM_F19,
+    [KEY_F20] = KSYM_F20,
+    [KEY_F21] = KSYM_F21,
+    [KEY_F22] = KSYM_F22,
+    [KEY_F23] = KSYM_F23,
+    [KEY_F24] = KSYM_F24,
+    [KEY_KPENTER] = KSYM_RETURN,
+    [KEY_RIGHTCTRL] = KSYM_CTRL,
+    [KEY_KPSLASH] = KSYM_SLASH,
+    [KEY_SYSRQ] = KSYM_PRINT,
+    [KEY_RIGHTALT] = KSYM_ALT,
+    [KEY_HOME] = KSYM_HOME,
+    [KEY_UP] = KSYM_UP,
+    [KEY_PAGEUP] = KSYM_PAGE_UP,
+    [KEY_LEFT] = KSYM_LEFT,
+    [KEY_RIGHT] = KSYM_RIGHT,
+    [KEY_END] = KSYM_END,
+    [KEY_DOWN] = KSYM_DOWN,
+    [KEY_PAGEDOWN] = KSYM_PAGE_DOWN,
+    [KEY_INSERT] = KSYM_INSERT,
+    [KEY_DELETE] = KSYM_DELETE,
+    [KEY_KPEQUAL] = KSYM_EQUAL,
+    [KEY_PAUSE] = KSYM_PAUSE,
+    [KEY_LEFTMETA] = KSYM_SUPER,
+    [KEY_RIGHTMETA] = KSYM_SUPER,
+    [KEY_COMPOSE] = KSYM_MENU,
+};
+
+KeySymbol getEvdevKeySymbol(int code) {
+  if (code < 0 || code > KEY_MAX) {
+    return KSYM_UNKNOWN;
+  }
+  return evdevKeyMap[code];
+}
+
+// Queue the key for the render thread, same as the other platform hooks
+static void pushKeyEvent(KeySymbol symbol, Uint16 flags, Uint64 ageNs) {
+  KeyEvent event;
+  keyEventInit(&event, symbol, flags);
+  keyEventSetCaptureAge(&event, ageNs);
+  keyRingPush(eventRing, &event);
+}
+
+// How long ago the kernel stamped an event from a device switched to
+// CLOCK_MONOTONIC in openDevice()
+static Uint64 eventAge(const struct input_event *ev) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  Sint64 ageNs =
+      ((Sint64)now.tv_sec - (Sint64)ev->input_event_sec) * 1000000000 +
+      ((Sint64)now.tv_nsec - (Sint64)ev->input_event_usec * 1000);
+  return ageNs > 0 ? (Uint64)ageNs : 0;
+}
+
+// BTN_* code to key symbol, or KSYM_UNKNOWN for buttons that are not shown
+static KeySymbol getEvdevButtonSymbol(int code) {
+  switch (code) {
+  case BTN_LEFT:
+    return KSYM_MOUSE_LEFT;
+  case BTN_RIGHT:
+    return KSYM_MOUSE_RIGHT;
+  case BTN_MIDDLE:
+    return KSYM_MOUSE_MIDDLE;
+  case BTN_SIDE:
+  case BTN_BACK:
+    return KSYM_MOUSE_BACK;
+  case BTN_EXTRA:
+  case BTN_FORWARD:
+    return KSYM_MOUSE_FORWARD;
+  default:
+    return KSYM_UNKNOWN;
+  }
+}
+
+// Wheel steps; the REL_*_HI_RES events sent alongside are left out so each
+// detent counts once
+static void handleWheelEvent(const struct input_event *ev, Uint64 ageNs) {
+  if (ev->value == 0) {
+    return;
+  }
+  int steps = ev->value > 0 ? ev->value : -ev->value;
+  if (ev->code == REL_WHEEL) {
+    mouseAggregatorAdd(mouseAggregator,
+                       ev->value > 0 ? KSYM_WHEEL_UP : KSYM_WHEEL_DOWN, steps,
+                       ageNs);
+  } else if (ev->code == REL_HWHEEL) {
+    mouseAggregatorAdd(mouseAggregator,
+                       ev->value > 0 ? KSYM_WHEEL_RIGHT : KSYM_WHEEL_LEFT,
+                       steps, ageNs);
+  }
+}
+
+static void handleInputEvent(const struct input_event *ev, Uint64 ageNs) {
+  if (ev->type == EV_REL) {
+    if (mouseAggregator) {
+      handleWheelEvent(ev, ageNs);
+    }
+    return;
+  }
+
+  // value 1 is a press and 2 an auto-repeat, like WM_KEYDOWN and
+  // kCGEventKeyDown; releases (0) are ignored
+  if (ev->type != EV_KEY || ev->value == 0) {
+    return;
+  }
+
+  // Mouse, joystick and touchpad buttons sit between the keys; only mouse
+  // button presses are shown, so a touchpad touch is not a "?" key
+  if (ev->code >= BTN_MISC && ev->code < KEY_OK) {
+    KeySymbol symbol = getEvdevButtonSymbol(ev->code);
+    if (mouseAggregator && ev->value == 1 && symbol != KSYM_UNKNOWN) {
+      mouseAggregatorAdd(mouseAggregator, symbol, 1, ageNs);
+    }
+    return;
+  }
+
+  Uint16 flags = ev->value == 2 ? KEY_EVENT_REPEAT : 0;
+  pushKeyEvent(getEvdevKeySymbol(ev->code), flags, ageNs);
+}
+
+static bool testBit(const unsigned long *bits, int bit) {
+  int width = 8 * sizeof(unsigned long);
+  return (bits[bit / width] >> (bit % width)) & 1;
+}
+
+// A device counts as a keyboard if it reports letter keys and space
+static bool isKeyboard(int fd) {
+  unsigned long evBits[(EV_MAX + 8 * sizeof(unsigned long)) /
+                       (8 * sizeof(unsigned long))] = {0};
+  unsigned long keyBits[(KEY_MAX + 8 * sizeof(unsigned long)) /
+                        (8 * sizeof(unsigned long))] = {0};
+  if (ioctl(fd, EVIOCGBIT(0, sizeof(evBits)), evBits) < 0 ||
+      !testBit(evBits, EV_KEY)) {
+    return false;
+  }
+  if (ioctl(fd, EVIOCGBIT(EV_KEY, sizeof(keyBits)), keyBits) < 0) {
+    return false;
+  }
+  return testBit(keyBits, KEY_A) && testBit(keyBits, KEY_Z) &&
+         testBit(keyBits, KEY_SPACE);
+}
+
+// A device counts as a mouse if it has a left button, which touchpads
+// report their clicks with as well
+static bool isMouse(int fd) {
+  unsigned long keyBits[(KEY_MAX + 8 * sizeof(unsigned long)) /
+                        (8 * sizeof(unsigned long))] = {0};
+  if (ioctl(fd, EVIOCGBIT(EV_KEY, sizeof(keyBits)), keyBits) < 0) {
+    return false;
+  }
+  return testBit(keyBits, BTN_LEFT);
+}
+
+static int findDevice(const char *path) {
+  for (int i = 0; i < EVDEV_MAX_DEVICES; i++) {
+    if (devices[i].fd >= 0 && strcmp(devices[i].path, path) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+static void closeDevice(int slot) {
+  epoll_ctl(epollFd, EPOLL_CTL_DEL, devices[slot].fd, NULL);
+  close(devices[slot].fd);
+  printf("%s removed: %s\n", devices[slot].keyboard ? "Keyboard" : "Mouse",
+         devices[slot].path);
+  devices[slot].fd = -1;
+  devices[slot].path[0] = '\0';
+}
+
+static void openDevice(const char *name) {
+  if (strncmp(name, "event", 5) != 0) {
+    return;
+  }
+
+  char path[64];
+  snprintf(path, sizeof(path), "%s/%s", EVDEV_DIR, name);
+  if (findDevice(path) >= 0) {
+    return;
+  }
+
+  int slot = -1;
+  for (int i = 0; i < EVDEV_MAX_DEVICES; i++) {
+    if (devices[i].fd < 0) {
+      slot = i;
+      break;
+    }
+  }
+  if (slot < 0) {
+    return;
+  }
+
+  int fd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+  if (fd < 0) {
+    // Usually EACCES: the user is not in the input group
+    if (errno == EACCES) {
+      printf("No permission to read %s (try adding yourself to the 'input' "
+             "group).\n",
+             path);
+    }
+    return;
+  }
+  bool keyboard = isKeyboard(fd);
+  if (!keyboard && !(mouseAggregator && isMouse(fd))) {
+    close(fd);
+    return;
+  }
+
+  // Stamp events on the monotonic clock so their age can be measured
+  int clockId = CLOCK_MONOTONIC;
+  ioctl(fd, EVIOCSCLOCKID, &clockId);
+
+  struct epoll_event ev = {0};
+  ev.events = EPOLLIN;
+  ev.data.u32 = (uint32_t)slot;
+  if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+    close(fd);
+    return;
+  }
+
+  devices[slot].fd = fd;
+  snprintf(devices[slot].path, sizeof(devices[slot].path), "%s", path);
+  devices[slot].keyboard = keyboard;
+
+  char deviceName[128] = "unknown";
+  ioctl(fd, EVIOCGNAME(sizeof(deviceName)), deviceName);
+  printf("%s added: %s (%s)\n", keyboard ? "Keyboard" : "Mouse", path,
+         deviceName);
+}
+
+static void scanDevices(void) {
+  DIR *dir = opendir(EVDEV_DIR);
+  if (!dir) {
+    return;
+  }
+  struct dirent *entry;
+  while ((entry = readdir(dir)) != NULL) {
+    openDevice(entry->d_name);
+  }
+  closedir(dir);
+}
+
+static void readDevice(int slot) {
+  struct input_event events[EVDEV_READ_BATCH];
+  for (;;) {
+    ssize_t bytes = read(devices[slot].fd, events, sizeof(events));
+    if (bytes < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno != EAGAIN) {
+        // ENODEV: the device was unplugged
+        closeDevice(slot);
+      }
+      return;
+    }
+    if (bytes == 0) {
+      closeDevice(slot);
+      return;
+    }
+    int count = (int)(bytes / sizeof(struct input_event));
+    for (int i = 0; i < count; i++) {
+      handleInputEvent(&events[i], eventAge(&events[i]));
+    }
+  }
+}
+
+static void readHotplug(void) {
+  char buffer[4096]
+      __attribute__((aligned(__alignof__(struct inotify_event))));
+  for (;;) {
+    ssize_t bytes = read(inotifyFd, buffer, sizeof(buffer));
+    if (bytes <= 0) {
+      return;
+    }
+    for (char *p = buffer; p < buffer + bytes;) {
+      const struct inotify_event *event = (const struct inotify_event *)p;
+      if (event->len > 0) {
+        if (event->mask & (IN_CREATE | IN_ATTRIB)) {
+          // udev fixes up permissions after creating the node, so retry on
+          // attribute changes as well
+          openDevice(event->name);
+        } else if (event->mask & IN_DELETE) {
+          char path[64];
+          snprintf(path, sizeof(path), "%s/%s", EVDEV_DIR, event->name);
+          int slot = findDevice(path);
+          if (slot >= 0) {
+            closeDevice(slot);
+          }
+        }
+      }
+      p += sizeof(struct inotify_event) + event->len;
+    }
+  }
+}
+
+static void *deviceThread(void *param) {
+  struct epoll_event events[EVDEV_MAX_DEVICES + 2];
+  for (;;) {
+    // Wake up when folded mouse input is due as well as for device input
+    int timeout = mouseAggregator ? mouseAggregatorFlush(mouseAggregator) : -1;
+    int count = epoll_wait(epollFd, events, EVDEV_MAX_DEVICES + 2, timeout);
+    if (count < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+    for (int i = 0; i < count; i++) {
+      int tag = (int)events[i].data.u32;
+      if (tag == TAG_STOP) {
+        return NULL;
+      } else if (tag == TAG_INOTIFY) {
+        readHotplug();
+      } else if (devices[tag].fd >= 0) {
+        readDevice(tag);
+      }
+    }
+  }
+  return NULL;
+}
+
+// Sleep for ms unless stopped first, pushing folded mouse input as it falls
+// due. Returns whether the thread was asked to stop.
+static bool waitForStop(long ms) {
+  Uint32 start = SDL_GetTicks();
+  for (;;) {
+    int flushIn = mouseAggregator ? mouseAggregatorFlush(mouseAggregator) : -1;
+    long remaining = ms - (long)(SDL_GetTicks() - start);
+    if (remaining <= 0) {
+      return false;
+    }
+    long wait = flushIn >= 0 && flushIn < remaining ? flushIn : remaining;
+    struct epoll_event event;
+    if (epoll_wait(epollFd, &event, 1, (int)wait) > 0 &&
+        (int)event.data.u32 == TAG_STOP) {
+      return true;
+    }
+  }
+}
+
+// Feed recorded input_event structs with their original spacing
+static void *replayThread(void *param) {
+  FILE *file = fopen(replayFile, "rb");
+  if (!file) {
+    printf("Failed to open evdev replay file %s\n", replayFile);
+    return NULL;
+  }
+
+  struct input_event ev;
+  long long previousUs = -1;
+  while (fread(&ev, sizeof(ev), 1, file) == 1) {
+    long long us = (long long)ev.input_event_sec * 1000000LL +
+                   (long long)ev.input_event_usec;
+    if (previousUs >= 0 && us > previousUs) {
+      long long gapMs = (us - previousUs) / 1000;
+      if (gapMs > EVDEV_MAX_REPLAY_GAP_MS) {
+        gapMs = EVDEV_MAX_REPLAY_GAP_MS;
+      }
+      if (gapMs > 0 && waitForStop((long)gapMs)) {
+        break;
+      }
+    }
+    previousUs = us;
+    // Recorded times come from another boot; the replay itself is the capture
+    handleInputEvent(&ev, 0);
+  }
+
+  // Let the last folded clicks and wheel steps through
+  if (mouseAggregator) {
+    waitForStop(mouseAggregator->periodMs);
+  }
+
+  fclose(file);
+  printf("Evdev replay finished.\n");
+  return NULL;
+}
+
+bool evdevCaptureStart(KeyRing *ring, const char *replayPath,
+                       MouseAggregator *mouse) {
+  eventRing = ring;
+  mouseAggregator = mouse;
+  for (int i = 0; i < EVDEV_MAX_DEVICES; i++) {
+    devices[i].fd = -1;
+  }
+
+  epollFd = epoll_create1(EPOLL_CLOEXEC);
+  stopFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (epollFd < 0 || stopFd < 0) {
+    printf("Failed to set up epoll for evdev capture.\n");
+    return false;
+  }
+
+  struct epoll_event ev = {0};
+  ev.events = EPOLLIN;
+  ev.data.u32 = (uint32_t)TAG_STOP;
+  epoll_ctl(epollFd, EPOLL_CTL_ADD, stopFd, &ev);
+
+  void *(*threadMain)(void *) = deviceThread;
+  if (replayPath) {
+    snprintf(replayFile, sizeof(replayFile), "%s", replayPath);
+    threadMain = replayThread;
+  } else {
+    // Watch for keyboards and mice being plugged in or removed
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd >= 0 &&
+        inotify_add_watch(inotifyFd, EVDEV_DIR,
+                          IN_CREATE | IN_DELETE | IN_ATTRIB) >= 0) {
+      ev.data.u32 = (uint32_t)TAG_INOTIFY;
+      epoll_ctl(epollFd, EPOLL_CTL_ADD, inotifyFd, &ev);
+    }
+    scanDevices();
+    for (int i = 0; i < EVDEV_MAX_DEVICES; i++) {
+      if (devices[i].fd >= 0 && devices[i].keyboard) {
+        foundKeyboards = true;
+      }
+    }
+  }
+
+  if (pthread_create(&inputThread, NULL, threadMain, NULL) != 0) {
+    printf("Failed to start evdev input thread.\n");
+    return false;
+  }
+  threadRunning = true;
+  return true;
+}
+
+bool evdevCaptureFoundKeyboards(void) {
+  return foundKeyboards;
+}
+
+void evdevCaptureStop(void) {
+  if (threadRunning) {
+    uint64_t one = 1;
+    if (write(stopFd, &one, sizeof(one)) == sizeof(one)) {
+      pthread_join(inputThread, NULL);
+    }
+    threadRunning = false;
+  }
+  for (int i = 0; i < EVDEV_MAX_DEVICES; i++) {
+    if (devices[i].fd >= 0) {
+      close(devices[i].fd);
+      devices[i].fd = -1;
+    }
+  }
+  if (inotifyFd >= 0) {
+    close(inotifyFd);
+    inotifyFd = -1;
+  }
+  if (stopFd >= 0) {
+    close(stopFd);
+    stopFd = -1;
+  }
+  if (epollFd >= 0) {
+    close(epollFd);
+    epollFd = -1;
+  }
+}
+
+#endif
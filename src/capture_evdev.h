@@ -0,0 +1,33 @@
+#ifndef CAPTURE_EVDEV_H
+#define CAPTURE_EVDEV_H
+
+#ifdef __linux__
+
+#include <stdbool.h>
+
+#include "key_ring.h"
+#include "mouse_aggregate.h"
+
+// Start the evdev input thread, which becomes the single producer for ring.
+// With a NULL replayPath every keyboard under /dev/input is opened (and
+// hotplugged devices are picked up as they appear). Otherwise the file is read
+// as a stream of recorded struct input_event records, e.g. captured with
+// `cat /dev/input/eventN > keys.bin`. With a mouse aggregator (set up to push
+// to the same ring) mice are opened too and their buttons and wheel are fed
+// through it; NULL leaves the mouse alone.
+bool evdevCaptureStart(KeyRing *ring, const char *replayPath,
+                       MouseAggregator *mouse);
+
+// Wake the input thread, close every device and join it
+void evdevCaptureStop(void);
+
+// Whether any keyboard could be opened when capture started; without
+// permission to read /dev/input none can
+bool evdevCaptureFoundKeyboards(void);
+
+// Map a KEY_* code to the shared key symbol table
+KeySymbol getEvdevKeySymbol(int code);
+
+#endif
+
+#endif
@@ -0,0 +1,396 @@
+#ifdef HAVE_XINPUT2
+
+#define _GNU_SOURCE
+
+#include "capture_x11.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <X11/Xlib.h>
+#include <X11/extensions/XInput2.h>
+#include <X11/keysym.h>
+
+#include <SDL2/SDL.h>
+
+#define X11_KEYCODES 256 // X keycodes are 8 bits
+
+static Display *display = NULL;
+static int xiOpcode = 0;
+static int stopFd = -1;
+static pthread_t inputThread;
+static bool threadRunning = false;
+static KeyRing *eventRing = NULL;
+static MouseAggregator *mouseAggregator = NULL; // NULL when mice are ignored
+
+// Keycode to key symbol for the current keyboard mapping. Only the input
+// thread touches it once started.
+static KeySymbol keycodeMap[X11_KEYCODES];
+
+// Counted by the input thread, read after it is joined
+static Uint64 keyPresses = 0;
+static Uint64 keyRepeats = 0;
+static Uint64 buttonPresses = 0;
+
+KeySymbol getX11KeySymbol(unsigned long keysym) {
+  if (keysym >= XK_a && keysym <= XK_z) {
+    return (KeySymbol)(KSYM_A + (keysym - XK_a));
+  }
+  if (keysym >= XK_A && keysym <= XK_Z) {
+    return (KeySymbol)(KSYM_A + (keysym - XK_A));
+  }
+  if (keysym >= XK_0 && keysym <= XK_9) {
+    return (KeySymbol)(KSYM_0 + (keysym - XK_0));
+  }
+  if (keysym >= XK_F1 && keysym <= XK_F24) {
+    return (KeySymbol)(KSYM_F1 + (keysym - XK_F1));
+  }
+
+  switch (keysym) {
+  case XK_minus:
+  case XK_KP_Subtract:
+    return KSYM_MINUS;
+  case XK_equal:
+  case XK_KP_Equal:
+    return KSYM_EQUAL;
+  case XK_bracketleft:
+    return KSYM_LEFT_BRACKET;
+  case XK_bracketright:
+    return KSYM_RIGHT_BRACKET;
+  case XK_backslash:
+  case XK_less: // The extra key left of Z on ISO keyboards
+    return KSYM_BACKSLASH;
+  case XK_semicolon:
+    return KSYM_SEMICOLON;
+  case XK_apostrophe:
+    return KSYM_APOSTROPHE;
+  case XK_grave:
+    return KSYM_GRAVE;
+  case XK_comma:
+    return KSYM_COMMA;
+  case XK_period:
+  case XK_KP_Decimal:
+  case XK_KP_Delete:
+    return KSYM_PERIOD;
+  case XK_slash:
+  case XK_KP_Divide:
+    return KSYM_SLASH;
+  case XK_section:
+    return KSYM_SECTION;
+  case XK_KP_Multiply:
+    return KSYM_ASTERISK;
+  case XK_KP_Add:
+    return KSYM_PLUS;
+  case XK_Return:
+  case XK_KP_Enter:
+    return KSYM_RETURN;
+  case XK_Escape:
+    return KSYM_ESC;
+  case XK_BackSpace:
+    return KSYM_BACKSPACE;
+  case XK_Tab:
+  case XK_ISO_Left_Tab:
+    return KSYM_TAB;
+  case XK_space:
+    return KSYM_SPACE;
+  case XK_Caps_Lock:
+    return KSYM_CAPS;
+  case XK_Shift_L:
+  case XK_Shift_R:
+    return KSYM_SHIFT;
+  case XK_Control_L:
+  case XK_Control_R:
+    return KSYM_CTRL;
+  case XK_Alt_L:
+  case XK_Alt_R:
+  case XK_Meta_L:
+  case XK_Meta_R:
+  case XK_ISO_Level3_Shift: // AltGr
+    return KSYM_ALT;
+  case XK_Super_L:
+  case XK_Super_R:
+    return KSYM_SUPER;
+  case XK_Menu:
+    return KSYM_MENU;
+  case XK_Up:
+    return KSYM_UP;
+  case XK_Down:
+    return KSYM_DOWN;
+  case XK_Left:
+    return KSYM_LEFT;
+  case XK_Right:
+    return KSYM_RIGHT;
+  case XK_Home:
+    return KSYM_HOME;
+  case XK_End:
+    return KSYM_END;
+  case XK_Prior:
+    return KSYM_PAGE_UP;
+  case XK_Next:
+    return KSYM_PAGE_DOWN;
+  case XK_Insert:
+    return KSYM_INSERT;
+  case XK_Delete:
+    return KSYM_DELETE;
+  case XK_Print:
+    return KSYM_PRINT;
+  case XK_Scroll_Lock:
+    return KSYM_SCROLL_LOCK;
+  case XK_Pause:
+    return KSYM_PAUSE;
+  case XK_Num_Lock:
+    return KSYM_NUM_LOCK;
+  case XK_Clear:
+    return KSYM_CLEAR;
+
+  // The keypad without Num Lock shows its digits, as on the other platforms
+  case XK_KP_0:
+  case XK_KP_Insert:
+    return KSYM_0;
+  case XK_KP_1:
+  case XK_KP_End:
+    return KSYM_1;
+  case XK_KP_2:
+  case XK_KP_Down:
+    return KSYM_2;
+  case XK_KP_3:
+  case XK_KP_Next:
+    return KSYM_3;
+  case XK_KP_4:
+  case XK_KP_Left:
+    return KSYM_4;
+  case XK_KP_5:
+  case XK_KP_Begin:
+    return KSYM_5;
+  case XK_KP_6:
+  case XK_KP_Right:
+    return KSYM_6;
+  case XK_KP_7:
+  case XK_KP_Home:
+    return KSYM_7;
+  case XK_KP_8:
+  case XK_KP_Up:
+    return KSYM_8;
+  case XK_KP_9:
+  case XK_KP_Prior:
+    return KSYM_9;
+  default:
+    return KSYM_UNKNOWN;
+  }
+}
+
+// Look up every keycode's unshifted keysym once, instead of per key press.
+// Called again when the server reports a new keyboard mapping.
+static void loadKeycodeMap(void) {
+  int minKeycode;
+  int maxKeycode;
+  XDisplayKeycodes(display, &minKeycode, &maxKeycode);
+  int perKeycode;
+  KeySym *keysyms =
+      XGetKeyboardMapping(display, (KeyCode)minKeycode,
+                          maxKeycode - minKeycode + 1, &perKeycode);
+  memset(keycodeMap, 0, sizeof(keycodeMap));
+  if (!keysyms) {
+    return;
+  }
+  for (int code = minKeycode; code <= maxKeycode && code < X11_KEYCODES;
+       code++) {
+    keycodeMap[code] =
+        getX11KeySymbol(keysyms[(code - minKeycode) * perKeycode]);
+  }
+  XFree(keysyms);
+}
+
+// How long ago the server stamped an event. A local X server stamps events
+// in milliseconds of CLOCK_MONOTONIC; a remote one's ages come out wrong
+// and are dropped by keyEventSetCaptureAge.
+static Uint64 eventAge(Time time) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  Uint32 nowMs = (Uint32)((Uint64)now.tv_sec * 1000 + now.tv_nsec / 1000000);
+  return (Uint64)(Uint32)(nowMs - (Uint32)time) * 1000000;
+}
+
+static void handleRawKey(const XIRawEvent *raw) {
+  KeySymbol symbol = raw->detail >= 0 && raw->detail < X11_KEYCODES
+                         ? keycodeMap[raw->detail]
+                         : KSYM_UNKNOWN;
+  Uint16 flags = 0;
+  if (raw->flags & XIKeyRepeat) {
+    flags = KEY_EVENT_REPEAT;
+    keyRepeats++;
+  }
+  keyPresses++;
+
+  KeyEvent event;
+  keyEventInit(&event, symbol, flags);
+  keyEventSetCaptureAge(&event, eventAge(raw->time));
+  keyRingPush(eventRing, &event);
+}
+
+// Core buttons: 1-3 left, middle and right, 4-7 wheel steps up, down, left
+// and right, 8 and 9 back and forward
+static void handleRawButton(const XIRawEvent *raw) {
+  static const KeySymbol buttonMap[10] = {
+      [1] = KSYM_MOUSE_LEFT,
+      [2] = KSYM_MOUSE_MIDDLE,
+      [3] = KSYM_MOUSE_RIGHT,
+      [4] = KSYM_WHEEL_UP,
+      [5] = KSYM_WHEEL_DOWN,
+      [6] = KSYM_WHEEL_LEFT,
+      [7] = KSYM_WHEEL_RIGHT,
+      [8] = KSYM_MOUSE_BACK,
+      [9] = KSYM_MOUSE_FORWARD,
+  };
+  if (raw->detail < 1 || raw->detail > 9) {
+    return;
+  }
+  buttonPresses++;
+  mouseAggregatorAdd(mouseAggregator, buttonMap[raw->detail], 1,
+                     eventAge(raw->time));
+}
+
+// Handle everything Xlib has read or can read without blocking
+static void readEvents(void) {
+  while (XPending(display) > 0) {
+    XEvent event;
+    XNextEvent(display, &event);
+    if (event.type == MappingNotify) {
+      XRefreshKeyboardMapping(&event.xmapping);
+      if (event.xmapping.request == MappingKeyboard) {
+        loadKeycodeMap();
+      }
+      continue;
+    }
+
+    XGenericEventCookie *cookie = &event.xcookie;
+    if (cookie->type != GenericEvent || cookie->extension != xiOpcode ||
+        !XGetEventData(display, cookie)) {
+      continue;
+    }
+    if (cookie->evtype == XI_RawKeyPress) {
+      handleRawKey((const XIRawEvent *)cookie->data);
+    } else if (cookie->evtype == XI_RawButtonPress && mouseAggregator) {
+      handleRawButton((const XIRawEvent *)cookie->data);
+    }
+    XFreeEventData(display, cookie);
+  }
+}
+
+static void *inputThreadMain(void *param) {
+  struct pollfd fds[2] = {
+      {ConnectionNumber(display), POLLIN, 0},
+      {stopFd, POLLIN, 0},
+  };
+  for (;;) {
+    readEvents();
+
+    // Wake up when folded mouse input is due as well as for the server
+    int timeout = mouseAggregator ? mouseAggregatorFlush(mouseAggregator) : -1;
+    if (poll(fds, 2, timeout) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+    if (fds[1].revents) {
+      break;
+    }
+    if (fds[0].revents & (POLLERR | POLLHUP)) {
+      printf("Lost the connection to the X server.\n");
+      break;
+    }
+  }
+  return NULL;
+}
+
+bool x11CaptureStart(KeyRing *ring, MouseAggregator *mouse) {
+  eventRing = ring;
+  mouseAggregator = mouse;
+
+  display = XOpenDisplay(NULL);
+  if (!display) {
+    printf("Failed to open the X display (is DISPLAY set?).\n");
+    return false;
+  }
+
+  int event;
+  int error;
+  if (!XQueryExtension(display, "XInputExtension", &xiOpcode, &event,
+                       &error)) {
+    printf("The X server has no XInput extension.\n");
+    x11CaptureStop();
+    return false;
+  }
+  // Raw events reach every client regardless of grabs from 2.1 on; 2.0
+  // still works while nothing grabs the keyboard
+  int major = 2;
+  int minor = 1;
+  if (XIQueryVersion(display, &major, &minor) != Success) {
+    printf("The X server does not support XInput 2.\n");
+    x11CaptureStop();
+    return false;
+  }
+
+  unsigned char maskBits[XIMaskLen(XI_LASTEVENT)] = {0};
+  XISetMask(maskBits, XI_RawKeyPress);
+  if (mouse) {
+    XISetMask(maskBits, XI_RawButtonPress);
+  }
+  XIEventMask mask;
+  mask.deviceid = XIAllMasterDevices;
+  mask.mask_len = sizeof(maskBits);
+  mask.mask = maskBits;
+  XISelectEvents(display, DefaultRootWindow(display), &mask, 1);
+  loadKeycodeMap();
+  XSync(display, False);
+
+  stopFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (stopFd < 0) {
+    printf("Failed to set up the X11 input thread.\n");
+    x11CaptureStop();
+    return false;
+  }
+  if (pthread_create(&inputThread, NULL, inputThreadMain, NULL) != 0) {
+    printf("Failed to start the X11 input thread.\n");
+    x11CaptureStop();
+    return false;
+  }
+  threadRunning = true;
+  printf("Reading keys from X display %s (XInput %d.%d).\n",
+         DisplayString(display), major, minor);
+  return true;
+}
+
+void x11CaptureStop(void) {
+  if (threadRunning) {
+    uint64_t one = 1;
+    if (write(stopFd, &one, sizeof(one)) == sizeof(one)) {
+      pthread_join(inputThread, NULL);
+    }
+    threadRunning = false;
+  }
+  if (stopFd >= 0) {
+    close(stopFd);
+    stopFd = -1;
+  }
+  if (display) {
+    XCloseDisplay(display);
+    display = NULL;
+  }
+}
+
+void x11CapturePrintStats(void) {
+  printf("X11 capture: %llu key presses (%llu auto-repeat), %llu mouse "
+         "button presses\n",
+         (unsigned long long)keyPresses, (unsigned long long)keyRepeats,
+         (unsigned long long)buttonPresses);
+}
+
+#endif
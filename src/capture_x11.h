@@ -0,0 +1,31 @@
+#ifndef CAPTURE_X11_H
+#define CAPTURE_X11_H
+
+#ifdef HAVE_XINPUT2
+
+#include <stdbool.h>
+
+#include "key_ring.h"
+#include "mouse_aggregate.h"
+
+// Start the XInput2 input thread, which becomes the single producer for
+// ring. It opens its own connection to the X server named by DISPLAY and
+// listens for raw key presses from every keyboard on the root window, so it
+// needs no access to /dev/input and sees keys whichever window has focus,
+// including keys injected with XTest (xdotool) under Xvfb. With a mouse
+// aggregator (set up to push to the same ring) raw button presses and wheel
+// steps are fed through it too; NULL leaves the mouse alone.
+bool x11CaptureStart(KeyRing *ring, MouseAggregator *mouse);
+
+// Wake the input thread, join it and close the connection
+void x11CaptureStop(void);
+
+void x11CapturePrintStats(void);
+
+// Map an X keysym (unshifted, as on the key cap) to the shared key symbol
+// table
+KeySymbol getX11KeySymbol(unsigned long keysym);
+
+#endif
+
+#endif
@@ -0,0 +1,134 @@
+#include "frame_pacer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static Uint64 ticksToUs(Uint64 ticks) {
+  Uint64 frequency = SDL_GetPerformanceFrequency();
+  return ticks / frequency * 1000000 + ticks % frequency * 1000000 / frequency;
+}
+
+void framePacerInit(FramePacer *pacer, double rate, bool presentPaced) {
+  memset(pacer, 0, sizeof(*pacer));
+  framePacerSetRate(pacer, rate, presentPaced);
+}
+
+void framePacerSetRate(FramePacer *pacer, double rate, bool presentPaced) {
+  pacer->rate = rate > 0 ? rate : 0.0;
+  pacer->period =
+      rate > 0 ? (Uint64)(SDL_GetPerformanceFrequency() / rate + 0.5) : 0;
+  pacer->presentPaced = presentPaced;
+  pacer->running = false;
+}
+
+double framePacerDisplayRate(SDL_Window *window) {
+  SDL_DisplayMode mode;
+  int display = SDL_GetWindowDisplayIndex(window);
+  if (display < 0 || SDL_GetCurrentDisplayMode(display, &mode) != 0) {
+    return 0.0;
+  }
+  return mode.refresh_rate > 0 ? (double)mode.refresh_rate : 0.0;
+}
+
+void framePacerPresented(FramePacer *pacer) {
+  Uint64 now = SDL_GetPerformanceCounter();
+  if (pacer->period > 0 && pacer->running) {
+    Uint64 interval = now - pacer->lastPresent;
+    Uint64 error = interval > pacer->period ? interval - pacer->period
+                                            : pacer->period - interval;
+    Uint64 jitterUs = ticksToUs(error);
+    if (jitterUs > 0xFFFFFFFF) {
+      jitterUs = 0xFFFFFFFF;
+    }
+    if (interval * 2 > pacer->period * 3) {
+      pacer->missed++;
+      pacer->totalMissed++;
+    }
+    pacer->jitterUs[pacer->frames % FRAME_PACER_SAMPLES] = (Uint32)jitterUs;
+    pacer->frames++;
+    pacer->totalFrames++;
+    pacer->totalJitterUs += jitterUs;
+    if (jitterUs > pacer->maxJitterUs) {
+      pacer->maxJitterUs = (Uint32)jitterUs;
+    }
+  }
+  pacer->lastPresent = now;
+}
+
+// Sleep until the counter reaches deadline: in whole milliseconds while
+// that cannot overshoot, then spinning
+static void waitUntil(Uint64 deadline) {
+  Uint64 now = SDL_GetPerformanceCounter();
+  while (now < deadline) {
+    Uint64 remainingUs = ticksToUs(deadline - now);
+    if (remainingUs > FRAME_PACER_SPIN_US + 1000) {
+      SDL_Delay((Uint32)((remainingUs - FRAME_PACER_SPIN_US) / 1000));
+    }
+    now = SDL_GetPerformanceCounter();
+  }
+}
+
+void framePacerWait(FramePacer *pacer, bool presented) {
+  if (pacer->period == 0) {
+    return;
+  }
+  Uint64 now = SDL_GetPerformanceCounter();
+  if (!pacer->running) {
+    pacer->running = true;
+    pacer->deadline = now;
+  }
+  pacer->deadline += pacer->period;
+  if (pacer->deadline <= now) {
+    // Fell a whole frame behind: skip to the next deadline in phase rather
+    // than rushing frames out to catch up
+    Uint64 behind = now - pacer->deadline;
+    pacer->deadline += (behind / pacer->period + 1) * pacer->period;
+  }
+  if (!(presented && pacer->presentPaced)) {
+    waitUntil(pacer->deadline);
+  }
+}
+
+void framePacerStop(FramePacer *pacer) { pacer->running = false; }
+
+static int compareU32(const void *a, const void *b) {
+  Uint32 x = *(const Uint32 *)a;
+  Uint32 y = *(const Uint32 *)b;
+  return x < y ? -1 : x > y;
+}
+
+void framePacerPrintReport(FramePacer *pacer) {
+  if (pacer->period == 0) {
+    return;
+  }
+  if (pacer->frames == 0) {
+    printf("Frame pacing at %.1f Hz: no animation frames\n", pacer->rate);
+    return;
+  }
+  int count = pacer->frames < FRAME_PACER_SAMPLES ? (int)pacer->frames
+                                                  : FRAME_PACER_SAMPLES;
+  qsort(pacer->jitterUs, count, sizeof(pacer->jitterUs[0]), compareU32);
+  printf("Frame pacing at %.1f Hz: %llu frames, %llu missed deadlines, "
+         "jitter p50 %.2f ms, p99 %.2f ms, max %.2f ms\n",
+         pacer->rate, (unsigned long long)pacer->frames,
+         (unsigned long long)pacer->missed,
+         pacer->jitterUs[count / 2] / 1000.0,
+         pacer->jitterUs[(count - 1) * 99 / 100] / 1000.0,
+         pacer->jitterUs[count - 1] / 1000.0);
+  pacer->frames = 0;
+  pacer->missed = 0;
+}
+
+void framePacerPrintStats(const FramePacer *pacer) {
+  if (pacer->period == 0 || pacer->totalFrames == 0) {
+    return;
+  }
+  printf("Frame pacing at %.1f Hz: %llu animation frames, %llu missed "
+         "deadlines (%.2f%%), mean jitter %.2f ms, max %.2f ms\n",
+         pacer->rate, (unsigned long long)pacer->totalFrames,
+         (unsigned long long)pacer->totalMissed,
+         pacer->totalMissed * 100.0 / pacer->totalFrames,
+         pacer->totalJitterUs / 1000.0 / pacer->totalFrames,
+         pacer->maxJitterUs / 1000.0);
+}
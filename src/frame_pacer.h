@@ -0,0 +1,77 @@
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include <stdbool.h>
+
+#ifdef _WIN32
+#include <SDL.h>
+#else
+#include <SDL2/SDL.h>
+#endif
+
+#define FRAME_PACER_DEFAULT_RATE 60.0 // When the display reports no rate
+#define FRAME_PACER_SPIN_US 1000 // Busy-wait this close to a deadline
+#define FRAME_PACER_SAMPLES 4096 // Jitter samples kept per report
+
+// Holds animation frames (fades and scrolls) to a steady rate: the
+// display's refresh rate, or a configured one for headless output. Frames
+// are due one period apart on the performance counter; waiting for a
+// deadline sleeps most of the way and spins the last moment, since
+// SDL_Delay only has millisecond resolution. When vsync already holds
+// presents to the rate, frames are measured but not delayed.
+//
+// Every presented frame of an animation is checked against the period: a
+// frame more than half a period late missed its deadline (on a vsync'd
+// display, it skipped a refresh), and how far each interval is from the
+// period is its jitter.
+typedef struct {
+  double rate;       // Frames per second; 0 = not paced
+  Uint64 period;     // Performance counter ticks per frame
+  bool presentPaced; // Presenting waits for the display at rate (vsync)
+
+  bool running;       // Frames are back to back; the next one has a deadline
+  Uint64 deadline;    // Counter value the next frame is due
+  Uint64 lastPresent; // Counter value the previous frame was presented
+
+  // Since the last report: jitter of the newest samples, in microseconds
+  Uint32 jitterUs[FRAME_PACER_SAMPLES];
+  Uint64 frames;
+  Uint64 missed;
+
+  // Since init
+  Uint64 totalFrames;
+  Uint64 totalMissed;
+  Uint64 totalJitterUs;
+  Uint32 maxJitterUs;
+} FramePacer;
+
+// rate <= 0 leaves frames unpaced and unmeasured
+void framePacerInit(FramePacer *pacer, double rate, bool presentPaced);
+
+// Change the rate, e.g. when the window moves to another display, keeping
+// the statistics
+void framePacerSetRate(FramePacer *pacer, double rate, bool presentPaced);
+
+// Refresh rate of the display the window is on, or 0 if it is unknown
+double framePacerDisplayRate(SDL_Window *window);
+
+// Call right after presenting a frame
+void framePacerPresented(FramePacer *pacer);
+
+// Call once a frame of an animation is done, before starting the next.
+// Waits for the next deadline unless presented says this frame was shown
+// through vsync that already paced it.
+void framePacerWait(FramePacer *pacer, bool presented);
+
+// The animation is over and the loop goes idle; the next frame starts a
+// new run instead of counting as late
+void framePacerStop(FramePacer *pacer);
+
+// Print frames, missed deadlines and jitter percentiles since the last
+// report, and start a new one
+void framePacerPrintReport(FramePacer *pacer);
+
+// Print the totals since init
+void framePacerPrintStats(const FramePacer *pacer);
+
+#endif
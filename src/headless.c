@@ -0,0 +1,119 @@
+#include "headless.h"
+
+#include <string.h>
+
+// Create the framebuffer and open the raw frame stream, if any
+static bool createFramebuffer(HeadlessTarget *target, int width, int height,
+                              const char *outputPath) {
+  target->surface = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32,
+                                                   SDL_PIXELFORMAT_RGBA32);
+  if (!target->surface) {
+    printf("Framebuffer could not be created! SDL_Error: %s\n",
+           SDL_GetError());
+    return false;
+  }
+
+  if (outputPath) {
+    target->output = fopen(outputPath, "wb");
+    if (!target->output) {
+      printf("Failed to open headless output %s\n", outputPath);
+      return false;
+    }
+  }
+  return true;
+}
+
+bool headlessInit(HeadlessTarget *target, int width, int height,
+                  const char *outputPath) {
+  memset(target, 0, sizeof(*target));
+  if (!createFramebuffer(target, width, height, outputPath)) {
+    headlessDestroy(target);
+    return false;
+  }
+
+  target->renderer = SDL_CreateSoftwareRenderer(target->surface);
+  if (!target->renderer) {
+    printf("Software renderer could not be created! SDL_Error: %s\n",
+           SDL_GetError());
+    headlessDestroy(target);
+    return false;
+  }
+  return true;
+}
+
+bool headlessInitTexture(HeadlessTarget *target, SDL_Renderer *renderer,
+                         int width, int height, const char *outputPath) {
+  memset(target, 0, sizeof(*target));
+  if (!createFramebuffer(target, width, height, outputPath)) {
+    headlessDestroy(target);
+    return false;
+  }
+
+  target->texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32,
+                                      SDL_TEXTUREACCESS_TARGET, width,
+                                      height);
+  if (!target->texture) {
+    printf("View texture could not be created! SDL_Error: %s\n",
+           SDL_GetError());
+    headlessDestroy(target);
+    return false;
+  }
+  target->renderer = renderer;
+  return true;
+}
+
+void headlessDestroy(HeadlessTarget *target) {
+  if (target->output) {
+    fclose(target->output);
+    target->output = NULL;
+  }
+  if (target->texture) {
+    // The renderer belongs to its window or framebuffer
+    SDL_DestroyTexture(target->texture);
+    target->texture = NULL;
+  } else if (target->renderer) {
+    SDL_DestroyRenderer(target->renderer);
+  }
+  target->renderer = NULL;
+  if (target->surface) {
+    SDL_FreeSurface(target->surface);
+    target->surface = NULL;
+  }
+}
+
+void headlessSetFrameCallback(HeadlessTarget *target, HeadlessFrameFn onFrame,
+                              void *userdata) {
+  target->onFrame = onFrame;
+  target->onFrameUserdata = userdata;
+}
+
+void headlessBegin(HeadlessTarget *target) {
+  if (target->texture) {
+    SDL_SetRenderTarget(target->renderer, target->texture);
+  }
+}
+
+void headlessPresent(HeadlessTarget *target) {
+  SDL_Surface *surface = target->surface;
+  if (target->texture) {
+    // Copy the texture back and leave the renderer to its own output
+    SDL_RenderReadPixels(target->renderer, NULL, SDL_PIXELFORMAT_RGBA32,
+                         surface->pixels, surface->pitch);
+    SDL_SetRenderTarget(target->renderer, NULL);
+  } else {
+    // Flushes the software renderer's queued draw calls into the surface
+    SDL_RenderPresent(target->renderer);
+  }
+
+  if (target->output) {
+    for (int y = 0; y < surface->h; y++) {
+      const Uint8 *row = (const Uint8 *)surface->pixels + y * surface->pitch;
+      fwrite(row, 4, surface->w, target->output);
+    }
+    fflush(target->output);
+  }
+  if (target->onFrame) {
+    target->onFrame(surface, target->frameIndex, target->onFrameUserdata);
+  }
+  target->frameIndex++;
+}
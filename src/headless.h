@@ -0,0 +1,52 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#ifdef _WIN32
+#include <SDL.h>
+#else
+#include <SDL2/SDL.h>
+#endif
+
+// Receives every finished frame; pixels stay valid until the next frame
+typedef void (*HeadlessFrameFn)(const SDL_Surface *frame, Uint64 frameIndex,
+                                void *userdata);
+
+// Offscreen render target: a software renderer drawing into an RGBA32
+// framebuffer in memory instead of a window, or another renderer drawing
+// into a texture that is read back into the framebuffer
+typedef struct {
+  SDL_Surface *surface;
+  SDL_Renderer *renderer;
+  SDL_Texture *texture; // Target of a renderer the target does not own
+  FILE *output; // Optional raw RGBA frame stream
+  Uint64 frameIndex;
+  HeadlessFrameFn onFrame;
+  void *onFrameUserdata;
+} HeadlessTarget;
+
+// Create a width x height framebuffer. If outputPath is set every frame is
+// also appended to it as raw RGBA bytes; a FIFO works for piping frames into
+// an encoder.
+bool headlessInit(HeadlessTarget *target, int width, int height,
+                  const char *outputPath);
+
+// Like headlessInit, but frames are drawn by renderer, which keeps drawing
+// its own window or framebuffer too, so both share its textures. Fails if
+// renderer cannot render to textures.
+bool headlessInitTexture(HeadlessTarget *target, SDL_Renderer *renderer,
+                         int width, int height, const char *outputPath);
+void headlessDestroy(HeadlessTarget *target);
+
+void headlessSetFrameCallback(HeadlessTarget *target, HeadlessFrameFn onFrame,
+                              void *userdata);
+
+// Point target->renderer at the target before drawing a frame into it
+void headlessBegin(HeadlessTarget *target);
+
+// Finish the frame drawn through target->renderer and hand it to consumers
+void headlessPresent(HeadlessTarget *target);
+
+#endif
@@ -0,0 +1,164 @@
+#include "key_coalesce.h"
+
+#include <string.h>
+
+void keyCoalescerInit(KeyCoalescer *coalescer, Uint32 windowMs, bool chords) {
+  memset(coalescer, 0, sizeof(*coalescer));
+  coalescer->windowMs = windowMs;
+  coalescer->chords = chords;
+}
+
+static bool capHasSymbol(const KeyCap *cap, KeySymbol symbol) {
+  for (int i = 0; i < cap->symbolCount; i++) {
+    if (cap->symbols[i] == symbol) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool capSameSymbols(const KeyCap *a, const KeyCap *b) {
+  return a->symbolCount == b->symbolCount &&
+         memcmp(a->symbols, b->symbols,
+                a->symbolCount * sizeof(a->symbols[0])) == 0;
+}
+
+// Show held-back modifiers as a chord still waiting for its key
+static void flushPending(KeyCoalescer *coalescer) {
+  if (coalescer->hasPending) {
+    pushKeyCap(&coalescer->pending);
+    coalescer->hasPending = false;
+    coalescer->chordOpen = true;
+  }
+}
+
+static void feedModifier(KeyCoalescer *coalescer, KeySymbol symbol,
+                         Uint16 flags, bool recent) {
+  // Held modifiers auto-repeat on some platforms; the first press shows them
+  if (flags & KEY_EVENT_REPEAT) {
+    return;
+  }
+
+  if (coalescer->hasPending) {
+    KeyCap *pending = &coalescer->pending;
+    if (recent && pending->symbolCount < KEY_CAP_MAX_SYMBOLS - 1 &&
+        !capHasSymbol(pending, symbol)) {
+      pending->symbols[pending->symbolCount++] = symbol;
+      return;
+    }
+    flushPending(coalescer);
+  }
+
+  // Another modifier joins the chord in progress (Ctrl, then Shift)
+  const KeyCap *newest = newestKeyCap();
+  if (recent && coalescer->chordOpen &&
+      newest->symbolCount < KEY_CAP_MAX_SYMBOLS - 1 &&
+      !capHasSymbol(newest, symbol)) {
+    KeyCap cap = *newest;
+    cap.symbols[cap.symbolCount++] = symbol;
+    updateNewestKeyCap(&cap);
+    return;
+  }
+
+  // This may be the same chord again; wait for its key before showing it
+  if (recent && newest->symbolCount > 1 && newest->symbols[0] == symbol &&
+      newest->count < KEY_CAP_MAX_COUNT) {
+    KeyCap pending = {{symbol}, 1, 1};
+    coalescer->pending = pending;
+    coalescer->hasPending = true;
+    coalescer->chordOpen = false;
+    return;
+  }
+
+  KeyCap cap = {{symbol}, 1, 1};
+  pushKeyCap(&cap);
+  coalescer->chordOpen = true;
+}
+
+// A cap's count plus count more presses, within KEY_CAP_MAX_COUNT
+static int addCount(int capCount, int count) {
+  return capCount + count < KEY_CAP_MAX_COUNT ? capCount + count
+                                              : KEY_CAP_MAX_COUNT;
+}
+
+static void feedKey(KeyCoalescer *coalescer, KeySymbol symbol, Uint16 flags,
+                    int count, bool recent) {
+  // Held-back modifiers plus this key either repeat the newest chord or
+  // start a new one
+  if (coalescer->hasPending) {
+    const KeyCap *newest = newestKeyCap();
+    KeyCap cap = coalescer->pending;
+    cap.symbols[cap.symbolCount++] = symbol;
+    coalescer->hasPending = false;
+    if (newest && capSameSymbols(&cap, newest)) {
+      cap.count = addCount(newest->count, count);
+      updateNewestKeyCap(&cap);
+    } else {
+      cap.count = count;
+      pushKeyCap(&cap);
+    }
+    return;
+  }
+
+  // The key completing a chord
+  const KeyCap *newest = newestKeyCap();
+  if (recent && coalescer->chordOpen) {
+    KeyCap cap = *newest;
+    cap.symbols[cap.symbolCount++] = symbol;
+    cap.count = count;
+    coalescer->chordOpen = false;
+    updateNewestKeyCap(&cap);
+    return;
+  }
+  coalescer->chordOpen = false;
+
+  // Auto-repeat of the newest cap's key, or another press of a key that
+  // does not type. Separate presses of printable keys stay apart so words
+  // like "all" still read as typed.
+  if (recent && newest->symbols[newest->symbolCount - 1] == symbol &&
+      newest->count < KEY_CAP_MAX_COUNT &&
+      ((flags & KEY_EVENT_REPEAT) ||
+       (newest->symbolCount == 1 && !keySymbolIsPrintable(symbol)))) {
+    KeyCap cap = *newest;
+    cap.count = addCount(cap.count, count);
+    updateNewestKeyCap(&cap);
+    return;
+  }
+
+  KeyCap cap = {{symbol}, 1, count};
+  pushKeyCap(&cap);
+}
+
+void keyCoalescerFeed(KeyCoalescer *coalescer, const KeyEvent *event,
+                      Uint32 now) {
+  bool recent = newestKeyCap() != NULL &&
+                now - coalescer->lastTime <= coalescer->windowMs;
+  coalescer->lastTime = now;
+  if (!recent) {
+    flushPending(coalescer);
+  }
+
+  if (coalescer->chords && keySymbolIsModifier(event->symbol)) {
+    feedModifier(coalescer, event->symbol, event->flags, recent);
+  } else {
+    feedKey(coalescer, event->symbol, event->flags, keyEventCount(event),
+            recent);
+  }
+}
+
+void keyCoalescerFlush(KeyCoalescer *coalescer, Uint32 now) {
+  if (coalescer->hasPending &&
+      now - coalescer->lastTime > coalescer->windowMs) {
+    flushPending(coalescer);
+  }
+}
+
+int keyCoalescerTimeout(const KeyCoalescer *coalescer, Uint32 now) {
+  if (!coalescer->hasPending) {
+    return -1;
+  }
+  Uint32 elapsed = now - coalescer->lastTime;
+  return elapsed > coalescer->windowMs
+             ? 0
+             : (int)(coalescer->windowMs - elapsed) + 1;
+}
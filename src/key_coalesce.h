@@ -0,0 +1,50 @@
+#ifndef KEY_COALESCE_H
+#define KEY_COALESCE_H
+
+#include <stdbool.h>
+
+#ifdef _WIN32
+#include <SDL.h>
+#else
+#include <SDL2/SDL.h>
+#endif
+
+#include "key_ring.h"
+#include "scene.h"
+
+#define KEY_COALESCE_DEFAULT_WINDOW 500 // Milliseconds between joined presses
+
+// Folds bursts of the same key into one counted cap ("Bksp ×23") that is
+// updated in place instead of pushing a new cap per press. Auto-repeat of
+// any key is joined, and so are separate presses of keys that do not type a
+// character. With chords enabled, modifiers and the key that follows them
+// share one cap ("Ctrl+z"), and repeating the same chord bumps its count.
+// An event standing for several presses (folded clicks or wheel steps)
+// adds all of them.
+typedef struct {
+  Uint32 windowMs; // Longest gap between presses that are joined
+  bool chords;
+  Uint32 lastTime; // Scene time of the previous press
+
+  bool chordOpen; // The newest cap holds modifiers waiting for a key
+
+  // Modifiers held back because they may start a repeat of the newest chord
+  KeyCap pending;
+  bool hasPending;
+} KeyCoalescer;
+
+void keyCoalescerInit(KeyCoalescer *coalescer, Uint32 windowMs, bool chords);
+
+// Lay out one captured key at scene time now, joining it to the newest cap
+// when it continues a burst
+void keyCoalescerFeed(KeyCoalescer *coalescer, const KeyEvent *event,
+                      Uint32 now);
+
+// Show held-back modifiers once no chord can follow them; call after every
+// batch of keys and whenever keyCoalescerTimeout expires
+void keyCoalescerFlush(KeyCoalescer *coalescer, Uint32 now);
+
+// Milliseconds until keyCoalescerFlush has work to do, or -1 if never
+int keyCoalescerTimeout(const KeyCoalescer *coalescer, Uint32 now);
+
+#endif
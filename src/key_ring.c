@@ -0,0 +1,110 @@
+#include "key_ring.h"
+
+#include <string.h>
+
+#define RING_MASK (KEY_RING_CAPACITY - 1)
+
+void keyRingInit(KeyRing *ring) {
+  memset(ring, 0, sizeof(*ring));
+  SDL_AtomicSet(&ring->head, 0);
+  SDL_AtomicSet(&ring->tail, 0);
+  SDL_AtomicSet(&ring->overflows, 0);
+  SDL_AtomicSet(&ring->waiting, 0);
+}
+
+void keyEventInit(KeyEvent *event, KeySymbol symbol, Uint16 flags) {
+  event->timestamp = SDL_GetTicks();
+  event->symbol = symbol;
+  event->flags = flags;
+  event->captureTicks = SDL_GetPerformanceCounter();
+}
+
+void keyEventSetCaptureAge(KeyEvent *event, Uint64 ageNs) {
+  // Ignore ages that cannot be right (clock mismatch or a stale event)
+  if (ageNs > 1000000000ull) {
+    return;
+  }
+  event->captureTicks -= ageNs * SDL_GetPerformanceFrequency() / 1000000000ull;
+}
+
+int keyEventCount(const KeyEvent *event) {
+  return (event->flags >> KEY_EVENT_COUNT_SHIFT) + 1;
+}
+
+void keyEventSetCount(KeyEvent *event, int count) {
+  if (count < 1) {
+    count = 1;
+  } else if (count > KEY_EVENT_COUNT_MAX) {
+    count = KEY_EVENT_COUNT_MAX;
+  }
+  event->flags = (Uint16)((event->flags & ((1 << KEY_EVENT_COUNT_SHIFT) - 1)) |
+                          ((count - 1) << KEY_EVENT_COUNT_SHIFT));
+}
+
+bool keyRingPush(KeyRing *ring, const KeyEvent *event) {
+  // Indices grow freely and wrap as unsigned; only the masked value is used
+  // to address the slot
+  unsigned int head = (unsigned int)SDL_AtomicGet(&ring->head);
+  unsigned int tail = (unsigned int)SDL_AtomicGet(&ring->tail);
+  if (head - tail >= KEY_RING_CAPACITY) {
+    SDL_AtomicAdd(&ring->overflows, 1);
+    return false;
+  }
+
+  ring->events[head & RING_MASK] = *event;
+
+  // Publish the slot contents before the new head becomes visible
+  SDL_MemoryBarrierRelease();
+  SDL_AtomicSet(&ring->head, (int)(head + 1));
+
+  // Only pay for a wakeup when the consumer is actually going to sleep
+  if (SDL_AtomicGet(&ring->waiting) && SDL_AtomicCAS(&ring->waiting, 1, 0) &&
+      ring->wake) {
+    ring->wake(ring->wakeUserdata);
+  }
+  return true;
+}
+
+int keyRingDrain(KeyRing *ring, KeyEvent *out, int max) {
+  unsigned int tail = (unsigned int)SDL_AtomicGet(&ring->tail);
+  unsigned int head = (unsigned int)SDL_AtomicGet(&ring->head);
+  SDL_MemoryBarrierAcquire();
+
+  int count = 0;
+  while (tail != head && count < max) {
+    out[count++] = ring->events[tail & RING_MASK];
+    tail++;
+  }
+
+  // Hand the slots back to the producer in one store
+  SDL_MemoryBarrierRelease();
+  SDL_AtomicSet(&ring->tail, (int)tail);
+  return count;
+}
+
+int keyRingOverflows(KeyRing *ring) { return SDL_AtomicGet(&ring->overflows); }
+
+int keyRingSpace(KeyRing *ring) {
+  unsigned int head = (unsigned int)SDL_AtomicGet(&ring->head);
+  unsigned int tail = (unsigned int)SDL_AtomicGet(&ring->tail);
+  return KEY_RING_CAPACITY - (int)(head - tail);
+}
+
+void keyRingSetWake(KeyRing *ring, KeyRingWakeFn wake, void *userdata) {
+  ring->wake = wake;
+  ring->wakeUserdata = userdata;
+}
+
+bool keyRingPrepareWait(KeyRing *ring) {
+  SDL_AtomicSet(&ring->waiting, 1);
+
+  // Re-check after publishing the flag: either we see the producer's new
+  // head here, or the producer sees the flag and calls wake
+  if (SDL_AtomicGet(&ring->head) != SDL_AtomicGet(&ring->tail)) {
+    SDL_AtomicSet(&ring->waiting, 0);
+    return false;
+  }
+  return true;
+}
+
+void keyRingCancelWait(KeyRing *ring) { SDL_AtomicSet(&ring->waiting, 0); }
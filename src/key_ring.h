@@ -0,0 +1,85 @@
+#ifndef KEY_RING_H
+#define KEY_RING_H
+
+#include <stdbool.h>
+
+#ifdef _WIN32
+#include <SDL.h>
+#else
+#include <SDL2/SDL.h>
+#endif
+
+#include "keysyms.h"
+
+#define KEY_RING_CAPACITY 1024 // Must be a power of two
+#define KEY_RING_PAD 64 // Keeps producer and consumer indices on own lines
+
+// Flags carried with each key event
+#define KEY_EVENT_REPEAT 0x0001 // Generated by OS auto-repeat
+#define KEY_EVENT_COUNT_SHIFT 8  // High byte: how many presses, minus one
+#define KEY_EVENT_COUNT_MAX 256  // Most presses one event can stand for
+
+// Compact, allocation-free key event passed from a capture thread
+typedef struct {
+  Uint32 timestamp; // SDL_GetTicks() when the key was captured
+  KeySymbol symbol;
+  Uint16 flags;
+  Uint64 captureTicks; // SDL_GetPerformanceCounter() when the OS saw the key
+} KeyEvent;
+
+// Called from the producer thread when the consumer asked to be woken
+typedef void (*KeyRingWakeFn)(void *userdata);
+
+// Single-producer/single-consumer ring. Exactly one thread may push and
+// exactly one thread may drain; neither side ever blocks or allocates.
+typedef struct {
+  SDL_atomic_t head; // Next slot the producer writes
+  char padHead[KEY_RING_PAD - sizeof(SDL_atomic_t)];
+  SDL_atomic_t tail; // Next slot the consumer reads
+  char padTail[KEY_RING_PAD - sizeof(SDL_atomic_t)];
+  SDL_atomic_t overflows; // Events rejected because the ring was full
+  SDL_atomic_t waiting;   // Set while the consumer is about to sleep
+  KeyRingWakeFn wake;
+  void *wakeUserdata;
+  KeyEvent events[KEY_RING_CAPACITY];
+} KeyRing;
+
+void keyRingInit(KeyRing *ring);
+
+// Fill in an event for the given key, stamped with the current time
+void keyEventInit(KeyEvent *event, KeySymbol symbol, Uint16 flags);
+
+// Move the capture time back by how long ago the OS stamped the event, so
+// latency is measured from the hardware event rather than from the hook
+void keyEventSetCaptureAge(KeyEvent *event, Uint64 ageNs);
+
+// How many presses an event stands for: 1, unless a capture backend folded
+// a burst of clicks or wheel steps into it
+int keyEventCount(const KeyEvent *event);
+
+// Make an event stand for count presses, clamped to KEY_EVENT_COUNT_MAX
+void keyEventSetCount(KeyEvent *event, int count);
+
+// Producer side: returns false and counts an overflow if the ring is full
+bool keyRingPush(KeyRing *ring, const KeyEvent *event);
+
+// Consumer side: copy up to max pending events into out, oldest first
+int keyRingDrain(KeyRing *ring, KeyEvent *out, int max);
+
+int keyRingOverflows(KeyRing *ring);
+
+// Producer side: how many events can be pushed before the ring is full
+int keyRingSpace(KeyRing *ring);
+
+// Install the function a producer uses to wake a sleeping consumer
+void keyRingSetWake(KeyRing *ring, KeyRingWakeFn wake, void *userdata);
+
+// Consumer side: announce an upcoming sleep. Returns false (and cancels the
+// announcement) if events are already pending; otherwise the next push calls
+// the wake function exactly once.
+bool keyRingPrepareWait(KeyRing *ring);
+
+// Consumer side: withdraw the announcement after waking for any reason
+void keyRingCancelWait(KeyRing *ring);
+
+#endif
@@ -0,0 +1,261 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "keylog.h"
+
+#include <errno.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Cut the file to size bytes, dropping a torn record at the end
+static bool truncateLog(FILE *file, long size) {
+  fflush(file);
+#ifdef _WIN32
+  return _chsize_s(_fileno(file), size) == 0;
+#else
+  return ftruncate(fileno(file), (off_t)size) == 0;
+#endif
+}
+
+// Check an existing log can be continued, drop a torn trailing record and
+// carry its clock on from the last record. Leaves the file at its end.
+static bool resumeLog(KeyLogWriter *writer, const char *path, long size) {
+  KeyLogHeader header;
+  if ((size_t)size < sizeof(header) ||
+      fread(&header, sizeof(header), 1, writer->file) != 1 ||
+      SDL_SwapLE32(header.magic) != KEYLOG_MAGIC ||
+      SDL_SwapLE16(header.version) != KEYLOG_VERSION ||
+      SDL_SwapLE16(header.recordSize) != sizeof(KeyLogRecord)) {
+    printf("%s is not a key log this version can append to; record to a "
+           "new file\n",
+           path);
+    return false;
+  }
+
+  Uint64 records = (size - sizeof(header)) / sizeof(KeyLogRecord);
+  long end = (long)(sizeof(header) + records * sizeof(KeyLogRecord));
+  if (end != size) {
+    printf("Dropping a torn record at the end of %s\n", path);
+    if (!truncateLog(writer->file, end)) {
+      printf("Failed to truncate key log %s\n", path);
+      return false;
+    }
+  }
+
+  if (records > 0) {
+    KeyLogRecord last;
+    if (fseek(writer->file, end - (long)sizeof(last), SEEK_SET) != 0 ||
+        fread(&last, sizeof(last), 1, writer->file) != 1) {
+      printf("Failed to read key log %s\n", path);
+      return false;
+    }
+    writer->resumeTime = SDL_SwapLE32(last.timeMs) + KEYLOG_RESUME_GAP_MS;
+  }
+  fseek(writer->file, end, SEEK_SET);
+  return true;
+}
+
+bool keyLogWriterOpen(KeyLogWriter *writer, const char *path) {
+  memset(writer, 0, sizeof(*writer));
+
+  // Continue an existing log so a crashed session can be resumed
+  writer->file = fopen(path, "r+b");
+  if (!writer->file && errno == ENOENT) {
+    writer->file = fopen(path, "w+b");
+  }
+  if (!writer->file) {
+    printf("Failed to open key log %s for writing\n", path);
+    return false;
+  }
+
+  fseek(writer->file, 0, SEEK_END);
+  long size = ftell(writer->file);
+  rewind(writer->file);
+  if (size > 0) {
+    if (!resumeLog(writer, path, size)) {
+      keyLogWriterClose(writer);
+      return false;
+    }
+  } else {
+    KeyLogHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = SDL_SwapLE32(KEYLOG_MAGIC);
+    header.version = SDL_SwapLE16(KEYLOG_VERSION);
+    header.recordSize = SDL_SwapLE16(sizeof(KeyLogRecord));
+    fwrite(&header, sizeof(header), 1, writer->file);
+  }
+  fflush(writer->file);
+  return true;
+}
+
+void keyLogWriterAppend(KeyLogWriter *writer, const KeyEvent *events,
+                        int count) {
+  if (!writer->file || count <= 0) {
+    return;
+  }
+  if (!writer->started) {
+    // A resumed log carries on after its last record
+    writer->baseTime = events[0].timestamp - writer->resumeTime;
+    writer->started = true;
+  }
+
+  KeyLogRecord records[64];
+  int pending = 0;
+  for (int i = 0; i < count; i++) {
+    Uint32 timeMs = events[i].timestamp - writer->baseTime;
+    records[pending].timeMs = SDL_SwapLE32(timeMs);
+    records[pending].symbol = SDL_SwapLE16(events[i].symbol);
+    records[pending].flags = SDL_SwapLE16(events[i].flags);
+    if (++pending == 64 || i == count - 1) {
+      fwrite(records, sizeof(KeyLogRecord), pending, writer->file);
+      pending = 0;
+    }
+  }
+
+  // One flush per batch keeps the log intact if we are killed mid-stream
+  fflush(writer->file);
+  writer->recordCount += count;
+}
+
+void keyLogWriterClose(KeyLogWriter *writer) {
+  if (writer->file) {
+    fclose(writer->file);
+    writer->file = NULL;
+  }
+}
+
+// Map the file read-only where we can; fall back to reading it into memory
+static bool loadFile(KeyLogReplay *replay, const char *path) {
+#ifndef _WIN32
+  int fd = open(path, O_RDONLY);
+  if (fd >= 0) {
+    struct stat info;
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+      void *data =
+          mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (data != MAP_FAILED) {
+        close(fd);
+        replay->data = data;
+        replay->size = (size_t)info.st_size;
+        replay->mapped = true;
+        return true;
+      }
+    }
+    close(fd);
+  }
+#endif
+  replay->data = SDL_LoadFile(path, &replay->size);
+  replay->mapped = false;
+  return replay->data != NULL;
+}
+
+bool keyLogReplayOpen(KeyLogReplay *replay, const char *path, double speed) {
+  memset(replay, 0, sizeof(*replay));
+  replay->speed = speed;
+
+  if (!loadFile(replay, path)) {
+    printf("Failed to open key log %s\n", path);
+    return false;
+  }
+
+  const KeyLogHeader *header = (const KeyLogHeader *)replay->data;
+  if (replay->size < sizeof(KeyLogHeader) ||
+      SDL_SwapLE32(header->magic) != KEYLOG_MAGIC ||
+      SDL_SwapLE16(header->version) != KEYLOG_VERSION ||
+      SDL_SwapLE16(header->recordSize) != sizeof(KeyLogRecord)) {
+    printf("%s is not a keycapper key log\n", path);
+    keyLogReplayClose(replay);
+    return false;
+  }
+
+  // A torn trailing record from an interrupted recording is ignored
+  replay->records =
+      (const KeyLogRecord *)((const char *)replay->data + sizeof(KeyLogHeader));
+  replay->recordCount =
+      (replay->size - sizeof(KeyLogHeader)) / sizeof(KeyLogRecord);
+  printf("Replaying %llu keys from %s\n",
+         (unsigned long long)replay->recordCount, path);
+  return true;
+}
+
+void keyLogReplayClose(KeyLogReplay *replay) {
+  if (replay->data) {
+#ifndef _WIN32
+    if (replay->mapped) {
+      munmap(replay->data, replay->size);
+    } else
+#endif
+    {
+      SDL_free(replay->data);
+    }
+  }
+  memset(replay, 0, sizeof(*replay));
+}
+
+// Recorded time the replay has reached at scene time now
+static Uint32 replayPosition(const KeyLogReplay *replay, Uint32 now) {
+  Uint32 elapsed = now - replay->startTime;
+  if (replay->speed > 0) {
+    return (Uint32)(elapsed * replay->speed);
+  }
+  return replay->skippedMs;
+}
+
+int keyLogReplayPoll(KeyLogReplay *replay, Uint32 now, KeyEvent *out,
+                     int max) {
+  if (keyLogReplayDone(replay)) {
+    return 0;
+  }
+  if (!replay->started) {
+    replay->startTime = now;
+    replay->started = true;
+  }
+
+  // As fast as possible: jump straight to the next recorded timestamp
+  if (replay->speed <= 0) {
+    replay->skippedMs = SDL_SwapLE32(replay->records[replay->next].timeMs);
+  }
+
+  Uint32 position = replayPosition(replay, now);
+  int count = 0;
+  while (count < max && replay->next < replay->recordCount) {
+    const KeyLogRecord *record = &replay->records[replay->next];
+    if (SDL_SwapLE32(record->timeMs) > position) {
+      break;
+    }
+    keyEventInit(&out[count], SDL_SwapLE16(record->symbol),
+                 SDL_SwapLE16(record->flags));
+    out[count].timestamp = now;
+    count++;
+    replay->next++;
+  }
+  return count;
+}
+
+int keyLogReplayTimeout(const KeyLogReplay *replay, Uint32 now) {
+  if (keyLogReplayDone(replay)) {
+    return -1;
+  }
+  if (!replay->started || replay->speed <= 0) {
+    return 0;
+  }
+  Uint32 due = SDL_SwapLE32(replay->records[replay->next].timeMs);
+  Uint32 position = replayPosition(replay, now);
+  if (due <= position) {
+    return 0;
+  }
+  return (int)((due - position) / replay->speed) + 1;
+}
+
+bool keyLogReplayDone(const KeyLogReplay *replay) {
+  return replay->next >= replay->recordCount;
+}
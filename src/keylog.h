@@ -0,0 +1,78 @@
+#ifndef KEYLOG_H
+#define KEYLOG_H
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#ifdef _WIN32
+#include <SDL.h>
+#else
+#include <SDL2/SDL.h>
+#endif
+
+#include "key_ring.h"
+
+// Binary keystroke log: a 16 byte header followed by fixed-size 8 byte
+// records, all little-endian. Files are only ever appended to, and the record
+// array can be used straight from an mmap of the file.
+#define KEYLOG_MAGIC 0x474C4B4Bu // "KKLG"
+#define KEYLOG_VERSION 1
+#define KEYLOG_RESUME_GAP_MS 1000 // Pause left before a resumed session
+
+typedef struct {
+  Uint32 magic;
+  Uint16 version;
+  Uint16 recordSize;
+  Uint32 reserved[2];
+} KeyLogHeader;
+
+typedef struct {
+  Uint32 timeMs; // Milliseconds since the first recorded key
+  Uint16 symbol; // KeySymbol
+  Uint16 flags;  // KEY_EVENT_* flags, press count minus one in the high byte
+} KeyLogRecord;
+
+typedef struct {
+  FILE *file;
+  Uint32 baseTime;
+  Uint32 resumeTime; // Recorded time of the first key appended
+  bool started;
+  Uint64 recordCount;
+} KeyLogWriter;
+
+// Replay speed that ignores gaps between keys and never waits
+#define KEYLOG_SPEED_MAX 0.0
+
+typedef struct {
+  void *data; // Whole file, mapped or loaded
+  size_t size;
+  const KeyLogRecord *records;
+  Uint64 recordCount;
+  Uint64 next;       // Index of the next record to deliver
+  double speed;      // Multiple of the recorded speed, or KEYLOG_SPEED_MAX
+  bool started;
+  Uint32 startTime;  // Scene time the replay started at
+  Uint32 skippedMs;  // Recorded time skipped over in KEYLOG_SPEED_MAX mode
+  bool mapped;
+} KeyLogReplay;
+
+// Create a log, or continue an existing one after its last whole record.
+// Returns false for a file that is not a key log of this version.
+bool keyLogWriterOpen(KeyLogWriter *writer, const char *path);
+void keyLogWriterAppend(KeyLogWriter *writer, const KeyEvent *events,
+                        int count);
+void keyLogWriterClose(KeyLogWriter *writer);
+
+bool keyLogReplayOpen(KeyLogReplay *replay, const char *path, double speed);
+void keyLogReplayClose(KeyLogReplay *replay);
+
+// Copy every record due at scene time now into out, stamped with now
+int keyLogReplayPoll(KeyLogReplay *replay, Uint32 now, KeyEvent *out,
+                     int max);
+
+// Milliseconds until the next record is due, or -1 once the log is done
+int keyLogReplayTimeout(const KeyLogReplay *replay, Uint32 now);
+
+bool keyLogReplayDone(const KeyLogReplay *replay);
+
+#endif
@@ -0,0 +1,45 @@
+#include "keysyms.h"
+
+#define KSYM_LABEL(id, label) label,
+static const char *keySymbolLabels[KSYM_COUNT] = {KEY_SYMBOLS(KSYM_LABEL)};
+#undef KSYM_LABEL
+
+const char *keySymbolLabel(KeySymbol symbol) {
+  return keySymbolLabels[symbol < KSYM_COUNT ? symbol : KSYM_UNKNOWN];
+}
+
+const KeySymbolMetrics *keySymbolMetrics(const KeyFontMetrics *metrics,
+                                         KeySymbol symbol) {
+  return &metrics->symbols[symbol < KSYM_COUNT ? symbol : KSYM_UNKNOWN];
+}
+
+bool keySymbolIsModifier(KeySymbol symbol) {
+  return symbol == KSYM_SHIFT || symbol == KSYM_CTRL || symbol == KSYM_ALT ||
+         symbol == KSYM_SUPER || symbol == KSYM_FN;
+}
+
+bool keySymbolIsPrintable(KeySymbol symbol) {
+  const char *label = keySymbolLabel(symbol);
+  return label[0] != '\0' && label[1] == '\0';
+}
+
+bool keySymbolIsMouse(KeySymbol symbol) {
+  return symbol >= KSYM_MOUSE_LEFT && symbol <= KSYM_WHEEL_RIGHT;
+}
+
+int keyCapGlyphWidth(const KeyFontMetrics *metrics, char glyph) {
+  return metrics->capGlyphWidths[(Uint8)glyph];
+}
+
+void keySymbolsMeasure(KeyFontMetrics *metrics, TTF_Font *font) {
+  for (int i = 0; i < KSYM_COUNT; i++) {
+    TTF_SizeText(font, keySymbolLabels[i], &metrics->symbols[i].width,
+                 &metrics->symbols[i].height);
+  }
+
+  const char *glyphs = KEY_CAP_PLUS KEY_CAP_TIMES "0123456789";
+  for (const char *c = glyphs; *c; c++) {
+    char text[2] = {*c, '\0'};
+    TTF_SizeText(font, text, &metrics->capGlyphWidths[(Uint8)*c], NULL);
+  }
+}
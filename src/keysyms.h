@@ -0,0 +1,184 @@
+#ifndef KEYSYMS_H
+#define KEYSYMS_H
+
+#include <stdbool.h>
+
+#ifdef _WIN32
+#include <SDL.h>
+#include <SDL_ttf.h>
+#else
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#endif
+
+// Modifier labels follow the platform's keyboard legends
+#ifdef __APPLE__
+#define KSYM_ALT_LABEL "Opt"
+#define KSYM_SUPER_LABEL "Cmd"
+#else
+#define KSYM_ALT_LABEL "Alt"
+#define KSYM_SUPER_LABEL "Win"
+#endif
+
+// Every key any capture backend can report, with its canonical label.
+// Labels are Latin-1 because they are rendered with TTF_RenderText. Ids are
+// stored in key logs and sent by producers, so new keys go at the end.
+// Mouse buttons and wheel directions come last.
+#define KEY_SYMBOLS(ENTRY)                                                     \
+  ENTRY(UNKNOWN, "?")                                                          \
+  ENTRY(A, "a")                                                                \
+  ENTRY(B, "b")                                                                \
+  ENTRY(C, "c")                                                                \
+  ENTRY(D, "d")                                                                \
+  ENTRY(E, "e")                                                                \
+  ENTRY(F, "f")                                                                \
+  ENTRY(G, "g")                                                                \
+  ENTRY(H, "h")                                                                \
+  ENTRY(I, "i")                                                                \
+  ENTRY(J, "j")                                                                \
+  ENTRY(K, "k")                                                                \
+  ENTRY(L, "l")                                                                \
+  ENTRY(M, "m")                                                                \
+  ENTRY(N, "n")                                                                \
+  ENTRY(O, "o")                                                                \
+  ENTRY(P, "p")                                                                \
+  ENTRY(Q, "q")                                                                \
+  ENTRY(R, "r")                                                                \
+  ENTRY(S, "s")                                                                \
+  ENTRY(T, "t")                                                                \
+  ENTRY(U, "u")                                                                \
+  ENTRY(V, "v")                                                                \
+  ENTRY(W, "w")                                                                \
+  ENTRY(X, "x")                                                                \
+  ENTRY(Y, "y")                                                                \
+  ENTRY(Z, "z")                                                                \
+  ENTRY(0, "0")                                                                \
+  ENTRY(1, "1")                                                                \
+  ENTRY(2, "2")                                                                \
+  ENTRY(3, "3")                                                                \
+  ENTRY(4, "4")                                                                \
+  ENTRY(5, "5")                                                                \
+  ENTRY(6, "6")                                                                \
+  ENTRY(7, "7")                                                                \
+  ENTRY(8, "8")                                                                \
+  ENTRY(9, "9")                                                                \
+  ENTRY(MINUS, "-")                                                            \
+  ENTRY(EQUAL, "=")                                                            \
+  ENTRY(LEFT_BRACKET, "[")                                                     \
+  ENTRY(RIGHT_BRACKET, "]")                                                    \
+  ENTRY(BACKSLASH, "\\")                                                       \
+  ENTRY(SEMICOLON, ";")                                                        \
+  ENTRY(APOSTROPHE, "'")                                                       \
+  ENTRY(GRAVE, "`")                                                            \
+  ENTRY(COMMA, ",")                                                            \
+  ENTRY(PERIOD, ".")                                                           \
+  ENTRY(SLASH, "/")                                                            \
+  ENTRY(SECTION, "\xA7")                                                       \
+  ENTRY(ASTERISK, "*")                                                         \
+  ENTRY(PLUS, "+")                                                             \
+  ENTRY(RETURN, "Return")                                                      \
+  ENTRY(ESC, "Esc")                                                            \
+  ENTRY(BACKSPACE, "Bksp")                                                     \
+  ENTRY(TAB, "Tab")                                                            \
+  ENTRY(SPACE, "Space")                                                        \
+  ENTRY(CAPS, "Caps")                                                          \
+  ENTRY(SHIFT, "Shift")                                                        \
+  ENTRY(CTRL, "Ctrl")                                                          \
+  ENTRY(ALT, KSYM_ALT_LABEL)                                                   \
+  ENTRY(SUPER, KSYM_SUPER_LABEL)                                               \
+  ENTRY(FN, "Fn")                                                              \
+  ENTRY(MENU, "Menu")                                                          \
+  ENTRY(UP, "Up")                                                              \
+  ENTRY(DOWN, "Down")                                                          \
+  ENTRY(LEFT, "Left")                                                          \
+  ENTRY(RIGHT, "Right")                                                        \
+  ENTRY(HOME, "Home")                                                          \
+  ENTRY(END, "End")                                                            \
+  ENTRY(PAGE_UP, "PgUp")                                                       \
+  ENTRY(PAGE_DOWN, "PgDn")                                                     \
+  ENTRY(INSERT, "Ins")                                                         \
+  ENTRY(DELETE, "Del")                                                         \
+  ENTRY(PRINT, "PrtSc")                                                        \
+  ENTRY(SCROLL_LOCK, "Scroll")                                                 \
+  ENTRY(PAUSE, "Pause")                                                        \
+  ENTRY(NUM_LOCK, "Num")                                                       \
+  ENTRY(CLEAR, "Clear")                                                        \
+  ENTRY(F1, "F1")                                                              \
+  ENTRY(F2, "F2")                                                              \
+  ENTRY(F3, "F3")                                                              \
+  ENTRY(F4, "F4")                                                              \
+  ENTRY(F5, "F5")                                                              \
+  ENTRY(F6, "F6")                                                              \
+  ENTRY(F7, "F7")                                                              \
+  ENTRY(F8, "F8")                                                              \
+  ENTRY(F9, "F9")                                                              \
+  ENTRY(F10, "F10")                                                            \
+  ENTRY(F11, "F11")                                                            \
+  ENTRY(F12, "F12")                                                            \
+  ENTRY(F13, "F13")                                                            \
+  ENTRY(F14, "F14")                                                            \
+  ENTRY(F15, "F15")                                                            \
+  ENTRY(F16, "F16")                                                            \
+  ENTRY(F17, "F17")                                                            \
+  ENTRY(F18, "F18")                                                            \
+  ENTRY(F19, "F19")                                                            \
+  ENTRY(F20, "F20")                                                            \
+  ENTRY(F21, "F21")                                                            \
+  ENTRY(F22, "F22")                                                            \
+  ENTRY(F23, "F23")                                                            \
+  ENTRY(F24, "F24")                                                            \
+  ENTRY(MOUSE_LEFT, "LMB")                                                     \
+  ENTRY(MOUSE_RIGHT, "RMB")                                                    \
+  ENTRY(MOUSE_MIDDLE, "MMB")                                                   \
+  ENTRY(MOUSE_BACK, "Mouse4")                                                  \
+  ENTRY(MOUSE_FORWARD, "Mouse5")                                               \
+  ENTRY(WHEEL_UP, "Wheel Up")                                                  \
+  ENTRY(WHEEL_DOWN, "Wheel Down")                                              \
+  ENTRY(WHEEL_LEFT, "Wheel Left")                                              \
+  ENTRY(WHEEL_RIGHT, "Wheel Right")
+
+#define KSYM_ENUM(id, label) KSYM_##id,
+enum { KEY_SYMBOLS(KSYM_ENUM) KSYM_COUNT };
+#undef KSYM_ENUM
+
+// Small integer id of a key; indexes the label and metrics tables
+typedef Uint16 KeySymbol;
+
+// Size of a label in the key font, measured once when the font is loaded
+typedef struct {
+  int width;
+  int height;
+} KeySymbolMetrics;
+
+// Every label and cap glyph measured in one key font. Each output scale has
+// its own, so layout never calls into FreeType.
+typedef struct {
+  KeySymbolMetrics symbols[KSYM_COUNT];
+  int capGlyphWidths[256];
+} KeyFontMetrics;
+
+const char *keySymbolLabel(KeySymbol symbol);
+const KeySymbolMetrics *keySymbolMetrics(const KeyFontMetrics *metrics,
+                                         KeySymbol symbol);
+
+// Modifiers can start a chord such as Ctrl+z
+bool keySymbolIsModifier(KeySymbol symbol);
+
+// Keys that type a character, i.e. whose label is a single glyph
+bool keySymbolIsPrintable(KeySymbol symbol);
+
+// Mouse buttons and wheel directions, KSYM_MOUSE_LEFT to KSYM_WHEEL_RIGHT
+bool keySymbolIsMouse(KeySymbol symbol);
+
+// Extra glyphs drawn on chord caps ("Ctrl+z") and counted caps, where the
+// count follows a Latin-1 multiplication sign
+#define KEY_CAP_PLUS "+"
+#define KEY_CAP_TIMES "\xD7"
+
+// Width of one of the glyphs above or a digit in the key font
+int keyCapGlyphWidth(const KeyFontMetrics *metrics, char glyph);
+
+// Measure every label and cap glyph with a key font
+void keySymbolsMeasure(KeyFontMetrics *metrics, TTF_Font *font);
+
+#endif
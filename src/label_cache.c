@@ -0,0 +1,489 @@
+#include "label_cache.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "pixel_blend.h"
+
+#define INDEX_SIZE (LABEL_CACHE_CAPACITY * 2)
+#define WHITE 0xFFFFFFFFu // Label colour as a premultiplied pixel
+
+static Uint32 hashLabel(TTF_Font *font, const char *text) {
+  // FNV-1a over the text, mixed with the font pointer
+  Uint32 hash = 2166136261u ^ (Uint32)(size_t)font;
+  for (const char *c = text; *c; c++) {
+    hash ^= (Uint8)*c;
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+static int findSlot(const LabelCache *cache, TTF_Font *font, const char *text,
+                    Uint32 hash) {
+  for (int probe = 0; probe < INDEX_SIZE; probe++) {
+    int slot = (hash + probe) % INDEX_SIZE;
+    int entry = cache->index[slot];
+    if (entry < 0) {
+      return slot;
+    }
+    if (cache->entries[entry].font == font &&
+        strcmp(cache->entries[entry].text, text) == 0) {
+      return slot;
+    }
+  }
+  return -1;
+}
+
+// Rebuild the hash index from scratch; only needed after an eviction
+static void rebuildIndex(LabelCache *cache) {
+  for (int i = 0; i < INDEX_SIZE; i++) {
+    cache->index[i] = -1;
+  }
+  for (int i = 0; i < LABEL_CACHE_CAPACITY; i++) {
+    LabelEntry *entry = &cache->entries[i];
+    if (entry->used) {
+      int slot = findSlot(cache, entry->font, entry->text,
+                          hashLabel(entry->font, entry->text));
+      cache->index[slot] = i;
+    }
+  }
+}
+
+// Forget every label and start packing again from an empty atlas
+static void dropLabels(LabelCache *cache) {
+  for (int i = 0; i < LABEL_CACHE_CAPACITY; i++) {
+    if (cache->entries[i].used) {
+      cache->entries[i].used = false;
+      cache->evictions++;
+    }
+  }
+  cache->shelfCount = 0;
+  cache->nextShelfY = 0;
+  cache->failedCount = 0;
+  cache->nextFailed = 0;
+  rebuildIndex(cache);
+}
+
+static bool labelFailed(const LabelCache *cache, TTF_Font *font,
+                        const char *text, Uint32 hash) {
+  for (int i = 0; i < cache->failedCount; i++) {
+    const LabelFailure *failure = &cache->failed[i];
+    if (failure->font == font && failure->hash == hash &&
+        strncmp(failure->text, text, LABEL_TEXT_MAX - 1) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static void rememberFailure(LabelCache *cache, TTF_Font *font,
+                            const char *text, Uint32 hash) {
+  LabelFailure *failure = &cache->failed[cache->nextFailed];
+  failure->font = font;
+  failure->hash = hash;
+  strncpy(failure->text, text, LABEL_TEXT_MAX - 1);
+  failure->text[LABEL_TEXT_MAX - 1] = '\0';
+  cache->nextFailed = (cache->nextFailed + 1) % LABEL_FAILED_MAX;
+  if (cache->failedCount < LABEL_FAILED_MAX) {
+    cache->failedCount++;
+  }
+}
+
+// Largest atlas the renderer can hold that is no larger than atlasSize
+static int clampAtlasSize(SDL_Renderer *renderer, int atlasSize) {
+  SDL_RendererInfo info;
+  if (SDL_GetRendererInfo(renderer, &info) == 0) {
+    if (info.max_texture_width > 0 && atlasSize > info.max_texture_width) {
+      atlasSize = info.max_texture_width;
+    }
+    if (info.max_texture_height > 0 && atlasSize > info.max_texture_height) {
+      atlasSize = info.max_texture_height;
+    }
+  }
+  return atlasSize;
+}
+
+static SDL_Texture *createAtlas(SDL_Renderer *renderer, int atlasSize) {
+  SDL_Texture *atlas =
+      SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888,
+                        SDL_TEXTUREACCESS_STATIC, atlasSize, atlasSize);
+  if (!atlas) {
+    printf("Label atlas could not be created! SDL_Error: %s\n",
+           SDL_GetError());
+    return NULL;
+  }
+  SDL_SetTextureBlendMode(atlas, SDL_BLENDMODE_BLEND);
+  return atlas;
+}
+
+bool labelCacheInit(LabelCache *cache, SDL_Renderer *renderer, int atlasSize) {
+  memset(cache, 0, sizeof(*cache));
+  cache->renderer = renderer;
+  atlasSize = clampAtlasSize(renderer, atlasSize);
+  cache->atlasWidth = atlasSize;
+  cache->atlasHeight = atlasSize;
+
+  cache->atlas = createAtlas(renderer, atlasSize);
+  if (!cache->atlas) {
+    return false;
+  }
+  cache->texturesCreated++;
+
+  for (int i = 0; i < INDEX_SIZE; i++) {
+    cache->index[i] = -1;
+  }
+  return true;
+}
+
+bool labelCacheReserve(LabelCache *cache, int atlasSize) {
+  atlasSize = clampAtlasSize(cache->renderer, atlasSize);
+  if (atlasSize <= cache->atlasWidth && atlasSize <= cache->atlasHeight) {
+    return true;
+  }
+
+  SDL_Texture *atlas = createAtlas(cache->renderer, atlasSize);
+  if (!atlas) {
+    return false;
+  }
+  Uint8 *coverage = NULL;
+  if (cache->coverage) {
+    coverage = SDL_calloc((size_t)atlasSize * atlasSize, 1);
+    if (!coverage) {
+      SDL_DestroyTexture(atlas);
+      return false;
+    }
+    SDL_free(cache->coverage);
+    cache->coverage = coverage;
+  }
+  SDL_DestroyTexture(cache->atlas);
+  cache->atlas = atlas;
+  cache->atlasWidth = atlasSize;
+  cache->atlasHeight = atlasSize;
+  cache->texturesCreated++;
+  dropLabels(cache);
+  return true;
+}
+
+bool labelCacheKeepCoverage(LabelCache *cache) {
+  if (cache->coverage) {
+    return true;
+  }
+  cache->coverage =
+      SDL_calloc((size_t)cache->atlasWidth * cache->atlasHeight, 1);
+  if (!cache->coverage) {
+    printf("Label coverage could not be allocated\n");
+    return false;
+  }
+  // Labels already in the atlas have no coverage; rasterize them again
+  dropLabels(cache);
+  return true;
+}
+
+void labelCacheSetSoftwareTarget(LabelCache *cache, Uint8 *pixels, int pitch,
+                                 int width, int height) {
+  cache->softwarePixels = pixels;
+  cache->softwarePitch = pitch;
+  cache->softwareWidth = width;
+  cache->softwareHeight = height;
+}
+
+void labelCacheDestroy(LabelCache *cache) {
+  if (cache->atlas) {
+    SDL_DestroyTexture(cache->atlas);
+    cache->atlas = NULL;
+  }
+  SDL_free(cache->coverage);
+  cache->coverage = NULL;
+}
+
+bool labelCacheLoadImage(LabelCache *cache, const LabelAtlasImage *image,
+                         TTF_Font *const *fonts) {
+  if (image->width > cache->atlasWidth ||
+      image->height > cache->atlasHeight ||
+      image->shelfCount > LABEL_MAX_SHELVES ||
+      image->entryCount > LABEL_CACHE_CAPACITY || image->height <= 0) {
+    return false;
+  }
+
+  // Expand coverage to white ARGB and upload the whole image at once
+  Uint64 rasterStart = SDL_GetPerformanceCounter();
+  int pixelCount = image->width * image->height;
+  Uint32 *pixels = SDL_malloc(pixelCount * sizeof(Uint32));
+  if (!pixels) {
+    return false;
+  }
+  for (int i = 0; i < pixelCount; i++) {
+    pixels[i] = (Uint32)image->alpha[i] << 24 | 0x00FFFFFF;
+  }
+  SDL_Rect rect = {0, 0, image->width, image->height};
+  int uploaded = SDL_UpdateTexture(cache->atlas, &rect, pixels,
+                                   image->width * (int)sizeof(Uint32));
+  SDL_free(pixels);
+  if (uploaded < 0) {
+    return false;
+  }
+  if (cache->coverage) {
+    for (int y = 0; y < image->height; y++) {
+      memcpy(cache->coverage + y * cache->atlasWidth,
+             image->alpha + y * image->width, image->width);
+    }
+  }
+  cache->rasterTicks += SDL_GetPerformanceCounter() - rasterStart;
+
+  cache->shelfCount = image->shelfCount;
+  cache->nextShelfY = 0;
+  cache->failedCount = 0;
+  cache->nextFailed = 0;
+  for (int i = 0; i < image->shelfCount; i++) {
+    const LabelImageShelf *source = &image->shelves[i];
+    LabelShelf *shelf = &cache->shelves[i];
+    shelf->y = source->y;
+    shelf->height = source->height;
+    shelf->nextX = source->nextX;
+    shelf->lastUsedFrame = cache->frame;
+    int bottom = shelf->y + shelf->height + LABEL_SHELF_PADDING;
+    cache->nextShelfY = bottom > cache->nextShelfY ? bottom : cache->nextShelfY;
+  }
+
+  for (int i = 0; i < image->entryCount; i++) {
+    const LabelImageEntry *source = &image->entries[i];
+    LabelEntry *entry = &cache->entries[i];
+    entry->font = fonts[source->font];
+    strncpy(entry->text, source->text, LABEL_TEXT_MAX - 1);
+    entry->text[LABEL_TEXT_MAX - 1] = '\0';
+    entry->rect = source->rect;
+    entry->shelf = source->shelf;
+    entry->lastUsedFrame = cache->frame;
+    entry->used = true;
+  }
+  rebuildIndex(cache);
+  return true;
+}
+
+void labelCacheBeginFrame(LabelCache *cache) { cache->frame++; }
+
+// Drop every label packed into a shelf and make the row reusable
+static void evictShelf(LabelCache *cache, int shelf) {
+  for (int i = 0; i < LABEL_CACHE_CAPACITY; i++) {
+    if (cache->entries[i].used && cache->entries[i].shelf == shelf) {
+      cache->entries[i].used = false;
+      cache->evictions++;
+    }
+  }
+  cache->shelves[shelf].nextX = 0;
+  rebuildIndex(cache);
+}
+
+// Find room for a w x h label, evicting the least recently used row if the
+// atlas is full. Returns the shelf index or -1 if the label can never fit.
+static int allocateRect(LabelCache *cache, int w, int h, SDL_Rect *out) {
+  if (w > cache->atlasWidth || h > cache->atlasHeight) {
+    return -1;
+  }
+
+  // Best fit among existing shelves that are tall enough
+  int best = -1;
+  for (int i = 0; i < cache->shelfCount; i++) {
+    LabelShelf *shelf = &cache->shelves[i];
+    if (shelf->height >= h && shelf->nextX + w <= cache->atlasWidth &&
+        (best < 0 || shelf->height < cache->shelves[best].height)) {
+      best = i;
+    }
+  }
+
+  // Open a new shelf below the last one
+  if (best < 0 && cache->shelfCount < LABEL_MAX_SHELVES &&
+      cache->nextShelfY + h <= cache->atlasHeight) {
+    best = cache->shelfCount++;
+    cache->shelves[best].y = cache->nextShelfY;
+    cache->shelves[best].height = h;
+    cache->shelves[best].nextX = 0;
+    cache->nextShelfY += h + LABEL_SHELF_PADDING;
+  }
+
+  // Atlas is full: recycle the stalest shelf that is tall enough
+  if (best < 0) {
+    for (int i = 0; i < cache->shelfCount; i++) {
+      LabelShelf *shelf = &cache->shelves[i];
+      if (shelf->height >= h && shelf->lastUsedFrame != cache->frame &&
+          (best < 0 ||
+           shelf->lastUsedFrame < cache->shelves[best].lastUsedFrame)) {
+        best = i;
+      }
+    }
+    if (best < 0) {
+      return -1;
+    }
+    evictShelf(cache, best);
+  }
+
+  LabelShelf *shelf = &cache->shelves[best];
+  out->x = shelf->nextX;
+  out->y = shelf->y;
+  out->w = w;
+  out->h = h;
+  shelf->nextX += w + LABEL_SHELF_PADDING;
+  return best;
+}
+
+// Pick a free entry slot, or the least recently used label to evict once
+// its replacement has room in the atlas. Returns -1 if every label is in
+// use this frame.
+static int pickEntry(const LabelCache *cache) {
+  int oldest = -1;
+  for (int i = 0; i < LABEL_CACHE_CAPACITY; i++) {
+    if (!cache->entries[i].used) {
+      return i;
+    }
+    if (cache->entries[i].lastUsedFrame != cache->frame &&
+        (oldest < 0 || cache->entries[i].lastUsedFrame <
+                           cache->entries[oldest].lastUsedFrame)) {
+      oldest = i;
+    }
+  }
+  return oldest;
+}
+
+const LabelEntry *labelCacheGet(LabelCache *cache, TTF_Font *font,
+                                const char *text) {
+  if (!text || !text[0]) {
+    return NULL;
+  }
+
+  Uint32 hash = hashLabel(font, text);
+  int slot = findSlot(cache, font, text, hash);
+  if (slot >= 0 && cache->index[slot] >= 0) {
+    LabelEntry *entry = &cache->entries[cache->index[slot]];
+    entry->lastUsedFrame = cache->frame;
+    cache->shelves[entry->shelf].lastUsedFrame = cache->frame;
+    cache->hits++;
+    return entry;
+  }
+
+  cache->misses++;
+  int entryIndex = pickEntry(cache);
+  if (entryIndex < 0 || labelFailed(cache, font, text, hash)) {
+    return NULL;
+  }
+
+  // Rasterize once with FreeType
+  Uint64 rasterStart = SDL_GetPerformanceCounter();
+  SDL_Color white = {255, 255, 255, 255};
+  SDL_Surface *surface = TTF_RenderText_Blended(font, text, white);
+  if (!surface) {
+    return NULL;
+  }
+  if (surface->format->format != SDL_PIXELFORMAT_ARGB8888) {
+    SDL_Surface *converted =
+        SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_ARGB8888, 0);
+    SDL_FreeSurface(surface);
+    if (!converted) {
+      return NULL;
+    }
+    surface = converted;
+  }
+  cache->rasterTicks += SDL_GetPerformanceCounter() - rasterStart;
+
+  if (surface->w > cache->atlasWidth || surface->h > cache->atlasHeight) {
+    rememberFailure(cache, font, text, hash);
+  }
+  SDL_Rect rect;
+  int shelf = allocateRect(cache, surface->w, surface->h, &rect);
+  if (shelf < 0) {
+    SDL_FreeSurface(surface);
+    return NULL;
+  }
+  if (cache->entries[entryIndex].used) {
+    // Only now that the new label has room is the old one let go. Its
+    // atlas space stays allocated until its shelf is recycled.
+    cache->entries[entryIndex].used = false;
+    cache->evictions++;
+    rebuildIndex(cache);
+  }
+
+  SDL_UpdateTexture(cache->atlas, &rect, surface->pixels, surface->pitch);
+  if (cache->coverage) {
+    // The text is white, so alpha is all there is to keep
+    for (int y = 0; y < rect.h; y++) {
+      const Uint32 *row =
+          (const Uint32 *)((const Uint8 *)surface->pixels +
+                           y * surface->pitch);
+      Uint8 *out = cache->coverage + (rect.y + y) * cache->atlasWidth + rect.x;
+      for (int x = 0; x < rect.w; x++) {
+        out[x] = (Uint8)(row[x] >> 24);
+      }
+    }
+  }
+  SDL_FreeSurface(surface);
+
+  LabelEntry *entry = &cache->entries[entryIndex];
+  entry->font = font;
+  strncpy(entry->text, text, LABEL_TEXT_MAX - 1);
+  entry->text[LABEL_TEXT_MAX - 1] = '\0';
+  entry->rect = rect;
+  entry->shelf = shelf;
+  entry->lastUsedFrame = cache->frame;
+  entry->used = true;
+  cache->shelves[shelf].lastUsedFrame = cache->frame;
+
+  // Evictions above may have reshuffled the index, so probe again
+  slot = findSlot(cache, font, entry->text, hashLabel(font, entry->text));
+  cache->index[slot] = entryIndex;
+  return entry;
+}
+
+// Blend a label's coverage into the software target at (x, y), clipped to
+// it. Positions are rounded down to whole pixels.
+static void drawSoftware(LabelCache *cache, const SDL_Rect *rect, float x,
+                         float y, Uint8 alpha) {
+  int left = (int)SDL_floorf(x);
+  int top = (int)SDL_floorf(y);
+  int skipX = left < 0 ? -left : 0;
+  int skipY = top < 0 ? -top : 0;
+  int width = rect->w - skipX;
+  int height = rect->h - skipY;
+  if (left + skipX + width > cache->softwareWidth) {
+    width = cache->softwareWidth - left - skipX;
+  }
+  if (top + skipY + height > cache->softwareHeight) {
+    height = cache->softwareHeight - top - skipY;
+  }
+  if (width <= 0 || height <= 0) {
+    return;
+  }
+  pixelBlendCoverage(cache->softwarePixels +
+                         (top + skipY) * cache->softwarePitch +
+                         (left + skipX) * 4,
+                     cache->softwarePitch,
+                     cache->coverage + (rect->y + skipY) * cache->atlasWidth +
+                         rect->x + skipX,
+                     cache->atlasWidth, width, height, WHITE, alpha);
+}
+
+int labelCacheDraw(LabelCache *cache, TTF_Font *font, const char *text,
+                   float x, float y, Uint8 alpha) {
+  const LabelEntry *entry = labelCacheGet(cache, font, text);
+  if (!entry) {
+    return 0;
+  }
+  if (cache->softwarePixels && cache->coverage) {
+    drawSoftware(cache, &entry->rect, x, y, alpha);
+    cache->draws++;
+    return entry->rect.w;
+  }
+  SDL_FRect dst = {x, y, (float)entry->rect.w, (float)entry->rect.h};
+  SDL_SetTextureAlphaMod(cache->atlas, alpha);
+  SDL_RenderCopyF(cache->renderer, cache->atlas, &entry->rect, &dst);
+  cache->draws++;
+  return entry->rect.w;
+}
+
+void labelCachePrintStats(const LabelCache *cache) {
+  Uint64 lookups = cache->hits + cache->misses;
+  double hitRate = lookups > 0 ? 100.0 * (double)cache->hits / lookups : 0.0;
+  printf("Label cache: %llu hits, %llu misses (%.2f%% hit rate), %llu "
+         "evictions, %llu textures created\n",
+         (unsigned long long)cache->hits, (unsigned long long)cache->misses,
+         hitRate, (unsigned long long)cache->evictions,
+         (unsigned long long)cache->texturesCreated);
+}
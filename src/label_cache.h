@@ -0,0 +1,153 @@
+#ifndef LABEL_CACHE_H
+#define LABEL_CACHE_H
+
+#include <stdbool.h>
+
+#ifdef _WIN32
+#include <SDL.h>
+#include <SDL_ttf.h>
+#else
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#endif
+
+#define LABEL_ATLAS_SIZE 1024    // Atlas side for labels at scale 1
+#define LABEL_CACHE_CAPACITY 256 // Maximum number of cached labels
+#define LABEL_MAX_SHELVES 64     // Maximum number of packing rows
+#define LABEL_SHELF_PADDING 1    // Transparent gap between packed labels
+#define LABEL_TEXT_MAX 32
+#define LABEL_FAILED_MAX 16      // Labels remembered as too large to cache
+
+// A rasterized label living somewhere inside the atlas texture
+typedef struct {
+  TTF_Font *font;
+  char text[LABEL_TEXT_MAX];
+  SDL_Rect rect; // Location of the label inside the atlas
+  int shelf;     // Row the label was packed into
+  Uint32 lastUsedFrame;
+  bool used;
+} LabelEntry;
+
+// A label that cannot fit into the atlas, so it is not rasterized again
+typedef struct {
+  TTF_Font *font;
+  Uint32 hash;
+  char text[LABEL_TEXT_MAX]; // Truncated like LabelEntry.text
+} LabelFailure;
+
+// A horizontal row of the atlas; labels are packed left to right
+typedef struct {
+  int y;
+  int height;
+  int nextX;
+  Uint32 lastUsedFrame;
+} LabelShelf;
+
+// Labels rasterized ahead of time (at build time) and packed into shelves
+// the way the cache packs them. The text is white, so only coverage is
+// stored.
+typedef struct {
+  int font; // Index into the fonts the image is loaded with
+  const char *text;
+  SDL_Rect rect;
+  int shelf;
+} LabelImageEntry;
+
+typedef struct {
+  int y;
+  int height;
+  int nextX;
+} LabelImageShelf;
+
+typedef struct {
+  int width;
+  int height;
+  const Uint8 *alpha; // width * height coverage values, row by row
+  const LabelImageShelf *shelves;
+  int shelfCount;
+  const LabelImageEntry *entries;
+  int entryCount;
+} LabelAtlasImage;
+
+typedef struct {
+  SDL_Renderer *renderer;
+  SDL_Texture *atlas;
+  int atlasWidth;
+  int atlasHeight;
+
+  LabelShelf shelves[LABEL_MAX_SHELVES];
+  int shelfCount;
+  int nextShelfY;
+
+  LabelEntry entries[LABEL_CACHE_CAPACITY];
+  int index[LABEL_CACHE_CAPACITY * 2]; // Open-addressed hash of entry slots
+
+  Uint32 frame;
+
+  // Labels larger than the atlas, oldest overwritten first. Forgotten
+  // whenever the atlas is rebuilt.
+  LabelFailure failed[LABEL_FAILED_MAX];
+  int failedCount;
+  int nextFailed;
+
+  // CPU copy of the atlas coverage, atlasWidth bytes per row, kept once
+  // labelCacheKeepCoverage is called
+  Uint8 *coverage;
+
+  // Premultiplied RGBA32 pixels labelCacheDraw blends into instead of
+  // drawing through the renderer, when set
+  Uint8 *softwarePixels;
+  int softwarePitch;
+  int softwareWidth;
+  int softwareHeight;
+
+  // Counters
+  Uint64 hits;
+  Uint64 misses;
+  Uint64 evictions;
+  Uint64 texturesCreated;
+  Uint64 draws;       // Label blits issued
+  Uint64 rasterTicks; // Performance counter ticks spent rasterizing misses
+} LabelCache;
+
+// Create an atlasSize squared atlas, or as large as the renderer allows
+bool labelCacheInit(LabelCache *cache, SDL_Renderer *renderer, int atlasSize);
+void labelCacheDestroy(LabelCache *cache);
+
+// Make the atlas at least atlasSize squared, e.g. for labels rasterized at a
+// larger scale. Growing drops every cached label. Returns false, keeping the
+// old atlas, if the new one cannot be created.
+bool labelCacheReserve(LabelCache *cache, int atlasSize);
+
+// Also keep every label's coverage in memory, so labels can be drawn into
+// software pixels. Drops the labels cached so far. Returns false if the
+// copy cannot be allocated.
+bool labelCacheKeepCoverage(LabelCache *cache);
+
+// Draw labels into width x height premultiplied RGBA32 pixels (see
+// pixel_blend.h) instead of through the renderer, or through the renderer
+// again if pixels is NULL. Needs labelCacheKeepCoverage.
+void labelCacheSetSoftwareTarget(LabelCache *cache, Uint8 *pixels, int pitch,
+                                 int width, int height);
+
+// Fill a freshly created cache from a pre-rasterized image in one upload;
+// fonts[i] is the font of entries with font i. Returns false, leaving the
+// cache empty, if the image does not fit.
+bool labelCacheLoadImage(LabelCache *cache, const LabelAtlasImage *image,
+                         TTF_Font *const *fonts);
+
+// Advance the frame stamp used for least-recently-used eviction
+void labelCacheBeginFrame(LabelCache *cache);
+
+// Look up a label, rasterizing it into the atlas on a miss
+const LabelEntry *labelCacheGet(LabelCache *cache, TTF_Font *font,
+                                const char *text);
+
+// Blit a cached label at (x, y) with the given alpha; returns the label width.
+// Fractional positions are kept so scrolling text moves smoothly.
+int labelCacheDraw(LabelCache *cache, TTF_Font *font, const char *text,
+                   float x, float y, Uint8 alpha);
+
+void labelCachePrintStats(const LabelCache *cache);
+
+#endif
@@ -0,0 +1,96 @@
+#include "latency.h"
+
+#include <stdio.h>
+
+#define SUB_COUNT (1 << LATENCY_SUB_BITS)
+
+typedef struct {
+  SDL_atomic_t buckets[LATENCY_BUCKETS];
+  SDL_atomic_t maxUs;
+} LatencyHistogram;
+
+static LatencyHistogram histograms[LATENCY_STAGE_COUNT];
+
+static const char *stageNames[LATENCY_STAGE_COUNT] = {
+    "dequeue",
+    "layout",
+    "submit",
+    "present",
+};
+
+static int bucketFor(Uint32 us) {
+  if (us < SUB_COUNT) {
+    return (int)us;
+  }
+  int exponent = 31;
+  while (!(us & (1u << exponent))) {
+    exponent--;
+  }
+  int sub = (int)(us >> (exponent - LATENCY_SUB_BITS)) & (SUB_COUNT - 1);
+  int bucket = SUB_COUNT + (exponent - LATENCY_SUB_BITS) * SUB_COUNT + sub;
+  return bucket < LATENCY_BUCKETS ? bucket : LATENCY_BUCKETS - 1;
+}
+
+// Largest value that lands in a bucket, so percentiles never under-report
+static Uint32 bucketLimit(int bucket) {
+  if (bucket < SUB_COUNT) {
+    return (Uint32)bucket;
+  }
+  int exponent = (bucket - SUB_COUNT) / SUB_COUNT + LATENCY_SUB_BITS;
+  int sub = (bucket - SUB_COUNT) % SUB_COUNT;
+  return ((Uint32)(SUB_COUNT + sub + 1) << (exponent - LATENCY_SUB_BITS)) - 1;
+}
+
+void latencyRecord(LatencyStage stage, Uint64 captureTicks, Uint64 now) {
+  Uint64 ticks = now > captureTicks ? now - captureTicks : 0;
+  Uint64 us = ticks * 1000000 / SDL_GetPerformanceFrequency();
+  if (us > 0x7FFFFFFF) {
+    us = 0x7FFFFFFF;
+  }
+
+  LatencyHistogram *histogram = &histograms[stage];
+  SDL_AtomicAdd(&histogram->buckets[bucketFor((Uint32)us)], 1);
+
+  int seen = SDL_AtomicGet(&histogram->maxUs);
+  while ((int)us > seen &&
+         !SDL_AtomicCAS(&histogram->maxUs, seen, (int)us)) {
+    seen = SDL_AtomicGet(&histogram->maxUs);
+  }
+}
+
+static Uint32 percentile(const int *buckets, int count, double p) {
+  int rank = (int)(p * count + 0.5);
+  if (rank < 1) {
+    rank = 1;
+  }
+  int seen = 0;
+  for (int i = 0; i < LATENCY_BUCKETS; i++) {
+    seen += buckets[i];
+    if (seen >= rank) {
+      return bucketLimit(i);
+    }
+  }
+  return bucketLimit(LATENCY_BUCKETS - 1);
+}
+
+void latencyPrint(void) {
+  printf("Key latency from OS capture (us):\n");
+  for (int stage = 0; stage < LATENCY_STAGE_COUNT; stage++) {
+    // Snapshot the buckets; concurrent records may land in either half
+    int buckets[LATENCY_BUCKETS];
+    int count = 0;
+    for (int i = 0; i < LATENCY_BUCKETS; i++) {
+      buckets[i] = SDL_AtomicGet(&histograms[stage].buckets[i]);
+      count += buckets[i];
+    }
+    if (count == 0) {
+      printf("  %-8s no samples\n", stageNames[stage]);
+      continue;
+    }
+    printf("  %-8s n=%d p50<=%u p90<=%u p99<=%u max=%d\n", stageNames[stage],
+           count, (unsigned)percentile(buckets, count, 0.50),
+           (unsigned)percentile(buckets, count, 0.90),
+           (unsigned)percentile(buckets, count, 0.99),
+           SDL_AtomicGet(&histograms[stage].maxUs));
+  }
+}
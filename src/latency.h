@@ -0,0 +1,33 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#ifdef _WIN32
+#include <SDL.h>
+#else
+#include <SDL2/SDL.h>
+#endif
+
+// Points in the pipeline where a key's age is sampled. Every stage is
+// measured from the OS capture timestamp, so PRESENT is input-to-photon
+// (up to the compositor and display scanout).
+typedef enum {
+  LATENCY_DEQUEUE, // Drained from the capture ring for layout
+  LATENCY_LAYOUT,  // Added to the key line
+  LATENCY_SUBMIT,  // Draw calls for the frame showing it were issued
+  LATENCY_PRESENT, // SDL_RenderPresent returned for that frame
+  LATENCY_STAGE_COUNT
+} LatencyStage;
+
+// Log-linear microsecond buckets: exact below 8 us, then 8 per power of two
+// (12.5% resolution) up to 2^31 us
+#define LATENCY_SUB_BITS 3
+#define LATENCY_BUCKETS 240
+
+// Record how long ago (in performance counter ticks) a key was captured.
+// Lock-free, so any thread may record while another dumps.
+void latencyRecord(LatencyStage stage, Uint64 captureTicks, Uint64 now);
+
+// Print count, p50/p90/p99 and max for every stage
+void latencyPrint(void);
+
+#endif
@@ -3,6 +3,7 @@
 #define SDL_MAIN_HANDLED
 #endif
 
+#include <signal.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
@@ -14,6 +15,7 @@
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_ttf.h>
 #include <dispatch/dispatch.h>
+#include <mach/mach_time.h>
 #endif
 
 #ifdef _WIN32
@@ -28,137 +30,401 @@
 #include <SDL2/SDL_ttf.h>
 #endif
 
-#define WINDOW_WIDTH 1280
-#define WINDOW_HEIGHT 720
-#define MAX_KEYS 64         // Increased to handle more keys
-#define FADE_DURATION 2000  // Time in milliseconds for keys to fade out
-#define KEY_GAP 4           // 4 pixel gap between keys
-#define FONT_SIZE 36        // Larger text size
-#define BUTTON_FONT_SIZE 18 // Smaller font size for button
-#define LEFT_MARGIN 50      // Left margin for alignment
-#define RIGHT_MARGIN 50     // Right margin for alignment
-#define MAX_WIDTH (WINDOW_WIDTH - LEFT_MARGIN - RIGHT_MARGIN)
-#define BUTTON_WIDTH 160 // Width of the toggle button (wider for monospaced font)
-#define BUTTON_HEIGHT 40 // Height of the toggle button
-
-typedef struct {
-  char text[32];
-  int width;
-  int height;
-  bool active;
-} KeyDisplay;
-
-typedef struct {
-  SDL_Rect rect;
-  char text[32];
-  bool hovered;
-  bool pressed;
-} Button;
-
-KeyDisplay keyDisplays[MAX_KEYS];
-int activeKeyCount = 0;
-Uint32 lastKeyPressTime = 0;
-int currentLineWidth = 0;    // Track the current line width
-TTF_Font *font = NULL;       // Global font variable
-TTF_Font *buttonFont = NULL; // Font for button text
+#include "capture_evdev.h"
+#include "capture_x11.h"
+#include "frame_pacer.h"
+#include "headless.h"
+#include "key_coalesce.h"
+#include "key_ring.h"
+#include "keylog.h"
+#include "keysyms.h"
+#include "label_cache.h"
+#include "latency.h"
+#include "mouse_aggregate.h"
+#include "net_input.h"
+#include "profiler.h"
+#include "scene.h"
+#include "scene_clock.h"
+#include "scene_fonts.h"
+#include "scene_json.h"
+#include "scene_view.h"
+#include "shm_output.h"
+#include "snapshot_buffer.h"
+#include "usage_stats.h"
+#include "ws_output.h"
+
+#define STATS_INTERVAL 5000 // Milliseconds between --stats reports
+#define LATENCY_POLL_INTERVAL 1000 // Idle check for latency dump requests
+
 bool shouldQuit = false;     // Global flag for quitting
-bool rightAligned = false;   // Flag for right-to-left alignment
-Button toggleButton;         // Toggle button for alignment
+KeyRing captureRing;         // Key events from the capture thread
+KeyRing netRing;             // Key events from external producers
+Uint32 wakeEventType;        // SDL event posted to wake an idle main loop
+bool needsRedraw = false;    // Set when the scene changed outside a fade
+bool showStats = false;      // Print wakeup and frame rates periodically
+Profiler profiler;           // Frame timings for the F3 debug HUD
+
+// Animation frame pacing
+double targetFps = 0.0;    // --fps; 0 = the display's refresh rate
+bool presentVsync = false; // SDL_RenderPresent waits for the display
+FramePacer framePacer;
+
+// Key line simulation thread, handing snapshots to the render loop
+SnapshotBuffer sceneSnapshots;
+SDL_sem *simWake = NULL;   // Wakes a sleeping simulation thread
+SDL_atomic_t simQuit;      // Set to stop the simulation thread
+SDL_atomic_t alignToggles; // Toggle button clicks not yet applied
+Uint64 snapshotSequence = 0;
+
+// Output canvas; the key line follows the render side's through pendingLayout
+int canvasWidth = WINDOW_WIDTH;
+int canvasHeight = WINDOW_HEIGHT;
+float canvasScale = 0.0f; // 0 = follow the canvas height
+Uint64 startupTicks = 0;  // Performance counter when main started
+bool firstFramePresented = false;
+SDL_SpinLock layoutLock;  // Guards pendingLayout
+SceneLayout pendingLayout;
+SDL_atomic_t layoutChanged; // Set when pendingLayout is new
+
+// Extra views of the same keys, drawn after the canvas with its renderer
+SceneView views[SCENE_VIEW_MAX];
+int viewCount = 0;
+
+// Input-to-photon latency
+bool showLatency = false; // Print the latency histograms on exit
+volatile sig_atomic_t latencyDumpRequested = 0; // Set by SIGUSR1
+KeyRing layoutRing;      // Keys laid out but not yet drawn, oldest first
+Uint64 keysLaidOut = 0;  // Keys pushed to layoutRing (simulation side)
+Uint64 keysDrawn = 0;    // Keys taken from layoutRing (render side)
+KeyEvent frameKeys[KEY_RING_CAPACITY]; // Keys first drawn by this frame
+int frameKeyCount = 0;
+Uint64 drawnSequence = 0; // Snapshot drawn by the last frame
+
+// Burst coalescing into counted key caps
+bool coalesceKeys = true;
+bool coalesceChords = false; // Also join modifiers and repeated chords
+Uint32 coalesceWindow = KEY_COALESCE_DEFAULT_WINDOW;
+KeyCoalescer keyCoalescer;
+
+// Mouse buttons and wheel, folded on the capture thread
+bool captureMouse = false;
+MouseAggregator mouseAggregator;
+
+// Headless (offscreen) rendering options
+bool headless = false;               // Render to memory instead of a window
+double headlessFps = 60.0;           // Virtual clock frame rate
+double headlessSpeed = 1.0;          // Multiple of real time; 0 = unthrottled
+Uint64 headlessFrameLimit = 0;       // Stop after this many frames; 0 = never
+const char *headlessOutputPath = NULL; // Raw RGBA frame dump, if any
+
+// Keystroke recording and replay
+const char *recordPath = NULL; // Append every key to this log
+const char *replayPath = NULL; // Feed keys from this log
+double replaySpeed = 1.0;      // Multiple of recorded speed, or max
+KeyLogWriter keyLogWriter;
+KeyLogReplay keyLogReplay;
+bool recording = false;
+bool replaying = false;
+
+// Persistent per-key usage statistics
+const char *usageStatsPath = NULL; // Counter file kept across runs
+UsageStats usageStats;
+bool countingUsage = false;
+
+#ifndef _WIN32
+const char *shmOutputName = NULL; // Shared memory frame ring, if any
+int shmOutputSlots = SHM_FRAMES_DEFAULT_SLOTS;
+ShmOutput shmOutput;
+
+// External key producers
+const char *listenPath = NULL; // Unix domain socket to accept them on
+int listenPort = 0;            // Loopback TCP port; 0 = none
+bool netListening = false;
+
+// Browser-source overlays
+int wsPort = 0;                // Loopback port for WebSocket clients; 0 = none
+const char *wsOrigin = NULL;   // Extra web origin allowed to connect
+bool wsStreaming = false;
+Uint64 wsFrame = 0;            // Messages published
+Uint64 wsSentSequence = 0;     // Snapshot in the last message
+Uint8 wsSentAlpha = 0;         // Fade in the last message
+char wsMessage[WS_MESSAGE_MAX];
+
+// Publish each finished headless frame to the shared memory ring
+void publishShmFrame(const SDL_Surface *frame, Uint64 frameIndex,
+                     void *userdata) {
+  shmOutputPublish((ShmOutput *)userdata, frame);
+}
+#endif
 
 // Windows-specific global variables
 #ifdef _WIN32
 HHOOK g_hHook = NULL;
+HHOOK g_hMouseHook = NULL;
+UINT_PTR g_mouseFlushTimer = 0; // Hook thread timer for folded mouse input
 HANDLE g_hThread = NULL;
 HWND g_hwnd = NULL;
 
-// Helper to convert virtual key to readable key name using GetKeyNameText
-void push_sdl_keyevent_from_vk(WPARAM vkCode, LPARAM lParam) {
-    char keyName[64] = {0};
-    // Normalize common modifiers and special keys by VK code
-    switch (vkCode) {
-        case 0xA0: // VK_LSHIFT
-        case 0xA1: // VK_RSHIFT
-            strcpy(keyName, "Shift");
-            break;
-        case 0xA2: // VK_LCONTROL
-        case 0xA3: // VK_RCONTROL
-            strcpy(keyName, "Ctrl");
-            break;
-        case 0xA4: // VK_LMENU (Alt)
-        case 0xA5: // VK_RMENU (Alt)
-            strcpy(keyName, "Alt");
-            break;
-        case 0x5B: // VK_LWIN
-        case 0x5C: // VK_RWIN
-            strcpy(keyName, "Win");
-            break;
-        case 0x14: // VK_CAPITAL
-            strcpy(keyName, "Caps");
-            break;
-        case 0x09: // VK_TAB
-            strcpy(keyName, "Tab");
-            break;
-        case 0x0D: // VK_RETURN
-            strcpy(keyName, "Return");
-            break;
-        case 0x1B: // VK_ESCAPE
-            strcpy(keyName, "Esc");
-            break;
-        case 0x08: // VK_BACK
-            strcpy(keyName, "Bksp");
-            break;
-        case 0x20: // VK_SPACE
-            strcpy(keyName, "Space");
-            break;
-        default: {
-            UINT scanCode = ((KBDLLHOOKSTRUCT*)lParam)->scanCode;
-            LONG lParamKey = (scanCode << 16);
-            if (((KBDLLHOOKSTRUCT*)lParam)->flags & LLKHF_EXTENDED) {
-                lParamKey |= (1 << 24);
-            }
-            int len = GetKeyNameTextA(lParamKey, keyName, sizeof(keyName));
-            if (len <= 0) {
-                snprintf(keyName, sizeof(keyName), "VK_%02X", (unsigned int)vkCode);
-            } else {
-                // Robust normalization: check for any left/right or synonyms
-                if (strstr(keyName, "Shift") || strstr(keyName, "shift")) strcpy(keyName, "Shift");
-                else if (strstr(keyName, "Control") || strstr(keyName, "Ctrl") || strstr(keyName, "control") || strstr(keyName, "ctrl")) strcpy(keyName, "Ctrl");
-                else if (strstr(keyName, "Alt") || strstr(keyName, "alt")) strcpy(keyName, "Alt");
-                else if (strstr(keyName, "Win") || strstr(keyName, "win") || strstr(keyName, "Windows") || strstr(keyName, "windows")) strcpy(keyName, "Win");
-            }
-        }
-    }
-    // Post to SDL event loop
-    char *keyCopy = _strdup(keyName);
-    SDL_Event sdlEvent;
-    sdlEvent.type = SDL_USEREVENT;
-    sdlEvent.user.code = 1;
-    sdlEvent.user.data1 = keyCopy;
-    sdlEvent.user.data2 = NULL;
-    SDL_PushEvent(&sdlEvent);
+// Virtual-key code to key symbol; codes left out map to KSYM_UNKNOWN
+static const KeySymbol vkKeyMap[256] = {
+    [0x08] = KSYM_BACKSPACE, // VK_BACK
+    [0x09] = KSYM_TAB, // VK_TAB
+    [0x0C] = KSYM_CLEAR, // VK_CLEAR
+    [0x0D] = KSYM_RETURN, // VK_RETURN
+    [0x10] = KSYM_SHIFT, // VK_SHIFT
+    [0x11] = KSYM_CTRL, // VK_CONTROL
+    [0x12] = KSYM_ALT, // VK_MENU
+    [0x13] = KSYM_PAUSE, // VK_PAUSE
+    [0x14] = KSYM_CAPS, // VK_CAPITAL
+    [0x1B] = KSYM_ESC, // VK_ESCAPE
+    [0x20] = KSYM_SPACE, // VK_SPACE
+    [0x21] = KSYM_PAGE_UP, // VK_PRIOR
+    [0x22] = KSYM_PAGE_DOWN, // VK_NEXT
+    [0x23] = KSYM_END, // VK_END
+    [0x24] = KSYM_HOME, // VK_HOME
+    [0x25] = KSYM_LEFT, // VK_LEFT
+    [0x26] = KSYM_UP, // VK_UP
+    [0x27] = KSYM_RIGHT, // VK_RIGHT
+    [0x28] = KSYM_DOWN, // VK_DOWN
+    [0x2C] = KSYM_PRINT, // VK_SNAPSHOT
+    [0x2D] = KSYM_INSERT, // VK_INSERT
+    [0x2E] = KSYM_DELETE, // VK_DELETE
+    [0x30] = KSYM_0, // '0'
+    [0x31] = KSYM_1, // '1'
+    [0x32] = KSYM_2, // '2'
+    [0x33] = KSYM_3, // '3'
+    [0x34] = KSYM_4, // '4'
+    [0x35] = KSYM_5, // '5'
+    [0x36] = KSYM_6, // '6'
+    [0x37] = KSYM_7, // '7'
+    [0x38] = KSYM_8, // '8'
+    [0x39] = KSYM_9, // '9'
+    [0x41] = KSYM_A, // 'A'
+    [0x42] = KSYM_B, // 'B'
+    [0x43] = KSYM_C, // 'C'
+    [0x44] = KSYM_D, // 'D'
+    [0x45] = KSYM_E, // 'E'
+    [0x46] = KSYM_F, // 'F'
+    [0x47] = KSYM_G, // 'G'
+    [0x48] = KSYM_H, // 'H'
+    [0x49] = KSYM_I, // 'I'
+    [0x4A] = KSYM_J, // 'J'
+    [0x4B] = KSYM_K, // 'K'
+    [0x4C] = KSYM_L, // 'L'
+    [0x4D] = KSYM_M, // 'M'
+    [0x4E] = KSYM_N, // 'N'
+    [0x4F] = KSYM_O, // 'O'
+    [0x50] = KSYM_P, // 'P'
+    [0x51] = KSYM_Q, // 'Q'
+    [0x52] = KSYM_R, // 'R'
+    [0x53] = KSYM_S, // 'S'
+    [0x54] = KSYM_T, // 'T'
+    [0x55] = KSYM_U, // 'U'
+    [0x56] = KSYM_V, // 'V'
+    [0x57] = KSYM_W, // 'W'
+    [0x58] = KSYM_X, // 'X'
+    [0x59] = KSYM_Y, // 'Y'
+    [0x5A] = KSYM_Z, // 'Z'
+    [0x5B] = KSYM_SUPER, // VK_LWIN
+    [0x5C] = KSYM_SUPER, // VK_RWIN
+    [0x5D] = KSYM_MENU, // VK_APPS
+    [0x60] = KSYM_0, // VK_NUMPAD0
+    [0x61] = KSYM_1, // VK_NUMPAD1
+    [0x62] = KSYM_2, // VK_NUMPAD2
+    [0x63] = KSYM_3, // VK_NUMPAD3
+    [0x64] = KSYM_4, // VK_NUMPAD4
+    [0x65] = KSYM_5, // VK_NUMPAD5
+    [0x66] = KSYM_6, // VK_NUMPAD6
+    [0x67] = KSYM_7, // VK_NUMPAD7
+    [0x68] = KSYM_8, // VK_NUMPAD8
+    [0x69] = KSYM_9, // VK_NUMPAD9
+    [0x6A] = KSYM_ASTERISK, // VK_MULTIPLY
+    [0x6B] = KSYM_PLUS, // VK_ADD
+    [0x6D] = KSYM_MINUS, // VK_SUBTRACT
+    [0x6E] = KSYM_PERIOD, // VK_DECIMAL
+    [0x6F] = KSYM_SLASH, // VK_DIVIDE
+    [0x70] = KSYM_F1, // VK_F1
+    [0x71] = KSYM_F2, // VK_F2
+    [0x72] = KSYM_F3, // VK_F3
+    [0x73] = KSYM_F4, // VK_F4
+    [0x74] = KSYM_F5, // VK_F5
+    [0x75] = KSYM_F6, // VK_F6
+    [0x76] = KSYM_F7, // VK_F7
+    [0x77] = KSYM_F8, // VK_F8
+    [0x78] = KSYM_F9, // VK_F9
+    [0x79] = KSYM_F10, // VK_F10
+    [0x7A] = KSYM_F11, // VK_F11
+    [0x7B] = KSYM_F12, // VK_F12
+    [0x7C] = KSYM_F13, // VK_F13
+    [0x7D] = KSYM_F14, // VK_F14
+    [0x7E] = KSYM_F15, // VK_F15
+    [0x7F] = KSYM_F16, // VK_F16
+    [0x80] = KSYM_F17, // VK_F17
+    [0x81] = KSYM_F18, // VK_F18
+    [0x82] = KSYM_F19, // VK_F19
+    [0x83] = KSYM_F20, // VK_F20
+    [0x84] = KSYM_F21, // VK_F21
+    [0x85] = KSYM_F22, // VK_F22
+    [0x86] = KSYM_F23, // VK_F23
+    [0x87] = KSYM_F24, // VK_F24
+    [0x90] = KSYM_NUM_LOCK, // VK_NUMLOCK
+    [0x91] = KSYM_SCROLL_LOCK, // VK_SCROLL
+    [0xA0] = KSYM_SHIFT, // VK_LSHIFT
+    [0xA1] = KSYM_SHIFT, // VK_RSHIFT
+    [0xA2] = KSYM_CTRL, // VK_LCONTROL
+    [0xA3] = KSYM_CTRL, // VK_RCONTROL
+    [0xA4] = KSYM_ALT, // VK_LMENU
+    [0xA5] = KSYM_ALT, // VK_RMENU
+    [0xBA] = KSYM_SEMICOLON, // VK_OEM_1
+    [0xBB] = KSYM_EQUAL, // VK_OEM_PLUS
+    [0xBC] = KSYM_COMMA, // VK_OEM_COMMA
+    [0xBD] = KSYM_MINUS, // VK_OEM_MINUS
+    [0xBE] = KSYM_PERIOD, // VK_OEM_PERIOD
+    [0xBF] = KSYM_SLASH, // VK_OEM_2
+    [0xC0] = KSYM_GRAVE, // VK_OEM_3
+    [0xDB] = KSYM_LEFT_BRACKET, // VK_OEM_4
+    [0xDC] = KSYM_BACKSLASH, // VK_OEM_5
+    [0xDD] = KSYM_RIGHT_BRACKET, // VK_OEM_6
+    [0xDE] = KSYM_APOSTROPHE, // VK_OEM_7
+    [0xE2] = KSYM_BACKSLASH, // VK_OEM_102
+};
+
+// Helper to convert a virtual key to its key symbol and queue it
+void push_sdl_keyevent_from_vk(WPARAM vkCode, LPARAM lParam, Uint16 flags) {
+    KeySymbol symbol = vkCode < 256 ? vkKeyMap[vkCode] : KSYM_UNKNOWN;
+
+    // Hand the key to the render thread without allocating
+    KeyEvent event;
+    keyEventInit(&event, symbol, flags);
+
+    // The hook's time field comes from the same clock as GetTickCount()
+    KBDLLHOOKSTRUCT *hook = (KBDLLHOOKSTRUCT *)lParam;
+    keyEventSetCaptureAge(&event,
+                          (Uint64)(DWORD)(GetTickCount() - hook->time) *
+                              1000000);
+    keyRingPush(&captureRing, &event);
 }
 
 LRESULT CALLBACK LowLevelKeyboardProc(int nCode, WPARAM wParam, LPARAM lParam) {
     if (nCode == HC_ACTION) {
         KBDLLHOOKSTRUCT *p = (KBDLLHOOKSTRUCT *)lParam;
+        // The low-level hook does not flag auto-repeat, so a key down
+        // without a key up in between is a repeat
+        static bool vkDown[256];
+        bool known = p->vkCode < 256;
         if (wParam == WM_KEYDOWN || wParam == WM_SYSKEYDOWN) {
-            push_sdl_keyevent_from_vk(p->vkCode, lParam);
+            Uint16 flags = known && vkDown[p->vkCode] ? KEY_EVENT_REPEAT : 0;
+            if (known) {
+                vkDown[p->vkCode] = true;
+            }
+            push_sdl_keyevent_from_vk(p->vkCode, lParam, flags);
+        } else if (known && (wParam == WM_KEYUP || wParam == WM_SYSKEYUP)) {
+            vkDown[p->vkCode] = false;
         }
     }
     return CallNextHookEx(g_hHook, nCode, wParam, lParam);
 }
 
+// Push folded mouse input that is due and set the hook thread's timer for
+// whatever is still held back
+void scheduleMouseFlush(void) {
+    if (g_mouseFlushTimer) {
+        KillTimer(NULL, g_mouseFlushTimer);
+        g_mouseFlushTimer = 0;
+    }
+    int timeout = mouseAggregatorFlush(&mouseAggregator);
+    if (timeout >= 0) {
+        g_mouseFlushTimer =
+            SetTimer(NULL, 0, timeout > 0 ? (UINT)timeout : 1, NULL);
+    }
+}
+
+// Count whole wheel notches in one axis. Precision touchpads and
+// free-spinning wheels send fractions of WHEEL_DELTA, so the remainder is
+// kept until it adds up to a notch (or the direction changes).
+void addWheelSteps(int *remainder, int delta, KeySymbol positive,
+                   KeySymbol negative, Uint64 ageNs) {
+    if ((delta > 0 && *remainder < 0) || (delta < 0 && *remainder > 0)) {
+        *remainder = 0;
+    }
+    *remainder += delta;
+    int steps = *remainder / WHEEL_DELTA;
+    if (steps == 0) {
+        return;
+    }
+    *remainder -= steps * WHEEL_DELTA;
+    mouseAggregatorAdd(&mouseAggregator, steps > 0 ? positive : negative,
+                       steps > 0 ? steps : -steps, ageNs);
+}
+
+LRESULT CALLBACK LowLevelMouseProc(int nCode, WPARAM wParam, LPARAM lParam) {
+    if (nCode == HC_ACTION) {
+        MSLLHOOKSTRUCT *p = (MSLLHOOKSTRUCT *)lParam;
+        // Same clock as the keyboard hook's time field
+        Uint64 ageNs = (Uint64)(DWORD)(GetTickCount() - p->time) * 1000000;
+        static int wheelRemainder;
+        static int hwheelRemainder;
+        switch (wParam) {
+        case WM_LBUTTONDOWN:
+            mouseAggregatorAdd(&mouseAggregator, KSYM_MOUSE_LEFT, 1, ageNs);
+            break;
+        case WM_RBUTTONDOWN:
+            mouseAggregatorAdd(&mouseAggregator, KSYM_MOUSE_RIGHT, 1, ageNs);
+            break;
+        case WM_MBUTTONDOWN:
+            mouseAggregatorAdd(&mouseAggregator, KSYM_MOUSE_MIDDLE, 1, ageNs);
+            break;
+        case WM_XBUTTONDOWN:
+            mouseAggregatorAdd(&mouseAggregator,
+                               HIWORD(p->mouseData) == XBUTTON1
+                                   ? KSYM_MOUSE_BACK
+                                   : KSYM_MOUSE_FORWARD,
+                               1, ageNs);
+            break;
+        case WM_MOUSEWHEEL:
+            addWheelSteps(&wheelRemainder, (short)HIWORD(p->mouseData),
+                          KSYM_WHEEL_UP, KSYM_WHEEL_DOWN, ageNs);
+            break;
+        case WM_MOUSEHWHEEL:
+            addWheelSteps(&hwheelRemainder, (short)HIWORD(p->mouseData),
+                          KSYM_WHEEL_RIGHT, KSYM_WHEEL_LEFT, ageNs);
+            break;
+        }
+        // A timer already set fires no later than anything held back now
+        if (!g_mouseFlushTimer) {
+            scheduleMouseFlush();
+        }
+    }
+    return CallNextHookEx(g_hMouseHook, nCode, wParam, lParam);
+}
+
 unsigned __stdcall KeyboardHookThread(void *param) {
     g_hHook = SetWindowsHookExA(WH_KEYBOARD_LL, LowLevelKeyboardProc, NULL, 0);
     if (!g_hHook) {
         MessageBoxA(NULL, "Failed to install keyboard hook!", "Error", MB_OK);
         return 1;
     }
+    // The mouse hook shares the thread, and with it the ring's producer side
+    if (captureMouse) {
+        g_hMouseHook =
+            SetWindowsHookExA(WH_MOUSE_LL, LowLevelMouseProc, NULL, 0);
+        if (!g_hMouseHook) {
+            printf("Failed to install mouse hook.\n");
+        }
+    }
     MSG msg;
     while (GetMessageA(&msg, NULL, 0, 0)) {
+        if (msg.message == WM_TIMER && msg.hwnd == NULL &&
+            msg.wParam == g_mouseFlushTimer) {
+            scheduleMouseFlush();
+            continue;
+        }
         TranslateMessage(&msg);
         DispatchMessageA(&msg);
     }
+    if (g_hMouseHook) {
+        UnhookWindowsHookEx(g_hMouseHook);
+    }
     UnhookWindowsHookEx(g_hHook);
     return 0;
 }
@@ -169,142 +435,226 @@ void setupGlobalKeyCapture() {
 }
 #endif
 
-void addKeyDisplay(const char *keyName, int width, int height) {
-  // Find an inactive slot or reuse the oldest one if all are active
-  int index = 0;
-  for (int i = 0; i < MAX_KEYS; i++) {
-    if (!keyDisplays[i].active) {
-      index = i;
-      break;
-    }
+#ifdef __APPLE__
+// macOS virtual key code to key symbol; codes left out map to KSYM_UNKNOWN
+static const KeySymbol macKeyMap[128] = {
+    [0] = KSYM_A,
+    [1] = KSYM_S,
+    [2] = KSYM_D,
+    [3] = KSYM_F,
+    [4] = KSYM_H,
+    [5] = KSYM_G,
+    [6] = KSYM_Z,
+    [7] = KSYM_X,
+    [8] = KSYM_C,
+    [9] = KSYM_V,
+    [10] = KSYM_SECTION,
+    [11] = KSYM_B,
+    [12] = KSYM_Q,
+    [13] = KSYM_W,
+    [14] = KSYM_E,
+    [15] = KSYM_R,
+    [16] = KSYM_Y,
+    [17] = KSYM_T,
+    [18] = KSYM_1,
+    [19] = KSYM_2,
+    [20] = KSYM_3,
+    [21] = KSYM_4,
+    [22] = KSYM_6,
+    [23] = KSYM_5,
+    [24] = KSYM_EQUAL,
+    [25] = KSYM_9,
+    [26] = KSYM_7,
+    [27] = KSYM_MINUS,
+    [28] = KSYM_8,
+    [29] = KSYM_0,
+    [30] = KSYM_RIGHT_BRACKET,
+    [31] = KSYM_O,
+    [32] = KSYM_U,
+    [33] = KSYM_LEFT_BRACKET,
+    [34] = KSYM_I,
+    [35] = KSYM_P,
+    [36] = KSYM_RETURN,
+    [37] = KSYM_L,
+    [38] = KSYM_J,
+    [39] = KSYM_APOSTROPHE,
+    [40] = KSYM_K,
+    [41] = KSYM_SEMICOLON,
+    [42] = KSYM_BACKSLASH,
+    [43] = KSYM_COMMA,
+    [44] = KSYM_SLASH,
+    [45] = KSYM_N,
+    [46] = KSYM_M,
+    [47] = KSYM_PERIOD,
+    [48] = KSYM_TAB,
+    [49] = KSYM_SPACE,
+    [50] = KSYM_GRAVE,
+    [51] = KSYM_BACKSPACE,
+    [53] = KSYM_ESC,
+    [54] = KSYM_SUPER,
+    [55] = KSYM_SUPER,
+    [56] = KSYM_SHIFT,
+    [57] = KSYM_CAPS,
+    [58] = KSYM_ALT,
+    [59] = KSYM_CTRL,
+    [60] = KSYM_SHIFT,
+    [61] = KSYM_ALT,
+    [62] = KSYM_CTRL,
+    [63] = KSYM_FN,
+    [64] = KSYM_F17,
+    [65] = KSYM_PERIOD,
+    [67] = KSYM_ASTERISK,
+    [69] = KSYM_PLUS,
+    [71] = KSYM_CLEAR,
+    [75] = KSYM_SLASH,
+    [76] = KSYM_RETURN,
+    [78] = KSYM_MINUS,
+    [79] = KSYM_F18,
+    [80] = KSYM_F19,
+    [81] = KSYM_EQUAL,
+    [82] = KSYM_0,
+    [83] = KSYM_1,
+    [84] = KSYM_2,
+    [85] = KSYM_3,
+    [86] = KSYM_4,
+    [87] = KSYM_5,
+    [88] = KSYM_6,
+    [89] = KSYM_7,
+    [90] = KSYM_F20,
+    [91] = KSYM_8,
+    [92] = KSYM_9,
+    [96] = KSYM_F5,
+    [97] = KSYM_F6,
+    [98] = KSYM_F7,
+    [99] = KSYM_F3,
+    [100] = KSYM_F8,
+    [101] = KSYM_F9,
+    [103] = KSYM_F11,
+    [105] = KSYM_F13,
+    [106] = KSYM_F16,
+    [107] = KSYM_F14,
+    [109] = KSYM_F10,
+    [111] = KSYM_F12,
+    [113] = KSYM_F15,
+    [114] = KSYM_INSERT,
+    [115] = KSYM_HOME,
+    [116] = KSYM_PAGE_UP,
+    [117] = KSYM_DELETE,
+    [118] = KSYM_F4,
+    [119] = KSYM_END,
+    [120] = KSYM_F2,
+    [121] = KSYM_PAGE_DOWN,
+    [122] = KSYM_F1,
+    [123] = KSYM_LEFT,
+    [124] = KSYM_RIGHT,
+    [125] = KSYM_DOWN,
+    [126] = KSYM_UP,
+};
+
+KeySymbol getMacKeySymbol(int keyCode) {
+  if (keyCode < 0 || keyCode >= 128) {
+    return KSYM_UNKNOWN;
+  }
+  return macKeyMap[keyCode];
+}
+
+// How long ago the event tap's source event happened, in nanoseconds. Event
+// timestamps share the mach_absolute_time() clock.
+static Uint64 macEventAge(CGEventRef event) {
+  static mach_timebase_info_data_t timebase;
+  if (timebase.denom == 0) {
+    mach_timebase_info(&timebase);
+  }
+  Uint64 now = mach_absolute_time();
+  Uint64 stamp = CGEventGetTimestamp(event);
+  if (stamp > now) {
+    return 0;
   }
+  return (now - stamp) * timebase.numer / timebase.denom;
+}
+
+// Queue a modifier key press for the SDL thread
+static void pushModifierKey(KeySymbol symbol, CGEventRef event) {
+  KeyEvent keyEvent;
+  keyEventInit(&keyEvent, symbol, 0);
+  keyEventSetCaptureAge(&keyEvent, macEventAge(event));
+  keyRingPush(&captureRing, &keyEvent);
+}
 
-  // If we found an inactive slot, increment activeKeyCount
-  if (!keyDisplays[index].active) {
-    activeKeyCount++;
+// Run loop timer that pushes folded mouse input, on the event tap's thread
+static CFRunLoopTimerRef mouseFlushTimer = NULL;
+static bool mouseFlushPending = false; // The timer is set to fire
+
+// Push folded mouse input that is due and set the timer for whatever is
+// still held back
+static void scheduleMouseFlush(void) {
+  int timeout = mouseAggregatorFlush(&mouseAggregator);
+  mouseFlushPending = timeout >= 0;
+  if (mouseFlushPending) {
+    CFRunLoopTimerSetNextFireDate(mouseFlushTimer,
+                                  CFAbsoluteTimeGetCurrent() +
+                                      timeout / 1000.0);
   }
+}
 
-  // Set up the new key display
-  strncpy(keyDisplays[index].text, keyName, 31);
-  keyDisplays[index].text[31] = '\0';
-  keyDisplays[index].active = true;
-  keyDisplays[index].width = width;
-  keyDisplays[index].height = height;
+static void mouseFlushTimerFired(CFRunLoopTimerRef timer, void *info) {
+  scheduleMouseFlush();
+}
 
-  // Update the last key press time for all keys to fade together
-  lastKeyPressTime = SDL_GetTicks();
+// Count wheel steps in one axis
+static void addWheelSteps(int64_t delta, KeySymbol positive,
+                          KeySymbol negative, Uint64 ageNs) {
+  if (delta != 0) {
+    mouseAggregatorAdd(&mouseAggregator, delta > 0 ? positive : negative,
+                       (int)(delta > 0 ? delta : -delta), ageNs);
+  }
 }
 
-#ifdef __APPLE__
-const char *getMacKeyName(int keyCode) {
-  static char buffer[32];
-
-  // Map macOS key codes to readable names
-  switch (keyCode) {
-  case 36:
-    return "Return";
-  case 53:
-    return "Esc";
-  case 51:
-    return "Bksp"; // Changed from "Delete" to "Bksp" for backspace
-  case 49:
-    return "Space";
-  case 48:
-    return "Tab";
-  case 56:
-    return "Shift"; // Left Shift
-  case 60:
-    return "Shift"; // Right Shift
-  case 59:
-    return "Ctrl"; // Left Control (abbreviated)
-  case 62:
-    return "Ctrl"; // Right Control (abbreviated)
-  case 58:
-    return "Opt"; // Left Option
-  case 61:
-    return "Opt"; // Right Option
-  case 55:
-    return "Cmd"; // Left Command
-  case 54:
-    return "Cmd"; // Right Command
-  case 126:
-    return "Up";
-  case 125:
-    return "Down";
-  case 123:
-    return "Left";
-  case 124:
-    return "Right";
-  case 57:
-    return "Caps"; // Abbreviated Caps Lock
-  case 116:
-    return "PgUp"; // Abbreviated Page Up
-  case 121:
-    return "PgDn"; // Abbreviated Page Down
-  case 115:
-    return "Home";
-  case 119:
-    return "End";
-  case 117:
-    return "Del"; // Forward delete key
-  case 122:
-    return "F1";
-  case 120:
-    return "F2";
-  case 99:
-    return "F3";
-  case 118:
-    return "F4";
-  case 96:
-    return "F5";
-  case 97:
-    return "F6";
-  case 98:
-    return "F7";
-  case 100:
-    return "F8";
-  case 101:
-    return "F9";
-  case 109:
-    return "F10";
-  case 103:
-    return "F11";
-  case 111:
-    return "F12";
-  default:
-    // For regular keys, try to get the character
-    if (keyCode >= 0 && keyCode <= 127) {
-      // Map common keys - this is not complete
-      const char *keyMap[] = {
-          "a",     "s",     "d",   "f",    "h",      "g",   "z",    "x",
-          "c",     "v",     "§",   "b",    "q",      "w",   "e",    "r",
-          "y",     "t",     "1",   "2",    "3",      "4",   "6",    "5",
-          "=",     "9",     "7",   "-",    "8",      "0",   "]",    "o",
-          "u",     "[",     "i",   "p",    "Return", "l",   "j",    "'",
-          "k",     ";",     "\\",  ",",    "/",      "n",   "m",    ".",
-          "Tab",   "Space", "`",   "Bksp", "",       "Esc", "",     "Cmd",
-          "Shift", "Caps",  "Opt", "Ctrl", "",       "",    "",     "",
-          "",      ".",     "",    "*",    "",       "+",   "",     "",
-          "",      "",      "",    "/",    "Return", "",    "-",    "",
-          "",      "",      "",    "",     "",       "Up",  "Down", "Right",
-          "Left",  "",      "",    "",     "",       "",    "",     "",
-          "",      "",      "",    "",     "",       "",    "",     "",
-          "",      "",      "",    "",     "",       "",    "",     "",
-          "",      "",      "",    "",     ""};
-
-      if (keyCode < 128 && keyMap[keyCode][0] != '\0') {
-        return keyMap[keyCode];
-      }
+// Mouse buttons and wheel from the event tap
+static void handleMouseEvent(CGEventType type, CGEventRef event) {
+  Uint64 ageNs = macEventAge(event);
+  if (type == kCGEventLeftMouseDown) {
+    mouseAggregatorAdd(&mouseAggregator, KSYM_MOUSE_LEFT, 1, ageNs);
+  } else if (type == kCGEventRightMouseDown) {
+    mouseAggregatorAdd(&mouseAggregator, KSYM_MOUSE_RIGHT, 1, ageNs);
+  } else if (type == kCGEventOtherMouseDown) {
+    // Buttons are numbered from 0 (left); 2 is the middle button and 3
+    // and 4 the side buttons
+    int64_t button =
+        CGEventGetIntegerValueField(event, kCGMouseEventButtonNumber);
+    if (button == 2) {
+      mouseAggregatorAdd(&mouseAggregator, KSYM_MOUSE_MIDDLE, 1, ageNs);
+    } else if (button == 3) {
+      mouseAggregatorAdd(&mouseAggregator, KSYM_MOUSE_BACK, 1, ageNs);
+    } else if (button == 4) {
+      mouseAggregatorAdd(&mouseAggregator, KSYM_MOUSE_FORWARD, 1, ageNs);
     }
+  } else if (type == kCGEventScrollWheel) {
+    // Line deltas: axis 1 is vertical (up is positive), axis 2 horizontal
+    // (left is positive)
+    addWheelSteps(
+        CGEventGetIntegerValueField(event, kCGScrollWheelEventDeltaAxis1),
+        KSYM_WHEEL_UP, KSYM_WHEEL_DOWN, ageNs);
+    addWheelSteps(
+        CGEventGetIntegerValueField(event, kCGScrollWheelEventDeltaAxis2),
+        KSYM_WHEEL_LEFT, KSYM_WHEEL_RIGHT, ageNs);
+  }
 
-    sprintf(buffer, "Key_%d", keyCode);
-    return buffer;
+  // A timer already set fires no later than anything held back now
+  if (!mouseFlushPending) {
+    scheduleMouseFlush();
   }
 }
 
 // macOS global key event callback
 CGEventRef keyboardCaptureCallback(CGEventTapProxy proxy, CGEventType type,
                                    CGEventRef event, void *refcon) {
+  if (type == kCGEventLeftMouseDown || type == kCGEventRightMouseDown ||
+      type == kCGEventOtherMouseDown || type == kCGEventScrollWheel) {
+    handleMouseEvent(type, event);
+    return event;
+  }
+
   // Handle both key down and flag changed events (for modifier keys)
   if (type != kCGEventKeyDown && type != kCGEventFlagsChanged) {
     return event;
@@ -320,15 +670,15 @@ CGEventRef keyboardCaptureCallback(CGEventTapProxy proxy, CGEventType type,
     keyCode =
         (CGKeyCode)CGEventGetIntegerValueField(event, kCGKeyboardEventKeycode);
 
-    // Get the key name
-    const char *keyName = getMacKeyName(keyCode);
-
-    // Process the key press in the SDL thread
-    SDL_Event sdlEvent;
-    sdlEvent.type = SDL_USEREVENT;
-    sdlEvent.user.code = 1;                        // Custom code for key press
-    sdlEvent.user.data1 = (void *)strdup(keyName); // Pass the key name
-    SDL_PushEvent(&sdlEvent);
+    // Hand the key press to the SDL thread
+    KeyEvent keyEvent;
+    keyEventInit(&keyEvent, getMacKeySymbol(keyCode),
+                 CGEventGetIntegerValueField(event,
+                                             kCGKeyboardEventAutorepeat)
+                     ? KEY_EVENT_REPEAT
+                     : 0);
+    keyEventSetCaptureAge(&keyEvent, macEventAge(event));
+    keyRingPush(&captureRing, &keyEvent);
   } else if (type == kCGEventFlagsChanged) {
     // For modifier key events
     // Check which modifier key changed
@@ -338,11 +688,7 @@ CGEventRef keyboardCaptureCallback(CGEventTapProxy proxy, CGEventType type,
         (lastFlags & kCGEventFlagMaskCommand)) {
       if (flags & kCGEventFlagMaskCommand) {
         // Command key pressed
-        SDL_Event sdlEvent;
-        sdlEvent.type = SDL_USEREVENT;
-        sdlEvent.user.code = 1;
-        sdlEvent.user.data1 = (void *)strdup("Cmd");
-        SDL_PushEvent(&sdlEvent);
+        pushModifierKey(KSYM_SUPER, event);
       }
     }
 
@@ -351,11 +697,7 @@ CGEventRef keyboardCaptureCallback(CGEventTapProxy proxy, CGEventType type,
         (lastFlags & kCGEventFlagMaskAlternate)) {
       if (flags & kCGEventFlagMaskAlternate) {
         // Option key pressed
-        SDL_Event sdlEvent;
-        sdlEvent.type = SDL_USEREVENT;
-        sdlEvent.user.code = 1;
-        sdlEvent.user.data1 = (void *)strdup("Opt");
-        SDL_PushEvent(&sdlEvent);
+        pushModifierKey(KSYM_ALT, event);
       }
     }
 
@@ -364,11 +706,7 @@ CGEventRef keyboardCaptureCallback(CGEventTapProxy proxy, CGEventType type,
         (lastFlags & kCGEventFlagMaskControl)) {
       if (flags & kCGEventFlagMaskControl) {
         // Control key pressed
-        SDL_Event sdlEvent;
-        sdlEvent.type = SDL_USEREVENT;
-        sdlEvent.user.code = 1;
-        sdlEvent.user.data1 = (void *)strdup("Ctrl");
-        SDL_PushEvent(&sdlEvent);
+        pushModifierKey(KSYM_CTRL, event);
       }
     }
 
@@ -377,11 +715,7 @@ CGEventRef keyboardCaptureCallback(CGEventTapProxy proxy, CGEventType type,
         (lastFlags & kCGEventFlagMaskShift)) {
       if (flags & kCGEventFlagMaskShift) {
         // Shift key pressed
-        SDL_Event sdlEvent;
-        sdlEvent.type = SDL_USEREVENT;
-        sdlEvent.user.code = 1;
-        sdlEvent.user.data1 = (void *)strdup("Shift");
-        SDL_PushEvent(&sdlEvent);
+        pushModifierKey(KSYM_SHIFT, event);
       }
     }
 
@@ -398,6 +732,12 @@ void setupGlobalKeyCapture() {
   // Create an event tap to monitor key down and flags changed events
   CGEventMask eventMask =
       CGEventMaskBit(kCGEventKeyDown) | CGEventMaskBit(kCGEventFlagsChanged);
+  if (captureMouse) {
+    eventMask |= CGEventMaskBit(kCGEventLeftMouseDown) |
+                 CGEventMaskBit(kCGEventRightMouseDown) |
+                 CGEventMaskBit(kCGEventOtherMouseDown) |
+                 CGEventMaskBit(kCGEventScrollWheel);
+  }
   CFMachPortRef eventTap = CGEventTapCreate(
       kCGSessionEventTap, // Capture events for all apps in the current session
       kCGHeadInsertEventTap,    // Insert at the head of the event queue
@@ -421,6 +761,17 @@ void setupGlobalKeyCapture() {
   CFRunLoopAddSource(CFRunLoopGetCurrent(), runLoopSource,
                      kCFRunLoopCommonModes);
 
+  // Folded mouse input is pushed from the same run loop, so the tap stays
+  // the ring's only producer. The timer idles far in the future until mouse
+  // input is held back.
+  if (captureMouse) {
+    mouseFlushTimer = CFRunLoopTimerCreate(
+        kCFAllocatorDefault, CFAbsoluteTimeGetCurrent() + 1e9, 1e9, 0, 0,
+        mouseFlushTimerFired, NULL);
+    CFRunLoopAddTimer(CFRunLoopGetCurrent(), mouseFlushTimer,
+                      kCFRunLoopCommonModes);
+  }
+
   // Enable the event tap
   CGEventTapEnable(eventTap, true);
 
@@ -435,384 +786,1014 @@ void setupGlobalKeyCapture() {
 #endif
 
 #ifdef __linux__
-// Linux stub - you would implement Linux-specific key capture here
+const char *evdevReplayPath = NULL; // Recorded input_event file to play back
+const char *captureBackend = "auto"; // "evdev", "x11" or "auto"
+bool evdevCapturing = false;
+bool x11Capturing = false;
+
+// Set up Linux capture on a dedicated thread: evdev where /dev/input is
+// readable, otherwise XInput2 on the X display
 void setupGlobalKeyCapture() {
-    printf("Global key capture not implemented for Linux yet.\n");
+  MouseAggregator *mouse = captureMouse ? &mouseAggregator : NULL;
+  bool useX11 = strcmp(captureBackend, "x11") == 0;
+  if (!useX11) {
+    // Even a failed start leaves descriptors for evdevCaptureStop to close
+    evdevCapturing = true;
+    if (!evdevCaptureStart(&captureRing, evdevReplayPath, mouse)) {
+      printf("Failed to start evdev key capture.\n");
+      return;
+    }
+#ifdef HAVE_XINPUT2
+    if (strcmp(captureBackend, "auto") == 0 && !evdevReplayPath &&
+        !evdevCaptureFoundKeyboards() && getenv("DISPLAY")) {
+      printf("No readable keyboard under /dev/input; falling back to "
+             "XInput2.\n");
+      evdevCaptureStop();
+      evdevCapturing = false;
+      useX11 = true;
+    }
+#endif
+  }
+
+  if (useX11) {
+#ifdef HAVE_XINPUT2
+    x11Capturing = x11CaptureStart(&captureRing, mouse);
+    if (!x11Capturing) {
+      printf("Failed to start XInput2 key capture.\n");
+      return;
+    }
+#else
+    printf("Built without XInput2 (install the X11 and Xi development "
+           "packages); no key capture.\n");
+    return;
+#endif
+  }
+
+  printf("Global key capture initialized.\n");
 }
 #endif
 
-// Pre-measure text dimensions
-void measureText(TTF_Font *font, const char *text, int *width, int *height) {
-  TTF_SizeText(font, text, width, height);
+
+// Print how long it took from launch to the first presented frame, once
+void reportFirstFrame(void) {
+  if (firstFramePresented) {
+    return;
+  }
+  firstFramePresented = true;
+  printf("Time to first frame: %.1f ms\n",
+         (SDL_GetPerformanceCounter() - startupTicks) * 1000.0 /
+             SDL_GetPerformanceFrequency());
 }
 
-// Initialize the toggle button
-void initToggleButton() {
-  toggleButton.rect.x =
-      WINDOW_WIDTH - BUTTON_WIDTH - 20; // 20px from right edge
-  toggleButton.rect.y =
-      WINDOW_HEIGHT - BUTTON_HEIGHT - 20; // 20px from bottom edge
-  toggleButton.rect.w = BUTTON_WIDTH;
-  toggleButton.rect.h = BUTTON_HEIGHT;
-  strcpy(toggleButton.text, "Toggle Align");
-  toggleButton.hovered = false;
-  toggleButton.pressed = false;
+// Wake the main loop from a capture thread
+void wakeMainLoop(void *userdata) {
+  SDL_Event wakeEvent;
+  SDL_zero(wakeEvent);
+  wakeEvent.type = wakeEventType;
+  SDL_PushEvent(&wakeEvent);
 }
 
-// Check if a point is inside the button
-bool isPointInButton(int x, int y, Button *button) {
-  return (x >= button->rect.x && x < button->rect.x + button->rect.w &&
-          y >= button->rect.y && y < button->rect.y + button->rect.h);
+// Follow a resized window: fonts for the new scale and the button now, the
+// key line once the simulation thread picks the new layout up
+void resizeCanvas(int width, int height) {
+  if (!setSceneCanvas(width, height, canvasScale)) {
+    return;
+  }
+  labelCacheReserve(&labelCache, sceneLayout.atlasSize);
+
+  SDL_AtomicLock(&layoutLock);
+  pendingLayout = sceneLayout;
+  SDL_AtomicUnlock(&layoutLock);
+  SDL_AtomicSet(&layoutChanged, 1);
+  if (simWake) {
+    SDL_SemPost(simWake);
+  }
 }
 
-// Draw the toggle button
-void drawButton(SDL_Renderer *renderer, TTF_Font *font, Button *button) {
-  // Draw button background
-  SDL_Color bgColor = {100, 100, 100, 255}; // Gray background
-  if (button->hovered) {
-    bgColor.r = 120;
-    bgColor.g = 120;
-    bgColor.b = 120;
+// Pace animations at --fps, or at the refresh rate of the display the
+// window is on
+void updateFrameRate(SDL_Window *window) {
+  double displayRate = framePacerDisplayRate(window);
+  double rate = targetFps;
+  if (rate <= 0) {
+    rate = displayRate > 0 ? displayRate : FRAME_PACER_DEFAULT_RATE;
   }
-  if (button->pressed) {
-    bgColor.r = 80;
-    bgColor.g = 80;
-    bgColor.b = 80;
+  // Vsync holds presents to the display's rate; only a lower --fps needs
+  // frames held back on top of it
+  bool presentPaced =
+      presentVsync && (targetFps <= 0 ||
+                       (displayRate > 0 && targetFps >= displayRate));
+  if (rate != framePacer.rate || presentPaced != framePacer.presentPaced) {
+    printf("Pacing animations at %.1f Hz%s\n", rate,
+           presentPaced ? " with vsync" : "");
+    framePacerSetRate(&framePacer, rate, presentPaced);
   }
+}
 
-  SDL_SetRenderDrawColor(renderer, bgColor.r, bgColor.g, bgColor.b, bgColor.a);
-  SDL_RenderFillRect(renderer, &button->rect);
+// Handle a window or mouse event from SDL
+void handleEvent(SDL_Event *e) {
+  if (e->type == SDL_QUIT) {
+    shouldQuit = true;
+  } else if (e->type == SDL_KEYDOWN && e->key.keysym.sym == SDLK_l &&
+             !e->key.repeat) {
+    // L in the focused window dumps the latency histograms
+    latencyDumpRequested = 1;
+  } else if (e->type == SDL_KEYDOWN && e->key.keysym.sym == SDLK_F3 &&
+             !e->key.repeat) {
+    // F3 in the focused window toggles the profiler HUD
+    profiler.visible = !profiler.visible;
+    needsRedraw = true;
+  } else if (e->type == SDL_WINDOWEVENT) {
+    if (e->window.event == SDL_WINDOWEVENT_SIZE_CHANGED) {
+      resizeCanvas(e->window.data1, e->window.data2);
+    }
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+    if (e->window.event == SDL_WINDOWEVENT_DISPLAY_CHANGED) {
+      updateFrameRate(SDL_GetWindowFromID(e->window.windowID));
+    }
+#endif
+    // Redraw whenever the window contents may have been lost
+    needsRedraw = true;
+  } else if (e->type == SDL_RENDER_TARGETS_RESET) {
+    // The key line composites lost their pixels; compose them again
+    lineComposite.valid = false;
+    needsRedraw = true;
+    for (int i = 0; i < viewCount; i++) {
+      views[i].composite.valid = false;
+      views[i].needsRedraw = true;
+    }
+  } else if (e->type == SDL_MOUSEMOTION) {
+    // Check if mouse is hovering over the button
+    int mouseX = e->motion.x;
+    int mouseY = e->motion.y;
+    bool hovered = isPointInButton(mouseX, mouseY, &toggleButton);
+    if (hovered != toggleButton.hovered) {
+      toggleButton.hovered = hovered;
+      needsRedraw = true;
+    }
+  } else if (e->type == SDL_MOUSEBUTTONDOWN) {
+    // Check if button is clicked
+    int mouseX = e->button.x;
+    int mouseY = e->button.y;
+    if (isPointInButton(mouseX, mouseY, &toggleButton)) {
+      toggleButton.pressed = true;
+      needsRedraw = true;
+    }
+  } else if (e->type == SDL_MOUSEBUTTONUP) {
+    // Check if button is released
+    int mouseX = e->button.x;
+    int mouseY = e->button.y;
+    if (toggleButton.pressed &&
+        isPointInButton(mouseX, mouseY, &toggleButton)) {
+      // Toggle alignment and clear all keys to start fresh; the key line
+      // belongs to the simulation thread, which applies it
+      SDL_AtomicAdd(&alignToggles, 1);
+      if (simWake) {
+        SDL_SemPost(simWake);
+      }
+    }
+    if (toggleButton.pressed) {
+      needsRedraw = true;
+    }
+    toggleButton.pressed = false;
+  }
+}
 
-  // Draw button border
-  SDL_SetRenderDrawColor(renderer, 50, 50, 50, 255);
-  SDL_RenderDrawRect(renderer, &button->rect);
+// Tear down the window or the headless framebuffer
+void destroyOutput(SDL_Window *window, SDL_Renderer *renderer,
+                   HeadlessTarget *headlessTarget) {
+  if (headless) {
+#ifndef _WIN32
+    if (shmOutputName) {
+      shmOutputClose(&shmOutput);
+    }
+#endif
+    headlessDestroy(headlessTarget);
+    return;
+  }
+  SDL_DestroyRenderer(renderer);
+  SDL_DestroyWindow(window);
+}
+
+// Free every view's texture and outputs; call before the renderer goes
+// away
+void closeViews(void) {
+  for (int i = 0; i < viewCount; i++) {
+    sceneViewClose(&views[i]);
+  }
+  viewCount = 0;
+}
+
+// Run a batch of key events through recording and layout
+void handleKeyEvents(const KeyEvent *events, int count) {
+  Uint64 dequeued = SDL_GetPerformanceCounter();
+  if (recording) {
+    keyLogWriterAppend(&keyLogWriter, events, count);
+  }
+  for (int i = 0; i < count; i++) {
+    latencyRecord(LATENCY_DEQUEUE, events[i].captureTicks, dequeued);
+    if (countingUsage) {
+      usageStatsRecord(&usageStats, &events[i]);
+    }
+    if (coalesceKeys) {
+      keyCoalescerFeed(&keyCoalescer, &events[i], sceneClockNow());
+    } else {
+      processKeyPresses(events[i].symbol, keyEventCount(&events[i]));
+    }
+    latencyRecord(LATENCY_LAYOUT, events[i].captureTicks,
+                  SDL_GetPerformanceCounter());
+
+    // Hand the key to the render side, which samples it again once the
+    // first frame showing it is drawn and presented
+    if (keyRingPush(&layoutRing, &events[i])) {
+      keysLaidOut++;
+    }
+  }
+
+  // Then every other view lays the same keys out for its own canvas
+  for (int i = 0; i < viewCount; i++) {
+    sceneViewFeed(&views[i], events, count);
+  }
+}
+
+// How many key line frames were a single blit of the cached composite
+void printKeyLineStats(void) {
+  printf("Key line frames: %llu from the cached composite, %llu re-composed\n",
+         (unsigned long long)lineComposite.reused,
+         (unsigned long long)lineComposite.rebuilt);
+  for (int i = 0; i < viewCount; i++) {
+    sceneViewPrintStats(&views[i], i + 1);
+  }
+}
 
-  // Draw button text
-  SDL_Color textColor = {255, 255, 255, 255}; // White text
-  SDL_Surface *textSurface =
-      TTF_RenderText_Blended(font, button->text, textColor);
-  if (textSurface) {
-    SDL_Texture *textTexture =
-        SDL_CreateTextureFromSurface(renderer, textSurface);
+// Sample every key first shown by the current frame at the given stage
+void recordFrameLatency(LatencyStage stage) {
+  Uint64 now = SDL_GetPerformanceCounter();
+  for (int i = 0; i < frameKeyCount; i++) {
+    latencyRecord(stage, frameKeys[i].captureTicks, now);
+  }
+}
 
-    // Center text in button
-    SDL_Rect textRect = {button->rect.x + (button->rect.w - textSurface->w) / 2,
-                         button->rect.y + (button->rect.h - textSurface->h) / 2,
-                         textSurface->w, textSurface->h};
+#ifndef _WIN32
+// SIGUSR1 asks for a latency dump; printing waits for the main loop
+void requestLatencyDump(int sig) { latencyDumpRequested = 1; }
+#endif
 
-    SDL_RenderCopy(renderer, textTexture, NULL, &textRect);
+// Print the latency histograms if a dump was asked for since the last check
+void checkLatencyDump(void) {
+  if (latencyDumpRequested) {
+    latencyDumpRequested = 0;
+    latencyPrint();
+  }
+}
 
-    SDL_FreeSurface(textSurface);
-    SDL_DestroyTexture(textTexture);
+// Drain every key captured (or replayed) since the last step in one batch
+int drainCapturedKeys(void) {
+  KeyEvent keyEvents[KEY_RING_CAPACITY];
+  int drained = keyRingDrain(&captureRing, keyEvents, KEY_RING_CAPACITY);
+  handleKeyEvents(keyEvents, drained);
+
+  int received = keyRingDrain(&netRing, keyEvents, KEY_RING_CAPACITY);
+  handleKeyEvents(keyEvents, received);
+  drained += received;
+
+  if (replaying) {
+    int replayed = keyLogReplayPoll(&keyLogReplay, sceneClockNow(), keyEvents,
+                                    KEY_RING_CAPACITY);
+    handleKeyEvents(keyEvents, replayed);
+    drained += replayed;
+  }
+  if (coalesceKeys) {
+    keyCoalescerFlush(&keyCoalescer, sceneClockNow());
   }
+  return drained;
 }
 
-// Process a key press
-void processKeyPress(const char *keyName) {
-  // Pre-measure the key width and height before adding it
-  int keyWidth, keyHeight;
-  measureText(font, keyName, &keyWidth, &keyHeight);
+// Lay out newly captured keys, apply toggle clicks and canvas changes, and
+// publish a snapshot of the key line as of now (scene clock microseconds)
+// if anything changed. Runs on the simulation thread, or once per frame on
+// the main thread when headless.
+void simStep(Uint64 now) {
+  unsigned int version = keyLine->version;
+  Uint64 laidOut = keysLaidOut;
+
+  if (SDL_AtomicSet(&layoutChanged, 0)) {
+    SDL_AtomicLock(&layoutLock);
+    SceneLayout layout = pendingLayout;
+    SDL_AtomicUnlock(&layoutLock);
+    setKeyLineLayout(&layout);
+  }
 
-  // Check if we need to wrap to the beginning
-  if (currentLineWidth + keyWidth + (currentLineWidth > 0 ? KEY_GAP : 0) >
-      MAX_WIDTH) {
-    // Reset all keys to start a new line
-    for (int i = 0; i < MAX_KEYS; i++) {
-      keyDisplays[i].active = false;
+  int toggles = SDL_AtomicSet(&alignToggles, 0);
+  if (toggles > 0) {
+    if (toggles % 2) {
+      keyLine->rightAligned = !keyLine->rightAligned;
     }
-    activeKeyCount = 0;
-    currentLineWidth = 0;
+    clearKeyDisplays();
   }
 
-  // Add key to display
-  addKeyDisplay(keyName, keyWidth, keyHeight);
+  drainCapturedKeys();
 
-  // Update current line width (add key width + gap)
-  if (currentLineWidth > 0) {
-    currentLineWidth += KEY_GAP;
+  SceneSnapshot *snapshot = snapshotBufferBack(&sceneSnapshots);
+  captureSceneSnapshot(snapshot, now);
+  if (keyLine->version != version || keysLaidOut != laidOut) {
+    snapshot->sequence = ++snapshotSequence;
+    snapshot->keysLaidOut = keysLaidOut;
+    snapshotBufferPublish(&sceneSnapshots);
+  }
+  for (int i = 0; i < viewCount; i++) {
+    sceneViewStep(&views[i], now);
   }
-  currentLineWidth += keyWidth;
 }
 
-int main(int argc, char *argv[]) {
-  if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_EVENTS) < 0) {
-    printf("SDL could not initialize! SDL_Error: %s\n", SDL_GetError());
-    return 1;
+// Wake the simulation thread from a capture thread
+void wakeSimThread(void *userdata) { SDL_SemPost(simWake); }
+
+// How long the simulation thread may sleep, in milliseconds (-1 = forever)
+int simTimeout(Uint32 now) {
+  int timeout = coalesceKeys ? keyCoalescerTimeout(&keyCoalescer, now) : -1;
+  if (replaying) {
+    int replayTimeout = keyLogReplayTimeout(&keyLogReplay, now);
+    if (replayTimeout >= 0 && (timeout < 0 || replayTimeout < timeout)) {
+      timeout = replayTimeout;
+    }
+  }
+  for (int i = 0; i < viewCount; i++) {
+    int viewTimeout = sceneViewTimeout(&views[i], now);
+    if (viewTimeout >= 0 && (timeout < 0 || viewTimeout < timeout)) {
+      timeout = viewTimeout;
+    }
   }
+  return timeout;
+}
 
-  if (TTF_Init() < 0) {
-    printf("SDL_ttf could not initialize! TTF_Error: %s\n", TTF_GetError());
-    SDL_Quit();
-    return 1;
+// Simulation thread: lay keys out the moment they are captured, whatever
+// the render loop is doing, and hand the result over as snapshots
+int runSimThread(void *data) {
+  while (!SDL_AtomicGet(&simQuit)) {
+    // Sleep until a key is captured or received, the UI asks for
+    // something, or a replayed key or held-back modifier is due
+    if (keyRingPrepareWait(&captureRing)) {
+      if (keyRingPrepareWait(&netRing)) {
+        int timeout = simTimeout(sceneClockNow());
+        if (timeout < 0) {
+          SDL_SemWait(simWake);
+        } else if (timeout > 0) {
+          SDL_SemWaitTimeout(simWake, (Uint32)timeout);
+        }
+        keyRingCancelWait(&netRing);
+      }
+      keyRingCancelWait(&captureRing);
+    }
+    simStep(sceneClockNowUs());
   }
+  return 0;
+}
 
-  // Create window
-  SDL_Window *window = SDL_CreateWindow("KeyCapper", SDL_WINDOWPOS_UNDEFINED,
-                                        SDL_WINDOWPOS_UNDEFINED, WINDOW_WIDTH,
-                                        WINDOW_HEIGHT, SDL_WINDOW_SHOWN);
-  if (!window) {
-    printf("Window could not be created! SDL_Error: %s\n", SDL_GetError());
-    TTF_Quit();
-    SDL_Quit();
-    return 1;
+#ifndef _WIN32
+// Send browser overlays the keys this frame shows for the first time and the
+// line as drawn, when either changed since the last message
+void publishWsFrame(const SceneSnapshot *snapshot) {
+  Uint64 now = sceneClockNowUs();
+  Uint8 alpha = sceneSnapshotAlpha(snapshot, now);
+  if (frameKeyCount == 0 && snapshot->sequence == wsSentSequence &&
+      alpha == wsSentAlpha) {
+    return;
   }
+  wsSentSequence = snapshot->sequence;
+  wsSentAlpha = alpha;
+  int length = sceneJsonFormat(wsMessage, sizeof(wsMessage), ++wsFrame,
+                               snapshot, now, frameKeys, frameKeyCount);
+  wsOutputPublish(wsMessage, length);
+}
+#endif
 
-  SDL_Renderer *renderer = SDL_CreateRenderer(
-      window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
-  if (!renderer) {
-    printf("Renderer could not be created! SDL_Error: %s\n", SDL_GetError());
-    SDL_DestroyWindow(window);
-    TTF_Quit();
-    SDL_Quit();
-    return 1;
+// Draw a snapshot (and the HUD when visible) for one frame, ready to
+// present. Returns whether any keys are on screen.
+bool renderFrame(SDL_Renderer *renderer, const SceneSnapshot *snapshot) {
+  labelCacheBeginFrame(&labelCache);
+  drawnSequence = snapshot->sequence;
+
+  // Keys this snapshot shows for the first time, for latency sampling
+  frameKeyCount = keyRingDrain(&layoutRing, frameKeys,
+                               (int)(snapshot->keysLaidOut - keysDrawn));
+  keysDrawn += frameKeyCount;
+
+  profilerBeginScene(&profiler, &labelCache, sceneDrawCalls);
+  bool lineVisible = renderScene(renderer, snapshot, sceneClockNowUs());
+  profilerEndScene(&profiler, &labelCache, sceneDrawCalls);
+  recordFrameLatency(LATENCY_SUBMIT);
+#ifndef _WIN32
+  if (wsStreaming) {
+    publishWsFrame(snapshot);
   }
+#endif
 
-  // Load main font for keys
-  font = TTF_OpenFont("./PixelifySans[wght].ttf", FONT_SIZE);
+  if (profiler.visible) {
+    profilerDraw(&profiler, renderer, &labelCache,
+                 sceneLayout.fonts->buttonFont, framePacer.rate);
+    profilerMark(&profiler, PROFILE_HUD);
+  }
+  return lineVisible;
+}
 
-  if (!font) {
-    printf("Failed to load font! TTF_Error: %s\n", TTF_GetError());
-    printf("Please provide a font file.\n");
-    SDL_DestroyRenderer(renderer);
-    SDL_DestroyWindow(window);
-    TTF_Quit();
-    SDL_Quit();
-    return 1;
+// Draw every view whose line changed or is fading, or all of them if
+// force. Returns whether any of them show keys.
+bool renderViews(bool force) {
+  bool onScreen = false;
+  for (int i = 0; i < viewCount; i++) {
+    if (sceneViewRender(&views[i], sceneClockNowUs(), force)) {
+      onScreen = true;
+    }
+  }
+  return onScreen;
+}
+
+// Announce an idle sleep to every snapshot buffer the window loop draws.
+// Returns false, announcing nothing, if one already has a snapshot waiting.
+bool prepareSnapshotWait(void) {
+  if (!snapshotBufferPrepareWait(&sceneSnapshots)) {
+    return false;
   }
+  for (int i = 0; i < viewCount; i++) {
+    if (!snapshotBufferPrepareWait(&views[i].snapshots)) {
+      while (i-- > 0) {
+        snapshotBufferCancelWait(&views[i].snapshots);
+      }
+      snapshotBufferCancelWait(&sceneSnapshots);
+      return false;
+    }
+  }
+  return true;
+}
 
-  // Load smaller font for button
-  buttonFont = TTF_OpenFont("./JetBrainsMono-Medium.ttf", BUTTON_FONT_SIZE);
-  if (!buttonFont) {
-    // Fall back to main font if button font can't be loaded
-    buttonFont = font;
+void cancelSnapshotWait(void) {
+  snapshotBufferCancelWait(&sceneSnapshots);
+  for (int i = 0; i < viewCount; i++) {
+    snapshotBufferCancelWait(&views[i].snapshots);
   }
+}
 
-  // Define colors
-  SDL_Color textColor = {255, 255, 255, 255}; // White
-  SDL_Color bgColor = {0, 0, 0, 255};         // Black background for text
-  SDL_Color chromaKeyColor = {0, 0, 0, 0};    // Transparent background
+// How long an idle window loop may sleep, in milliseconds (-1 = forever)
+int idleTimeout(Uint32 statsStartTime) {
+  int timeout = -1;
+  if (showStats) {
+    Uint32 elapsed = SDL_GetTicks() - statsStartTime;
+    timeout = elapsed < STATS_INTERVAL ? (int)(STATS_INTERVAL - elapsed) : 0;
+  }
+  if (showLatency &&
+      (timeout < 0 || timeout > LATENCY_POLL_INTERVAL)) {
+    // Notice SIGUSR1 dump requests without waiting for a key
+    timeout = LATENCY_POLL_INTERVAL;
+  }
+  return timeout;
+}
 
-  // Initialize key displays
-  for (int i = 0; i < MAX_KEYS; i++) {
-    keyDisplays[i].active = false;
-    keyDisplays[i].width = 0;
-    keyDisplays[i].height = 0;
+// Windowed main loop: draw while fading, otherwise sleep until the
+// simulation thread publishes a new snapshot
+void runWindowLoop(SDL_Window *window, SDL_Renderer *renderer) {
+  // Let the simulation thread wake the main loop when it is idle
+  wakeEventType = SDL_RegisterEvents(1);
+  snapshotBufferSetWake(&sceneSnapshots, wakeMainLoop, NULL);
+  for (int i = 0; i < viewCount; i++) {
+    snapshotBufferSetWake(&views[i].snapshots, wakeMainLoop, NULL);
   }
 
-  // Initialize toggle button
-  initToggleButton();
+  // Lay keys out on their own thread, woken by the capture thread
+  simWake = SDL_CreateSemaphore(0);
+  keyRingSetWake(&captureRing, wakeSimThread, NULL);
+  keyRingSetWake(&netRing, wakeSimThread, NULL);
+  SDL_Thread *simThread =
+      simWake ? SDL_CreateThread(runSimThread, "keycapper-sim", NULL) : NULL;
+  if (!simThread) {
+    printf("Simulation thread could not be started! SDL_Error: %s\n",
+           SDL_GetError());
+    return;
+  }
 
-  // Set up global key capture for all platforms
-  setupGlobalKeyCapture();
+  // Without vsync, presenting does not pace the loop while a fade runs
+  SDL_RendererInfo rendererInfo;
+  presentVsync = SDL_GetRendererInfo(renderer, &rendererInfo) == 0 &&
+                 (rendererInfo.flags & SDL_RENDERER_PRESENTVSYNC);
+  framePacerInit(&framePacer, 0.0, false);
+  updateFrameRate(window);
 
-  // Main loop
-  bool quit = false;
   SDL_Event e;
+  Uint32 statsStartTime = SDL_GetTicks();
+  int idleWakeups = 0;
+  int framesRendered = 0;
+  bool lineOnScreen = false;
+  bool viewsOnScreen = false;
+  needsRedraw = true;
+
+  while (!shouldQuit) {
+    // Sleep until a snapshot or input arrives when nothing on screen is
+    // changing
+    if (!lineOnScreen && !viewsOnScreen && !needsRedraw &&
+        prepareSnapshotWait()) {
+      framePacerStop(&framePacer);
+      int timeout = idleTimeout(statsStartTime);
+      int gotEvent = timeout < 0 ? SDL_WaitEvent(&e)
+                                 : SDL_WaitEventTimeout(&e, timeout);
+      cancelSnapshotWait();
+      idleWakeups++;
+      if (gotEvent) {
+        handleEvent(&e);
+      }
+    }
+    profilerBeginFrame(&profiler);
 
-  while (!quit) {
     // Process events
     while (SDL_PollEvent(&e) != 0) {
-      if (e.type == SDL_QUIT) {
-        quit = true;
-      } else if (e.type == SDL_USEREVENT && e.user.code == 1) {
-        // Handle key press from global event monitor
-        const char *keyName = (const char *)e.user.data1;
-        processKeyPress(keyName);
-        free(e.user.data1); // Free the allocated string
-      } else if (e.type == SDL_MOUSEMOTION) {
-        // Check if mouse is hovering over the button
-        int mouseX = e.motion.x;
-        int mouseY = e.motion.y;
-        toggleButton.hovered = isPointInButton(mouseX, mouseY, &toggleButton);
-      } else if (e.type == SDL_MOUSEBUTTONDOWN) {
-        // Check if button is clicked
-        int mouseX = e.button.x;
-        int mouseY = e.button.y;
-        if (isPointInButton(mouseX, mouseY, &toggleButton)) {
-          toggleButton.pressed = true;
-        }
-      } else if (e.type == SDL_MOUSEBUTTONUP) {
-        // Check if button is released
-        int mouseX = e.button.x;
-        int mouseY = e.button.y;
-        if (toggleButton.pressed &&
-            isPointInButton(mouseX, mouseY, &toggleButton)) {
-          // Toggle alignment
-          rightAligned = !rightAligned;
-
-          // Clear all keys when toggling to start fresh
-          for (int i = 0; i < MAX_KEYS; i++) {
-            keyDisplays[i].active = false;
-          }
-          activeKeyCount = 0;
-          currentLineWidth = 0;
-        }
-        toggleButton.pressed = false;
-      }
+      handleEvent(&e);
+    }
+    checkLatencyDump();
+    profilerMark(&profiler, PROFILE_EVENTS);
+
+    // Report how often we woke up and drew
+    Uint32 statsElapsed = SDL_GetTicks() - statsStartTime;
+    if (showStats && statsElapsed >= STATS_INTERVAL) {
+      printf("Idle wakeups: %.2f/s, frames rendered: %.2f/s\n",
+             idleWakeups * 1000.0 / statsElapsed,
+             framesRendered * 1000.0 / statsElapsed);
+      framePacerPrintReport(&framePacer);
+      printKeyLineStats();
+      idleWakeups = 0;
+      framesRendered = 0;
+      statsStartTime = SDL_GetTicks();
     }
 
-    // Clear screen with transparent background
-    SDL_SetRenderDrawColor(renderer, chromaKeyColor.r, chromaKeyColor.g,
-                           chromaKeyColor.b, chromaKeyColor.a);
-    SDL_RenderClear(renderer);
+    // Always draw the newest snapshot; nothing new to draw keeps the last
+    // presented frame on screen
+    const SceneSnapshot *snapshot = snapshotBufferAcquire(&sceneSnapshots);
+    bool presented = false;
+    if (lineOnScreen || needsRedraw || snapshot->sequence != drawnSequence) {
+      needsRedraw = false;
+      framesRendered++;
+      lineOnScreen = renderFrame(renderer, snapshot);
+
+      // Update the screen
+      SDL_RenderPresent(renderer);
+      framePacerPresented(&framePacer);
+      presented = true;
+      reportFirstFrame();
+      profilerMark(&profiler, PROFILE_PRESENT);
+      recordFrameLatency(LATENCY_PRESENT);
+      profilerEndFrame(&profiler);
+    }
 
-    Uint32 currentTime = SDL_GetTicks();
+    // Views are drawn once the window has its frame
+    viewsOnScreen = renderViews(false);
 
-    // Only proceed if we have active keys
-    if (activeKeyCount > 0) {
-      // Calculate alpha based on elapsed time since last key press
-      Uint32 elapsedTime = currentTime - lastKeyPressTime;
+    // Hold the next frame of a running fade to the pacer's deadline
+    if (lineOnScreen || viewsOnScreen) {
+      framePacerWait(&framePacer, presented);
+    }
+  }
 
-      if (elapsedTime > FADE_DURATION) {
-        // Reset all keys if fade time has passed
-        for (int i = 0; i < MAX_KEYS; i++) {
-          keyDisplays[i].active = false;
-        }
-        activeKeyCount = 0;
-        currentLineWidth = 0;
-      } else {
-        // Calculate alpha for fading (both text and background)
-        Uint8 alpha = 255 - (Uint8)((elapsedTime * 255) / FADE_DURATION);
-
-        // Calculate Y position to center vertically
-        int maxHeight = 0;
-        for (int i = 0; i < MAX_KEYS; i++) {
-          if (keyDisplays[i].active && keyDisplays[i].height > maxHeight) {
-            maxHeight = keyDisplays[i].height;
-          }
-        }
+  // The semaphore stays around: a capture thread may still be posting to it
+  SDL_AtomicSet(&simQuit, 1);
+  SDL_SemPost(simWake);
+  SDL_WaitThread(simThread, NULL);
+}
 
-        int y = WINDOW_HEIGHT / 2 - maxHeight / 2;
+// Headless main loop: render every frame into the offscreen framebuffer on
+// a virtual clock that advances exactly one frame period per frame
+void runHeadlessLoop(HeadlessTarget *target) {
+  SDL_Event e;
+  Uint32 startTime = SDL_GetTicks();
+  Uint64 startUs = sceneClockNowUs();
+  Uint64 frames = 0;
 
-        // First, determine the total width of all keys to create a universal
-        // background
-        int totalWidth = 0;
-        int activeKeys = 0;
+  // Frames are due at the virtual rate scaled to the wall clock
+  framePacerInit(&framePacer, headlessFps * headlessSpeed, false);
 
-        for (int i = 0; i < MAX_KEYS; i++) {
-          if (keyDisplays[i].active) {
-            if (activeKeys > 0) {
-              totalWidth += KEY_GAP;
-            }
-            totalWidth += keyDisplays[i].width;
-            activeKeys++;
-          }
-        }
+  while (!shouldQuit &&
+         (headlessFrameLimit == 0 || frames < headlessFrameLimit)) {
+    // Microseconds, so rates that do not divide a second step evenly
+    sceneClockSet(startUs + (Uint64)(frames * 1000000.0 / headlessFps));
+    profilerBeginFrame(&profiler);
 
-        // Draw a single background for all keys
-        if (activeKeys > 0) {
-          SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
-          SDL_SetRenderDrawColor(renderer, bgColor.r, bgColor.g, bgColor.b,
-                                 alpha);
-
-          SDL_Rect bgRect;
-          if (rightAligned) {
-            // Right-aligned background
-            bgRect.x = WINDOW_WIDTH - RIGHT_MARGIN - totalWidth - 4;
-            bgRect.y = y - 4;
-            bgRect.w = totalWidth + 8;
-            bgRect.h = maxHeight + 8;
-          } else {
-            // Left-aligned background
-            bgRect.x = LEFT_MARGIN - 4;
-            bgRect.y = y - 4;
-            bgRect.w = totalWidth + 8;
-            bgRect.h = maxHeight + 8;
-          }
-
-          SDL_RenderFillRect(renderer, &bgRect);
-        }
+    // Only SDL_QUIT (e.g. from Ctrl+C) arrives without a window
+    while (SDL_PollEvent(&e) != 0) {
+      handleEvent(&e);
+    }
 
-        // Render all keys based on alignment
-        if (rightAligned) {
-          // Right-to-left rendering
-          int currentX = WINDOW_WIDTH - RIGHT_MARGIN;
-
-          // Render keys in reverse order for right-to-left
-          for (int i = MAX_KEYS - 1; i >= 0; i--) {
-            if (keyDisplays[i].active) {
-              // Create a surface for the text
-              SDL_Surface *textSurface =
-                  TTF_RenderText_Blended(font, keyDisplays[i].text, textColor);
-              if (textSurface) {
-                // Position text right-aligned
-                currentX -= textSurface->w;
-
-                // Create texture from surface
-                SDL_Texture *textTexture =
-                    SDL_CreateTextureFromSurface(renderer, textSurface);
-
-                // Set the alpha for fading text
-                SDL_SetTextureAlphaMod(textTexture, alpha);
-
-                // Render the text
-                SDL_Rect renderRect = {currentX, y, textSurface->w,
-                                       textSurface->h};
-
-                SDL_RenderCopy(renderer, textTexture, NULL, &renderRect);
-
-                // Update X position for next key (move left)
-                currentX -= KEY_GAP;
-
-                // Clean up
-                SDL_FreeSurface(textSurface);
-                SDL_DestroyTexture(textTexture);
-              }
-            }
-          }
-        } else {
-          // Left-to-right rendering (original behavior)
-          int currentX = LEFT_MARGIN;
-
-          for (int i = 0; i < MAX_KEYS; i++) {
-            if (keyDisplays[i].active) {
-              // Create a surface for the text
-              SDL_Surface *textSurface =
-                  TTF_RenderText_Blended(font, keyDisplays[i].text, textColor);
-              if (textSurface) {
-                // Create texture from surface
-                SDL_Texture *textTexture =
-                    SDL_CreateTextureFromSurface(renderer, textSurface);
-
-                // Set the alpha for fading text
-                SDL_SetTextureAlphaMod(textTexture, alpha);
-
-                // Render the text
-                SDL_Rect renderRect = {currentX, y, textSurface->w,
-                                       textSurface->h};
-
-                SDL_RenderCopy(renderer, textTexture, NULL, &renderRect);
-
-                // Update X position for next key
-                currentX += textSurface->w + KEY_GAP;
-
-                // Clean up
-                SDL_FreeSurface(textSurface);
-                SDL_DestroyTexture(textTexture);
-              }
-            }
-          }
-        }
+    // Lay keys out in lockstep with the virtual clock
+    simStep(sceneClockNowUs());
+    profilerMark(&profiler, PROFILE_EVENTS);
+
+    renderFrame(target->renderer, snapshotBufferAcquire(&sceneSnapshots));
+    headlessPresent(target);
+    framePacerPresented(&framePacer);
+    reportFirstFrame();
+    profilerMark(&profiler, PROFILE_PRESENT);
+    recordFrameLatency(LATENCY_PRESENT);
+    profilerEndFrame(&profiler);
+
+    // Every view gets every frame of the virtual clock too
+    renderViews(true);
+    checkLatencyDump();
+    frames++;
+
+    // A replay run is over once the log is done and the line faded out
+    if (replaying && keyLogReplayDone(&keyLogReplay) &&
+        keyLine->activeKeyCount == 0) {
+      break;
+    }
+
+    // Pace against the wall clock unless running as fast as possible
+    framePacerWait(&framePacer, false);
+  }
+
+  Uint32 wallElapsed = SDL_GetTicks() - startTime;
+  printf("Headless: rendered %llu frames in %u ms (%.1f fps)\n",
+         (unsigned long long)frames, (unsigned)wallElapsed,
+         wallElapsed > 0 ? frames * 1000.0 / wallElapsed : 0.0);
+}
+
+int main(int argc, char *argv[]) {
+  startupTicks = SDL_GetPerformanceCounter();
+
+  // Parse command line options
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--stats") == 0) {
+      showStats = true;
+      continue;
+    }
+    if (strcmp(argv[i], "--hud") == 0) {
+      profiler.visible = true;
+      continue;
+    }
+    if (strcmp(argv[i], "--latency") == 0) {
+      showLatency = true;
+      continue;
+    }
+    if (strcmp(argv[i], "--no-coalesce") == 0) {
+      coalesceKeys = false;
+      continue;
+    }
+    if (strcmp(argv[i], "--coalesce-window") == 0 && i + 1 < argc) {
+      coalesceWindow = (Uint32)atoi(argv[++i]);
+      continue;
+    }
+    if (strcmp(argv[i], "--coalesce-chords") == 0) {
+      coalesceChords = true;
+      continue;
+    }
+    if (strcmp(argv[i], "--mouse") == 0) {
+      captureMouse = true;
+      continue;
+    }
+    if (strcmp(argv[i], "--width") == 0 && i + 1 < argc) {
+      canvasWidth = atoi(argv[++i]);
+      if (canvasWidth <= 0) {
+        canvasWidth = WINDOW_WIDTH;
+      }
+      continue;
+    }
+    if (strcmp(argv[i], "--height") == 0 && i + 1 < argc) {
+      canvasHeight = atoi(argv[++i]);
+      if (canvasHeight <= 0) {
+        canvasHeight = WINDOW_HEIGHT;
+      }
+      continue;
+    }
+    if (strcmp(argv[i], "--scale") == 0 && i + 1 < argc) {
+      canvasScale = (float)atof(argv[++i]);
+      continue;
+    }
+    if (strcmp(argv[i], "--no-baked-labels") == 0) {
+      sceneFontsBaked = false;
+      continue;
+    }
+    if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc) {
+      targetFps = atof(argv[++i]);
+      continue;
+    }
+    if (strcmp(argv[i], "--headless") == 0) {
+      headless = true;
+      continue;
+    }
+    if (strcmp(argv[i], "--headless-fps") == 0 && i + 1 < argc) {
+      headlessFps = atof(argv[++i]);
+      if (headlessFps <= 0) {
+        headlessFps = 60.0;
+      }
+      continue;
+    }
+    if (strcmp(argv[i], "--headless-speed") == 0 && i + 1 < argc) {
+      headlessSpeed = atof(argv[++i]);
+      continue;
+    }
+    if (strcmp(argv[i], "--headless-frames") == 0 && i + 1 < argc) {
+      headlessFrameLimit = strtoull(argv[++i], NULL, 10);
+      continue;
+    }
+    if (strcmp(argv[i], "--headless-out") == 0 && i + 1 < argc) {
+      headlessOutputPath = argv[++i];
+      continue;
+    }
+    if (strcmp(argv[i], "--view") == 0 && i + 1 < argc) {
+      i++;
+      if (viewCount == SCENE_VIEW_MAX) {
+        printf("At most %d views; ignoring --view %s\n", SCENE_VIEW_MAX,
+               argv[i]);
+      } else if (sceneViewParse(&views[viewCount], argv[i])) {
+        viewCount++;
+      }
+      continue;
+    }
+    if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+      recordPath = argv[++i];
+      continue;
+    }
+    if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+      replayPath = argv[++i];
+      continue;
+    }
+    if (strcmp(argv[i], "--usage-stats") == 0 && i + 1 < argc) {
+      usageStatsPath = argv[++i];
+      continue;
+    }
+    if (strcmp(argv[i], "--usage-dump") == 0 && i + 1 < argc) {
+      // Report on a statistics file and exit, without opening anything else
+      return usageStatsDump(argv[++i]) ? 0 : 1;
+    }
+    if (strcmp(argv[i], "--replay-speed") == 0 && i + 1 < argc) {
+      i++;
+      replaySpeed =
+          strcmp(argv[i], "max") == 0 ? KEYLOG_SPEED_MAX : atof(argv[i]);
+      continue;
+    }
+#ifndef _WIN32
+    if (strcmp(argv[i], "--shm-out") == 0 && i + 1 < argc) {
+      shmOutputName = argv[++i];
+      continue;
+    }
+    if (strcmp(argv[i], "--shm-slots") == 0 && i + 1 < argc) {
+      shmOutputSlots = atoi(argv[++i]);
+      if (shmOutputSlots < 2) {
+        shmOutputSlots = 2;
+      }
+      continue;
+    }
+    if (strcmp(argv[i], "--listen") == 0 && i + 1 < argc) {
+      listenPath = argv[++i];
+      continue;
+    }
+    if (strcmp(argv[i], "--listen-tcp") == 0 && i + 1 < argc) {
+      listenPort = atoi(argv[++i]);
+      continue;
+    }
+    if (strcmp(argv[i], "--ws-port") == 0 && i + 1 < argc) {
+      wsPort = atoi(argv[++i]);
+      continue;
+    }
+    if (strcmp(argv[i], "--ws-origin") == 0 && i + 1 < argc) {
+      wsOrigin = argv[++i];
+      continue;
+    }
+#endif
+#ifdef __linux__
+    if (strcmp(argv[i], "--evdev-replay") == 0 && i + 1 < argc) {
+      evdevReplayPath = argv[++i];
+      continue;
+    }
+    if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc) {
+      captureBackend = argv[++i];
+      if (strcmp(captureBackend, "auto") != 0 &&
+          strcmp(captureBackend, "evdev") != 0 &&
+          strcmp(captureBackend, "x11") != 0) {
+        printf("Unknown capture backend %s; using auto.\n", captureBackend);
+        captureBackend = "auto";
       }
+      continue;
+    }
+#endif
+    printf("Unknown option: %s\n", argv[i]);
+  }
+
+  keyCoalescerInit(&keyCoalescer, coalesceWindow, coalesceChords);
+
+#ifndef _WIN32
+  if (shmOutputName && !headless) {
+    printf("--shm-out needs --headless; shared memory output disabled.\n");
+  }
+#endif
+
+  // Headless mode draws with the software renderer and needs no display
+  Uint32 sdlFlags =
+      headless ? SDL_INIT_EVENTS : SDL_INIT_VIDEO | SDL_INIT_EVENTS;
+  if (SDL_Init(sdlFlags) < 0) {
+    printf("SDL could not initialize! SDL_Error: %s\n", SDL_GetError());
+    return 1;
+  }
+  sceneClockInit();
+
+  if (TTF_Init() < 0) {
+    printf("SDL_ttf could not initialize! TTF_Error: %s\n", TTF_GetError());
+    SDL_Quit();
+    return 1;
+  }
+
+  SDL_Window *window = NULL;
+  SDL_Renderer *renderer = NULL;
+  HeadlessTarget headlessTarget;
+
+  if (headless) {
+    // Render into an in-memory RGBA framebuffer
+    if (!headlessInit(&headlessTarget, canvasWidth, canvasHeight,
+                      headlessOutputPath)) {
+      TTF_Quit();
+      SDL_Quit();
+      return 1;
+    }
+    renderer = headlessTarget.renderer;
+
+#ifndef _WIN32
+    // Optionally hand every frame to a local compositor through shared memory
+    if (shmOutputName &&
+        shmOutputOpen(&shmOutput, shmOutputName, canvasWidth, canvasHeight,
+                      shmOutputSlots)) {
+      headlessSetFrameCallback(&headlessTarget, publishShmFrame, &shmOutput);
+    }
+#endif
+  } else {
+    // Create window
+    window = SDL_CreateWindow("KeyCapper", SDL_WINDOWPOS_UNDEFINED,
+                              SDL_WINDOWPOS_UNDEFINED, canvasWidth,
+                              canvasHeight,
+                              SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE);
+    if (!window) {
+      printf("Window could not be created! SDL_Error: %s\n", SDL_GetError());
+      TTF_Quit();
+      SDL_Quit();
+      return 1;
+    }
+
+    renderer = SDL_CreateRenderer(
+        window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+    if (!renderer) {
+      printf("Renderer could not be created! SDL_Error: %s\n", SDL_GetError());
+      SDL_DestroyWindow(window);
+      TTF_Quit();
+      SDL_Quit();
+      return 1;
+    }
+  }
+
+  // Open the embedded fonts for the canvas scale
+  if (!setSceneCanvas(canvasWidth, canvasHeight, canvasScale)) {
+    printf("Could not open the embedded fonts.\n");
+    destroyOutput(window, renderer, &headlessTarget);
+    TTF_Quit();
+    SDL_Quit();
+    return 1;
+  }
+
+  // Extra views draw with the same renderer; one that cannot be set up is
+  // left out
+  int atlasSize = sceneLayout.atlasSize;
+  int openViews = 0;
+#ifndef _WIN32
+  int viewShmSlots = shmOutputSlots;
+#else
+  int viewShmSlots = 0;
+#endif
+  for (int i = 0; i < viewCount; i++) {
+    SceneView *view = &views[openViews];
+    *view = views[i];
+    if (!sceneViewOpen(view, renderer, coalesceKeys, coalesceWindow,
+                       coalesceChords, viewShmSlots)) {
+      sceneViewClose(view);
+      continue;
+    }
+    if (view->layout.atlasSize > atlasSize) {
+      atlasSize = view->layout.atlasSize;
     }
+    openViews++;
+  }
+  viewCount = openViews;
+
+  // Create the atlas that every label is rasterized into once, for every
+  // view's scale
+  if (!labelCacheInit(&labelCache, renderer, atlasSize)) {
+    closeViews();
+    sceneFontsCloseAll();
+    destroyOutput(window, renderer, &headlessTarget);
+    TTF_Quit();
+    SDL_Quit();
+    return 1;
+  }
+
+  // The headless framebuffer is plain memory: compose the key line there
+  // with the blend kernels, which need the labels' coverage on the CPU
+  if (headless && labelCacheKeepCoverage(&labelCache)) {
+    lineComposite.framebuffer = headlessTarget.surface;
+  }
+
+  // Start from the labels baked at build time when the scale matches them
+  if (sceneFontsLoadLabels(&labelCache, sceneLayout.fonts)) {
+    printf("Loaded the baked label atlas.\n");
+  }
+
+  // Initialize key displays and the toggle button
+  initScene();
 
-    // Draw the toggle button with the smaller font
-    drawButton(renderer, buttonFont, &toggleButton);
+#ifndef _WIN32
+  signal(SIGUSR1, requestLatencyDump);
+#endif
+
+  // Set up global key capture for all platforms
+  keyRingInit(&captureRing);
+  keyRingInit(&netRing);
+  keyRingInit(&layoutRing);
+  snapshotBufferInit(&sceneSnapshots);
+  mouseAggregatorInit(&mouseAggregator, &captureRing,
+                      MOUSE_AGGREGATE_PERIOD_MS);
+  setupGlobalKeyCapture();
 
-    // Update the screen
-    SDL_RenderPresent(renderer);
+#ifndef _WIN32
+  // Accept keys from producers on other machines or in containers
+  if (listenPath || listenPort > 0) {
+    netListening = netInputStart(&netRing, listenPath, listenPort);
+  }
 
-    // Small delay to reduce CPU usage
-    SDL_Delay(16);
+  // Stream the line to browser sources
+  if (wsPort > 0) {
+    wsStreaming = wsOutputStart(wsPort, wsOrigin);
+  }
+#endif
+
+  // Optional keystroke log and replay source
+  if (recordPath) {
+    recording = keyLogWriterOpen(&keyLogWriter, recordPath);
+  }
+  if (replayPath) {
+    replaying = keyLogReplayOpen(&keyLogReplay, replayPath, replaySpeed);
+  }
+  if (usageStatsPath) {
+    countingUsage = usageStatsOpen(&usageStats, usageStatsPath,
+                                   coalesceWindow);
+  }
+
+  // Main loop
+  if (headless) {
+    runHeadlessLoop(&headlessTarget);
+  } else {
+    runWindowLoop(window, renderer);
   }
 
   // Clean up
-  TTF_CloseFont(font);
-  if (buttonFont != font) {
-    TTF_CloseFont(buttonFont);
+#ifdef __linux__
+  if (evdevCapturing) {
+    evdevCaptureStop();
   }
-  SDL_DestroyRenderer(renderer);
-  SDL_DestroyWindow(window);
+#ifdef HAVE_XINPUT2
+  if (x11Capturing) {
+    x11CaptureStop();
+    x11CapturePrintStats();
+  }
+#endif
+#endif
+#ifndef _WIN32
+  if (netListening) {
+    netInputStop();
+    netInputPrintStats();
+  }
+  if (wsStreaming) {
+    wsOutputStop();
+    wsOutputPrintStats();
+  }
+#endif
+  if (recording) {
+    printf("Recorded %llu keys to %s\n",
+           (unsigned long long)keyLogWriter.recordCount, recordPath);
+    keyLogWriterClose(&keyLogWriter);
+  }
+  if (replaying) {
+    keyLogReplayClose(&keyLogReplay);
+  }
+  if (countingUsage) {
+    usageStatsClose(&usageStats);
+  }
+  labelCachePrintStats(&labelCache);
+  printKeyLineStats();
+  framePacerPrintStats(&framePacer);
+  if (captureMouse) {
+    mouseAggregatorPrintStats(&mouseAggregator);
+  }
+  if (showLatency) {
+    latencyPrint();
+  }
+  printf("Key events dropped on overflow: %d\n",
+         keyRingOverflows(&captureRing));
+  closeViews();
+  destroyLineComposite(&lineComposite);
+  labelCacheDestroy(&labelCache);
+  sceneFontsCloseAll();
+  destroyOutput(window, renderer, &headlessTarget);
   TTF_Quit();
   SDL_Quit();
 
@@ -0,0 +1,101 @@
+#include "mouse_aggregate.h"
+
+#include <stdio.h>
+#include <string.h>
+
+void mouseAggregatorInit(MouseAggregator *aggregator, KeyRing *ring,
+                         Uint32 periodMs) {
+  memset(aggregator, 0, sizeof(*aggregator));
+  aggregator->ring = ring;
+  aggregator->periodMs = periodMs;
+}
+
+// Push an event standing for count inputs, split if it holds more than one
+// event can carry
+static void pushCounted(MouseAggregator *aggregator, KeyEvent *event,
+                        int count) {
+  while (count > 0) {
+    int chunk = count < KEY_EVENT_COUNT_MAX ? count : KEY_EVENT_COUNT_MAX;
+    keyEventSetCount(event, chunk);
+    keyRingPush(aggregator->ring, event);
+    aggregator->events++;
+    count -= chunk;
+  }
+}
+
+// Push what the source folded, if anything, and start its next period
+static void endPeriod(MouseAggregator *aggregator, MouseSource *source,
+                      Uint32 now) {
+  if (source->count > 0) {
+    pushCounted(aggregator, &source->first, source->count);
+    source->count = 0;
+    source->periodStart = now;
+  } else {
+    // A quiet period: the next input is pushed straight away again
+    source->active = false;
+  }
+}
+
+void mouseAggregatorAdd(MouseAggregator *aggregator, KeySymbol symbol,
+                        int count, Uint64 ageNs) {
+  if (!keySymbolIsMouse(symbol) || count <= 0) {
+    return;
+  }
+  MouseSource *source = &aggregator->sources[symbol - KSYM_MOUSE_LEFT];
+  Uint32 now = SDL_GetTicks();
+  aggregator->inputs += count;
+
+  if (source->active && now - source->periodStart >= aggregator->periodMs) {
+    endPeriod(aggregator, source, now);
+  }
+
+  if (!source->active) {
+    KeyEvent event;
+    keyEventInit(&event, symbol, 0);
+    keyEventSetCaptureAge(&event, ageNs);
+    pushCounted(aggregator, &event, count);
+    source->active = true;
+    source->periodStart = now;
+    return;
+  }
+
+  // Latency is measured from the oldest input the event stands for
+  if (source->count == 0) {
+    keyEventInit(&source->first, symbol, 0);
+    keyEventSetCaptureAge(&source->first, ageNs);
+  }
+  source->count += count;
+}
+
+int mouseAggregatorFlush(MouseAggregator *aggregator) {
+  Uint32 now = SDL_GetTicks();
+  int timeout = -1;
+  for (int i = 0; i < MOUSE_SOURCE_COUNT; i++) {
+    MouseSource *source = &aggregator->sources[i];
+    if (!source->active) {
+      continue;
+    }
+    Uint32 elapsed = now - source->periodStart;
+    if (elapsed >= aggregator->periodMs) {
+      endPeriod(aggregator, source, now);
+      if (!source->active) {
+        continue;
+      }
+      elapsed = 0;
+    }
+    int remaining = (int)(aggregator->periodMs - elapsed);
+    if (timeout < 0 || remaining < timeout) {
+      timeout = remaining;
+    }
+  }
+  return timeout;
+}
+
+void mouseAggregatorPrintStats(const MouseAggregator *aggregator) {
+  printf("Mouse: %llu clicks and wheel steps as %llu events (%.1fx)\n",
+         (unsigned long long)aggregator->inputs,
+         (unsigned long long)aggregator->events,
+         aggregator->events > 0
+             ? (double)aggregator->inputs / aggregator->events
+             : 0.0);
+}
@@ -0,0 +1,53 @@
+#ifndef MOUSE_AGGREGATE_H
+#define MOUSE_AGGREGATE_H
+
+#include <stdbool.h>
+
+#ifdef _WIN32
+#include <SDL.h>
+#else
+#include <SDL2/SDL.h>
+#endif
+
+#include "key_ring.h"
+#include "keysyms.h"
+
+#define MOUSE_AGGREGATE_PERIOD_MS 16 // About one frame at 60 Hz
+#define MOUSE_SOURCE_COUNT (KSYM_WHEEL_RIGHT - KSYM_MOUSE_LEFT + 1)
+
+typedef struct {
+  KeyEvent first;     // First input folded this period, with its capture time
+  int count;          // Inputs folded this period and not yet pushed
+  Uint32 periodStart; // SDL_GetTicks() when the period began
+  bool active;        // Inputs are folded until the period ends
+} MouseSource;
+
+// Folds high-rate mouse input on the capture thread, so a free-spinning
+// wheel or a burst of clicks reaches the ring as at most one counted event
+// per button or wheel direction per period ("Wheel Down ×14") instead of
+// hundreds of single ones. The first input after a quiet period is pushed
+// at once, so a lone click costs no extra latency; later ones are held until
+// the period ends. Only the thread that pushes to ring may use it.
+typedef struct {
+  KeyRing *ring;
+  Uint32 periodMs;
+  MouseSource sources[MOUSE_SOURCE_COUNT];
+  Uint64 inputs; // Button presses and wheel steps seen
+  Uint64 events; // Events pushed for them
+} MouseAggregator;
+
+void mouseAggregatorInit(MouseAggregator *aggregator, KeyRing *ring,
+                         Uint32 periodMs);
+
+// Capture side: count presses of a mouse button or wheel steps in one
+// direction, which the OS stamped ageNs ago
+void mouseAggregatorAdd(MouseAggregator *aggregator, KeySymbol symbol,
+                        int count, Uint64 ageNs);
+
+// Capture side: push what was folded in periods that are over. Returns the
+// milliseconds until it needs calling again, or -1 if nothing is held back.
+int mouseAggregatorFlush(MouseAggregator *aggregator);
+
+void mouseAggregatorPrintStats(const MouseAggregator *aggregator);
+
+#endif
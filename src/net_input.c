@@ -0,0 +1,433 @@
+#ifndef _WIN32
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "net_input.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <SDL2/SDL.h>
+
+#define NET_INPUT_MAX_CONNECTIONS 8
+#define NET_INPUT_BUFFER 4096 // Per-connection bytes read ahead of the ring
+#define NET_INPUT_RETRY_MS 2  // Poll interval while a record is held back
+
+// One producer. Bytes are read into buffer only as far as the key ring can
+// take the events in them; the rest stay in the socket.
+typedef struct {
+  int fd;
+  int id; // Connection number, for messages
+  bool greeted;
+  int batchRemaining; // Records still to come in the current batch
+  unsigned char buffer[NET_INPUT_BUFFER];
+  size_t buffered;
+  bool heldBack; // The next record is waiting for room in the ring
+  bool behind;   // Held back since behindSince without catching up
+  Uint32 behindSince;
+
+  Uint64 received; // Records parsed
+  Uint64 queued;   // Records pushed to the ring
+  Uint64 dropped;  // Records thrown away after falling too far behind
+  Uint64 stalls;   // Times the connection fell behind the ring
+} NetConnection;
+
+typedef struct {
+  Uint64 connections;
+  Uint64 received;
+  Uint64 queued;
+  Uint64 dropped;
+  Uint64 stalls;
+} NetInputTotals;
+
+static NetConnection connections[NET_INPUT_MAX_CONNECTIONS];
+static int unixFd = -1;
+static int tcpFd = -1;
+static int stopPipe[2] = {-1, -1};
+static char unixPath[sizeof(((struct sockaddr_un *)0)->sun_path)];
+static pthread_t inputThread;
+static bool threadRunning = false;
+static KeyRing *eventRing = NULL;
+static NetInputTotals totals;
+static int nextConnectionId = 1;
+
+static bool setNonBlocking(int fd) {
+  int flags = fcntl(fd, F_GETFL, 0);
+  return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+static int listenUnix(const char *path) {
+  struct sockaddr_un address;
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (strlen(path) >= sizeof(address.sun_path)) {
+    printf("Socket path too long: %s\n", path);
+    return -1;
+  }
+  snprintf(address.sun_path, sizeof(address.sun_path), "%s", path);
+
+  // A socket file left behind by an earlier run would make bind fail, but
+  // anything else at the path is not ours to delete
+  struct stat info;
+  if (lstat(path, &info) == 0) {
+    if (!S_ISSOCK(info.st_mode)) {
+      printf("Not listening on %s: it exists and is not a socket\n", path);
+      return -1;
+    }
+    unlink(path);
+  }
+
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) {
+    return -1;
+  }
+  if (bind(fd, (struct sockaddr *)&address, sizeof(address)) < 0 ||
+      listen(fd, NET_INPUT_MAX_CONNECTIONS) < 0 || !setNonBlocking(fd)) {
+    printf("Failed to listen on %s: %s\n", path, strerror(errno));
+    close(fd);
+    return -1;
+  }
+  snprintf(unixPath, sizeof(unixPath), "%s", path);
+  printf("Listening for key producers on %s\n", path);
+  return fd;
+}
+
+// Loopback only: there is no authentication, so never listen on a LAN
+static int listenTcp(int port) {
+  struct sockaddr_in address;
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = htons((uint16_t)port);
+
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) {
+    return -1;
+  }
+  int reuse = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+  if (bind(fd, (struct sockaddr *)&address, sizeof(address)) < 0 ||
+      listen(fd, NET_INPUT_MAX_CONNECTIONS) < 0 || !setNonBlocking(fd)) {
+    printf("Failed to listen on 127.0.0.1:%d: %s\n", port, strerror(errno));
+    close(fd);
+    return -1;
+  }
+  printf("Listening for key producers on 127.0.0.1:%d\n", port);
+  return fd;
+}
+
+static void acceptConnection(int listenFd) {
+  for (;;) {
+    int fd = accept(listenFd, NULL, NULL);
+    if (fd < 0) {
+      return;
+    }
+    NetConnection *connection = NULL;
+    for (int i = 0; i < NET_INPUT_MAX_CONNECTIONS; i++) {
+      if (connections[i].fd < 0) {
+        connection = &connections[i];
+        break;
+      }
+    }
+    if (!connection || !setNonBlocking(fd)) {
+      printf("Key producer refused: %d connections already open\n",
+             NET_INPUT_MAX_CONNECTIONS);
+      close(fd);
+      continue;
+    }
+
+    memset(connection, 0, sizeof(*connection));
+    connection->fd = fd;
+    connection->id = nextConnectionId++;
+    totals.connections++;
+    printf("Key producer %d connected\n", connection->id);
+  }
+}
+
+static void closeConnection(NetConnection *connection, const char *reason) {
+  printf("Key producer %d %s: %llu received, %llu queued, %llu dropped, "
+         "%llu stalls\n",
+         connection->id, reason, (unsigned long long)connection->received,
+         (unsigned long long)connection->queued,
+         (unsigned long long)connection->dropped,
+         (unsigned long long)connection->stalls);
+  close(connection->fd);
+  connection->fd = -1;
+}
+
+// Whether a connection has been behind for so long that its backlog is
+// dropped until it catches up with the producer
+static bool connectionLate(const NetConnection *connection, Uint32 now) {
+  return connection->behind &&
+         now - connection->behindSince >= NET_KEYS_STALL_MS;
+}
+
+// Push one record, or hold it back while the ring is full. Returns whether
+// the record was used up.
+static bool queueRecord(NetConnection *connection, const NetKeysRecord *record,
+                        Uint32 now) {
+  if (connectionLate(connection, now)) {
+    connection->heldBack = false;
+    connection->dropped++;
+    totals.dropped++;
+    return true;
+  }
+  if (keyRingSpace(eventRing) == 0) {
+    if (!connection->behind) {
+      connection->behind = true;
+      connection->behindSince = now;
+      connection->stalls++;
+      totals.stalls++;
+    }
+    connection->heldBack = true;
+    return false;
+  }
+  connection->heldBack = false;
+
+  Uint16 symbol = SDL_SwapLE16(record->symbol);
+  KeyEvent event;
+  keyEventInit(&event, symbol < KSYM_COUNT ? (KeySymbol)symbol : KSYM_UNKNOWN,
+               SDL_SwapLE16(record->flags));
+  keyEventSetCaptureAge(&event, (Uint64)SDL_SwapLE32(record->ageUs) * 1000);
+  keyRingPush(eventRing, &event);
+  connection->queued++;
+  totals.queued++;
+  return true;
+}
+
+// Queue every complete record in the buffer that the ring has room for.
+// Returns false on a protocol error.
+static bool parseConnection(NetConnection *connection, Uint32 now) {
+  size_t consumed = 0;
+  bool ok = true;
+  for (;;) {
+    const unsigned char *data = connection->buffer + consumed;
+    size_t available = connection->buffered - consumed;
+
+    if (!connection->greeted) {
+      NetKeysHello hello;
+      if (available < sizeof(hello)) {
+        break;
+      }
+      memcpy(&hello, data, sizeof(hello));
+      if (SDL_SwapLE32(hello.magic) != NET_KEYS_MAGIC ||
+          SDL_SwapLE16(hello.version) != NET_KEYS_VERSION ||
+          SDL_SwapLE16(hello.recordSize) != sizeof(NetKeysRecord)) {
+        ok = false;
+        break;
+      }
+      connection->greeted = true;
+      consumed += sizeof(hello);
+    } else if (connection->batchRemaining == 0) {
+      NetKeysBatchHeader header;
+      if (available < sizeof(header)) {
+        break;
+      }
+      memcpy(&header, data, sizeof(header));
+      int count = SDL_SwapLE16(header.count);
+      if (count == 0 || count > NET_KEYS_MAX_BATCH) {
+        ok = false;
+        break;
+      }
+      connection->batchRemaining = count;
+      consumed += sizeof(header);
+    } else {
+      NetKeysRecord record;
+      if (available < sizeof(record)) {
+        break;
+      }
+      memcpy(&record, data, sizeof(record));
+      if (!queueRecord(connection, &record, now)) {
+        break;
+      }
+      connection->received++;
+      totals.received++;
+      connection->batchRemaining--;
+      consumed += sizeof(record);
+    }
+  }
+
+  memmove(connection->buffer, connection->buffer + consumed,
+          connection->buffered - consumed);
+  connection->buffered -= consumed;
+  return ok;
+}
+
+// Read as much as fits in the buffer and queue what was read
+static void readConnection(NetConnection *connection, Uint32 now) {
+  while (connection->buffered < sizeof(connection->buffer)) {
+    ssize_t bytes = read(connection->fd, connection->buffer +
+                                             connection->buffered,
+                         sizeof(connection->buffer) - connection->buffered);
+    if (bytes < 0 && errno == EINTR) {
+      continue;
+    }
+    if (bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      // Everything the producer sent so far is in the ring
+      if (connection->buffered == 0) {
+        connection->behind = false;
+      }
+      return;
+    }
+    if (bytes <= 0) {
+      closeConnection(connection, "disconnected");
+      return;
+    }
+    connection->buffered += (size_t)bytes;
+    if (!parseConnection(connection, now)) {
+      closeConnection(connection, "sent a malformed stream");
+      return;
+    }
+    if (connection->heldBack) {
+      return;
+    }
+  }
+}
+
+static void *networkThread(void *param) {
+  struct pollfd fds[NET_INPUT_MAX_CONNECTIONS + 3];
+  int slots[NET_INPUT_MAX_CONNECTIONS + 3];
+  for (;;) {
+    Uint32 now = SDL_GetTicks();
+    int count = 0;
+    bool anyHeldBack = false;
+
+    fds[count].fd = stopPipe[0];
+    fds[count].events = POLLIN;
+    slots[count++] = -1;
+    if (unixFd >= 0) {
+      fds[count].fd = unixFd;
+      fds[count].events = POLLIN;
+      slots[count++] = -1;
+    }
+    if (tcpFd >= 0) {
+      fds[count].fd = tcpFd;
+      fds[count].events = POLLIN;
+      slots[count++] = -1;
+    }
+    for (int i = 0; i < NET_INPUT_MAX_CONNECTIONS; i++) {
+      NetConnection *connection = &connections[i];
+      if (connection->fd < 0) {
+        continue;
+      }
+      // Retry a record held back by a full ring before reading any more, so
+      // the producer feels the backpressure
+      if (connection->heldBack && !parseConnection(connection, now)) {
+        closeConnection(connection, "sent a malformed stream");
+        continue;
+      }
+      anyHeldBack |= connection->heldBack;
+      fds[count].fd = connection->fd;
+      fds[count].events = connection->heldBack ? 0 : POLLIN;
+      slots[count++] = i;
+    }
+
+    int ready =
+        poll(fds, (nfds_t)count, anyHeldBack ? NET_INPUT_RETRY_MS : -1);
+    if (ready < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+    if (fds[0].revents) {
+      return NULL;
+    }
+
+    now = SDL_GetTicks();
+    for (int i = 1; i < count; i++) {
+      if (!fds[i].revents) {
+        continue;
+      }
+      if (slots[i] < 0) {
+        acceptConnection(fds[i].fd);
+      } else if (connections[slots[i]].fd >= 0) {
+        readConnection(&connections[slots[i]], now);
+      }
+    }
+  }
+  return NULL;
+}
+
+static void closeSockets(void) {
+  for (int i = 0; i < NET_INPUT_MAX_CONNECTIONS; i++) {
+    if (connections[i].fd >= 0) {
+      closeConnection(&connections[i], "closed");
+    }
+  }
+  if (unixFd >= 0) {
+    close(unixFd);
+    unlink(unixPath);
+    unixFd = -1;
+  }
+  if (tcpFd >= 0) {
+    close(tcpFd);
+    tcpFd = -1;
+  }
+  for (int i = 0; i < 2; i++) {
+    if (stopPipe[i] >= 0) {
+      close(stopPipe[i]);
+      stopPipe[i] = -1;
+    }
+  }
+}
+
+bool netInputStart(KeyRing *ring, const char *socketPath, int tcpPort) {
+  eventRing = ring;
+  for (int i = 0; i < NET_INPUT_MAX_CONNECTIONS; i++) {
+    connections[i].fd = -1;
+  }
+  if (pipe(stopPipe) < 0) {
+    return false;
+  }
+  if (socketPath) {
+    unixFd = listenUnix(socketPath);
+  }
+  if (tcpPort > 0) {
+    tcpFd = listenTcp(tcpPort);
+  }
+  if (unixFd < 0 && tcpFd < 0) {
+    closeSockets();
+    return false;
+  }
+
+  if (pthread_create(&inputThread, NULL, networkThread, NULL) != 0) {
+    closeSockets();
+    return false;
+  }
+  threadRunning = true;
+  return true;
+}
+
+void netInputStop(void) {
+  if (!threadRunning) {
+    return;
+  }
+  char byte = 0;
+  if (write(stopPipe[1], &byte, 1) == 1) {
+    pthread_join(inputThread, NULL);
+  }
+  threadRunning = false;
+  closeSockets();
+}
+
+void netInputPrintStats(void) {
+  printf("Key producers: %llu connections, %llu events received, %llu "
+         "queued, %llu dropped, %llu stalls\n",
+         (unsigned long long)totals.connections,
+         (unsigned long long)totals.received,
+         (unsigned long long)totals.queued,
+         (unsigned long long)totals.dropped,
+         (unsigned long long)totals.stalls);
+}
+
+#endif
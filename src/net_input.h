@@ -0,0 +1,26 @@
+#ifndef NET_INPUT_H
+#define NET_INPUT_H
+
+#ifndef _WIN32
+
+#include <stdbool.h>
+
+#include "key_ring.h"
+#include "net_keys.h"
+
+// Start the network input thread, which becomes the single producer for
+// ring. It accepts producers speaking the protocol in net_keys.h on a Unix
+// domain socket at socketPath and/or on 127.0.0.1:tcpPort; pass NULL or 0 to
+// leave either out. An existing socket file at socketPath is replaced.
+bool netInputStart(KeyRing *ring, const char *socketPath, int tcpPort);
+
+// Wake the input thread, close every connection and the listening sockets,
+// and join it
+void netInputStop(void);
+
+// Totals over every connection so far
+void netInputPrintStats(void);
+
+#endif
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef NET_KEYS_H
+#define NET_KEYS_H
+
+// Wire format of the key event stream accepted with --listen and
+// --listen-tcp. This header is shared with tools/key_producer.c, so it only
+// uses plain C types. Every field is little-endian.
+//
+// A producer connects and sends one NetKeysHello, followed by any number of
+// batches. A batch is a NetKeysBatchHeader and count NetKeysRecords. Several
+// batches may go out in one write and a batch may be split across writes.
+// Records carry KeySymbol ids as numbered in src/keysyms.h, as in a --record
+// log.
+//
+// Keycapper never writes to the connection. When it cannot keep up it stops
+// reading, so a producer's writes block (or return EAGAIN). A producer that
+// stays behind for longer than NET_KEYS_STALL_MS has its backlog read and
+// dropped until it catches up, since an overlay that far behind is no use.
+
+#include <stdint.h>
+
+#define NET_KEYS_MAGIC 0x5645434Bu // "KCEV"
+#define NET_KEYS_VERSION 1
+#define NET_KEYS_DEFAULT_PATH "/tmp/keycapper.sock"
+#define NET_KEYS_MAX_BATCH 256 // Records in one batch
+#define NET_KEYS_STALL_MS 250
+
+typedef struct {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t recordSize; // sizeof(NetKeysRecord)
+} NetKeysHello;
+
+typedef struct {
+  uint16_t count; // 1 to NET_KEYS_MAX_BATCH
+  uint16_t reserved;
+} NetKeysBatchHeader;
+
+typedef struct {
+  // Microseconds between the key happening and the batch being written, on
+  // the producer's own clock; 0 if unknown. Latency is measured from there,
+  // whatever the producer's clock says the time is.
+  uint32_t ageUs;
+  uint16_t symbol; // KeySymbol
+  uint16_t flags;  // KEY_EVENT_* flags, press count minus one in the high byte
+} NetKeysRecord;
+
+#endif
@@ -0,0 +1,137 @@
+#include "pixel_blend.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// x * y / 255, rounded to nearest, for x and y up to 255
+static Uint8 mul255(unsigned int x, unsigned int y) {
+  unsigned int t = x * y + 128;
+  return (Uint8)((t + (t >> 8)) >> 8);
+}
+
+static Uint8 addSaturate(unsigned int x, unsigned int y) {
+  unsigned int sum = x + y;
+  return (Uint8)(sum > 255 ? 255 : sum);
+}
+
+static void blendRowScalar(Uint8 *dst, const Uint8 *src, int count,
+                           Uint8 alpha) {
+  for (int i = 0; i < count; i++, dst += 4, src += 4) {
+    unsigned int inverse = 255 - mul255(src[3], alpha);
+    for (int c = 0; c < 4; c++) {
+      dst[c] = addSaturate(mul255(src[c], alpha), mul255(dst[c], inverse));
+    }
+  }
+}
+
+static void coverageRowScalar(Uint8 *dst, const Uint8 *coverage, int count,
+                              Uint32 color, Uint8 alpha) {
+  Uint8 rgba[4];
+  memcpy(rgba, &color, sizeof(rgba));
+  for (int i = 0; i < count; i++, dst += 4) {
+    Uint8 k = mul255(coverage[i], alpha);
+    unsigned int inverse = 255 - mul255(rgba[3], k);
+    for (int c = 0; c < 4; c++) {
+      dst[c] = addSaturate(mul255(rgba[c], k), mul255(dst[c], inverse));
+    }
+  }
+}
+
+static void fillRowScalar(Uint8 *dst, int count, Uint32 color) {
+  Uint8 rgba[4];
+  memcpy(rgba, &color, sizeof(rgba));
+  unsigned int inverse = 255 - rgba[3];
+  for (int i = 0; i < count; i++, dst += 4) {
+    for (int c = 0; c < 4; c++) {
+      dst[c] = addSaturate(rgba[c], mul255(dst[c], inverse));
+    }
+  }
+}
+
+const PixelBlendKernels pixelBlendScalar = {
+    "scalar",
+    blendRowScalar,
+    coverageRowScalar,
+    fillRowScalar,
+};
+
+int pixelBlendAvailable(const PixelBlendKernels **sets, int max) {
+  int count = 0;
+  if (count < max) {
+    sets[count++] = &pixelBlendScalar;
+  }
+#ifdef PIXEL_BLEND_X86
+  if (count < max) {
+    sets[count++] = &pixelBlendSse2;
+  }
+  __builtin_cpu_init();
+  if (count < max && __builtin_cpu_supports("avx2")) {
+    sets[count++] = &pixelBlendAvx2;
+  }
+#endif
+#ifdef PIXEL_BLEND_NEON
+  if (count < max) {
+    sets[count++] = &pixelBlendNeon;
+  }
+#endif
+  return count;
+}
+
+const PixelBlendKernels *pixelBlendKernels(void) {
+  static const PixelBlendKernels *selected = NULL;
+  if (selected) {
+    return selected;
+  }
+
+  const PixelBlendKernels *sets[4];
+  int count = pixelBlendAvailable(sets, 4);
+  const char *name = getenv("KEYCAPPER_BLEND");
+  selected = sets[count - 1];
+  if (name) {
+    int i = 0;
+    while (i < count && strcmp(sets[i]->name, name) != 0) {
+      i++;
+    }
+    if (i < count) {
+      selected = sets[i];
+    } else {
+      printf("Blend kernels %s are not available here; using %s\n", name,
+             selected->name);
+    }
+  }
+  return selected;
+}
+
+Uint32 pixelBlendColor(Uint8 r, Uint8 g, Uint8 b, Uint8 a) {
+  Uint8 rgba[4] = {mul255(r, a), mul255(g, a), mul255(b, a), a};
+  Uint32 color;
+  memcpy(&color, rgba, sizeof(color));
+  return color;
+}
+
+void pixelBlendCopy(Uint8 *dst, int dstPitch, const Uint8 *src,
+                    int srcPitch, int width, int height, Uint8 alpha) {
+  const PixelBlendKernels *kernels = pixelBlendKernels();
+  for (int y = 0; y < height; y++) {
+    kernels->blendRow(dst + y * dstPitch, src + y * srcPitch, width, alpha);
+  }
+}
+
+void pixelBlendCoverage(Uint8 *dst, int dstPitch, const Uint8 *coverage,
+                        int coveragePitch, int width, int height,
+                        Uint32 color, Uint8 alpha) {
+  const PixelBlendKernels *kernels = pixelBlendKernels();
+  for (int y = 0; y < height; y++) {
+    kernels->coverageRow(dst + y * dstPitch, coverage + y * coveragePitch,
+                         width, color, alpha);
+  }
+}
+
+void pixelBlendFill(Uint8 *dst, int dstPitch, int width, int height,
+                    Uint32 color) {
+  const PixelBlendKernels *kernels = pixelBlendKernels();
+  for (int y = 0; y < height; y++) {
+    kernels->fillRow(dst + y * dstPitch, width, color);
+  }
+}
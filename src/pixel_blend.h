@@ -0,0 +1,67 @@
+#ifndef PIXEL_BLEND_H
+#define PIXEL_BLEND_H
+
+#ifdef _WIN32
+#include <SDL.h>
+#else
+#include <SDL2/SDL.h>
+#endif
+
+// Alpha compositing kernels for drawing the key line into a software
+// framebuffer without going through SDL's generic blitters. Pixels are
+// premultiplied RGBA32: bytes R, G, B, A in memory whatever the host byte
+// order, with the colour already multiplied by alpha. Blending is "over"
+// with every product rounded exactly, x * y / 255 to the nearest integer,
+// so every kernel set gives bit-identical results to the scalar one.
+//
+// Rows may start at any address and have any length.
+typedef struct {
+  const char *name;
+
+  // dst = src * alpha + dst * (1 - srcA * alpha): a premultiplied row
+  // (the composite, or a label) faded by alpha
+  void (*blendRow)(Uint8 *dst, const Uint8 *src, int count, Uint8 alpha);
+
+  // The same for a premultiplied colour masked by 8-bit coverage, e.g. a
+  // label from the atlas: src = color * coverage
+  void (*coverageRow)(Uint8 *dst, const Uint8 *coverage, int count,
+                      Uint32 color, Uint8 alpha);
+
+  // dst = color + dst * (1 - colorA), e.g. the line's background
+  void (*fillRow)(Uint8 *dst, int count, Uint32 color);
+} PixelBlendKernels;
+
+// Kernel sets, defined when the compiler can build them for this target
+#if defined(__GNUC__) && defined(__SSE2__) &&                                 \
+    (defined(__x86_64__) || defined(__i386__))
+#define PIXEL_BLEND_X86
+extern const PixelBlendKernels pixelBlendSse2;
+extern const PixelBlendKernels pixelBlendAvx2; // Only if the CPU has AVX2
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define PIXEL_BLEND_NEON
+extern const PixelBlendKernels pixelBlendNeon;
+#endif
+extern const PixelBlendKernels pixelBlendScalar; // The reference
+
+// The fastest kernels this CPU runs, picked once. KEYCAPPER_BLEND=name in
+// the environment picks a set by name instead, e.g. "scalar".
+const PixelBlendKernels *pixelBlendKernels(void);
+
+// Every kernel set this CPU runs, the scalar reference first. Returns how
+// many were written to sets.
+int pixelBlendAvailable(const PixelBlendKernels **sets, int max);
+
+// Pack a colour with straight alpha into a premultiplied pixel
+Uint32 pixelBlendColor(Uint8 r, Uint8 g, Uint8 b, Uint8 a);
+
+// Rectangles of width x height pixels, with pitches in bytes
+void pixelBlendCopy(Uint8 *dst, int dstPitch, const Uint8 *src,
+                    int srcPitch, int width, int height, Uint8 alpha);
+void pixelBlendCoverage(Uint8 *dst, int dstPitch, const Uint8 *coverage,
+                        int coveragePitch, int width, int height,
+                        Uint32 color, Uint8 alpha);
+void pixelBlendFill(Uint8 *dst, int dstPitch, int width, int height,
+                    Uint32 color);
+
+#endif
@@ -0,0 +1,87 @@
+// NEON blend kernels for ARM (Apple silicon, Raspberry Pi and the like).
+// Eight pixels at a time, split into R, G, B and A planes on load and
+// interleaved again on store, so each step works on one channel; the tail
+// of a row goes to the scalar kernels.
+
+#include "pixel_blend.h"
+
+#ifdef PIXEL_BLEND_NEON
+
+#include <arm_neon.h>
+#include <string.h>
+
+// x * y / 255 rounded, lane by lane, exactly as the scalar mul255
+static inline uint8x8_t mul255Neon(uint8x8_t x, uint8x8_t y) {
+  uint16x8_t t = vaddq_u16(vmull_u8(x, y), vdupq_n_u16(128));
+  return vshrn_n_u16(vaddq_u16(t, vshrq_n_u16(t, 8)), 8);
+}
+
+// Premultiplied src over dst in place, channel by channel
+static inline void overNeon(uint8x8x4_t *dst, const uint8x8_t src[4]) {
+  uint8x8_t inverse = vmvn_u8(src[3]);
+  for (int c = 0; c < 4; c++) {
+    dst->val[c] = vqadd_u8(src[c], mul255Neon(dst->val[c], inverse));
+  }
+}
+
+static void blendRowNeon(Uint8 *dst, const Uint8 *src, int count,
+                         Uint8 alpha) {
+  uint8x8_t fade = vdup_n_u8(alpha);
+  int i = 0;
+  for (; i + 8 <= count; i += 8) {
+    uint8x8x4_t s = vld4_u8(src + i * 4);
+    uint8x8x4_t d = vld4_u8(dst + i * 4);
+    uint8x8_t faded[4];
+    for (int c = 0; c < 4; c++) {
+      faded[c] = mul255Neon(s.val[c], fade);
+    }
+    overNeon(&d, faded);
+    vst4_u8(dst + i * 4, d);
+  }
+  pixelBlendScalar.blendRow(dst + i * 4, src + i * 4, count - i, alpha);
+}
+
+static void coverageRowNeon(Uint8 *dst, const Uint8 *coverage, int count,
+                            Uint32 color, Uint8 alpha) {
+  Uint8 rgba[4];
+  memcpy(rgba, &color, sizeof(rgba));
+  uint8x8_t fade = vdup_n_u8(alpha);
+  int i = 0;
+  for (; i + 8 <= count; i += 8) {
+    uint8x8_t k = mul255Neon(vld1_u8(coverage + i), fade);
+    uint8x8x4_t d = vld4_u8(dst + i * 4);
+    uint8x8_t s[4];
+    for (int c = 0; c < 4; c++) {
+      s[c] = mul255Neon(vdup_n_u8(rgba[c]), k);
+    }
+    overNeon(&d, s);
+    vst4_u8(dst + i * 4, d);
+  }
+  pixelBlendScalar.coverageRow(dst + i * 4, coverage + i, count - i, color,
+                               alpha);
+}
+
+static void fillRowNeon(Uint8 *dst, int count, Uint32 color) {
+  Uint8 rgba[4];
+  memcpy(rgba, &color, sizeof(rgba));
+  uint8x8_t s[4];
+  for (int c = 0; c < 4; c++) {
+    s[c] = vdup_n_u8(rgba[c]);
+  }
+  int i = 0;
+  for (; i + 8 <= count; i += 8) {
+    uint8x8x4_t d = vld4_u8(dst + i * 4);
+    overNeon(&d, s);
+    vst4_u8(dst + i * 4, d);
+  }
+  pixelBlendScalar.fillRow(dst + i * 4, count - i, color);
+}
+
+const PixelBlendKernels pixelBlendNeon = {
+    "neon",
+    blendRowNeon,
+    coverageRowNeon,
+    fillRowNeon,
+};
+
+#endif
@@ -0,0 +1,187 @@
+// SSE2 and AVX2 blend kernels. SSE2 is part of every x86-64 CPU; the AVX2
+// functions are compiled for AVX2 on their own, without raising the
+// baseline of the rest of the program, and only run when the CPU has it.
+// Both work on pixels widened to 16-bit lanes, two (SSE2) or four (AVX2)
+// per 128-bit half, and leave the tail of a row to the scalar kernels.
+
+#include "pixel_blend.h"
+
+#ifdef PIXEL_BLEND_X86
+
+#include <immintrin.h>
+#include <string.h>
+
+#define AVX2 __attribute__((target("avx2")))
+
+// x * y / 255 rounded, lane by lane, exactly as the scalar mul255
+static inline __m128i mul255Sse2(__m128i x, __m128i y) {
+  __m128i t = _mm_add_epi16(_mm_mullo_epi16(x, y), _mm_set1_epi16(128));
+  return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+// Every lane of a pixel set to its alpha lane
+static inline __m128i alphaLanesSse2(__m128i x) {
+  x = _mm_shufflelo_epi16(x, _MM_SHUFFLE(3, 3, 3, 3));
+  return _mm_shufflehi_epi16(x, _MM_SHUFFLE(3, 3, 3, 3));
+}
+
+// Premultiplied src over dst, both widened; the pack that follows
+// saturates like the scalar addSaturate
+static inline __m128i overSse2(__m128i src, __m128i dst) {
+  __m128i inverse = _mm_sub_epi16(_mm_set1_epi16(255), alphaLanesSse2(src));
+  return _mm_add_epi16(src, mul255Sse2(dst, inverse));
+}
+
+// Four coverage values, each repeated over the four bytes of its pixel
+static inline __m128i spreadCoverageSse2(const Uint8 *coverage) {
+  int packed;
+  memcpy(&packed, coverage, sizeof(packed));
+  __m128i v = _mm_cvtsi32_si128(packed);
+  v = _mm_unpacklo_epi8(v, v);
+  return _mm_unpacklo_epi16(v, v);
+}
+
+static void blendRowSse2(Uint8 *dst, const Uint8 *src, int count,
+                         Uint8 alpha) {
+  __m128i zero = _mm_setzero_si128();
+  __m128i fade = _mm_set1_epi16(alpha);
+  int i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m128i s = _mm_loadu_si128((const __m128i *)(src + i * 4));
+    __m128i d = _mm_loadu_si128((const __m128i *)(dst + i * 4));
+    __m128i low = overSse2(mul255Sse2(_mm_unpacklo_epi8(s, zero), fade),
+                           _mm_unpacklo_epi8(d, zero));
+    __m128i high = overSse2(mul255Sse2(_mm_unpackhi_epi8(s, zero), fade),
+                            _mm_unpackhi_epi8(d, zero));
+    _mm_storeu_si128((__m128i *)(dst + i * 4), _mm_packus_epi16(low, high));
+  }
+  pixelBlendScalar.blendRow(dst + i * 4, src + i * 4, count - i, alpha);
+}
+
+static void coverageRowSse2(Uint8 *dst, const Uint8 *coverage, int count,
+                            Uint32 color, Uint8 alpha) {
+  __m128i zero = _mm_setzero_si128();
+  __m128i fade = _mm_set1_epi16(alpha);
+  __m128i rgba = _mm_unpacklo_epi8(_mm_set1_epi32((int)color), zero);
+  int i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m128i k = spreadCoverageSse2(coverage + i);
+    __m128i d = _mm_loadu_si128((const __m128i *)(dst + i * 4));
+    __m128i kLow = mul255Sse2(_mm_unpacklo_epi8(k, zero), fade);
+    __m128i kHigh = mul255Sse2(_mm_unpackhi_epi8(k, zero), fade);
+    __m128i low = overSse2(mul255Sse2(rgba, kLow),
+                           _mm_unpacklo_epi8(d, zero));
+    __m128i high = overSse2(mul255Sse2(rgba, kHigh),
+                            _mm_unpackhi_epi8(d, zero));
+    _mm_storeu_si128((__m128i *)(dst + i * 4), _mm_packus_epi16(low, high));
+  }
+  pixelBlendScalar.coverageRow(dst + i * 4, coverage + i, count - i, color,
+                               alpha);
+}
+
+static void fillRowSse2(Uint8 *dst, int count, Uint32 color) {
+  __m128i zero = _mm_setzero_si128();
+  __m128i rgba = _mm_unpacklo_epi8(_mm_set1_epi32((int)color), zero);
+  int i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m128i d = _mm_loadu_si128((const __m128i *)(dst + i * 4));
+    __m128i low = overSse2(rgba, _mm_unpacklo_epi8(d, zero));
+    __m128i high = overSse2(rgba, _mm_unpackhi_epi8(d, zero));
+    _mm_storeu_si128((__m128i *)(dst + i * 4), _mm_packus_epi16(low, high));
+  }
+  pixelBlendScalar.fillRow(dst + i * 4, count - i, color);
+}
+
+const PixelBlendKernels pixelBlendSse2 = {
+    "sse2",
+    blendRowSse2,
+    coverageRowSse2,
+    fillRowSse2,
+};
+
+// The AVX2 versions: the same steps on eight pixels at a time. Unpacking
+// and packing work within each 128-bit half, so pixels come back in order.
+
+AVX2 static inline __m256i mul255Avx2(__m256i x, __m256i y) {
+  __m256i t =
+      _mm256_add_epi16(_mm256_mullo_epi16(x, y), _mm256_set1_epi16(128));
+  return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+}
+
+AVX2 static inline __m256i overAvx2(__m256i src, __m256i dst) {
+  __m256i alpha = _mm256_shufflelo_epi16(src, _MM_SHUFFLE(3, 3, 3, 3));
+  alpha = _mm256_shufflehi_epi16(alpha, _MM_SHUFFLE(3, 3, 3, 3));
+  __m256i inverse = _mm256_sub_epi16(_mm256_set1_epi16(255), alpha);
+  return _mm256_add_epi16(src, mul255Avx2(dst, inverse));
+}
+
+AVX2 static inline __m256i spreadCoverageAvx2(const Uint8 *coverage) {
+  __m128i v = _mm_loadl_epi64((const __m128i *)coverage);
+  v = _mm_unpacklo_epi8(v, v);
+  __m256i spread = _mm256_castsi128_si256(_mm_unpacklo_epi16(v, v));
+  return _mm256_inserti128_si256(spread, _mm_unpackhi_epi16(v, v), 1);
+}
+
+AVX2 static void blendRowAvx2(Uint8 *dst, const Uint8 *src, int count,
+                              Uint8 alpha) {
+  __m256i zero = _mm256_setzero_si256();
+  __m256i fade = _mm256_set1_epi16(alpha);
+  int i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256i s = _mm256_loadu_si256((const __m256i *)(src + i * 4));
+    __m256i d = _mm256_loadu_si256((const __m256i *)(dst + i * 4));
+    __m256i low =
+        overAvx2(mul255Avx2(_mm256_unpacklo_epi8(s, zero), fade),
+                 _mm256_unpacklo_epi8(d, zero));
+    __m256i high =
+        overAvx2(mul255Avx2(_mm256_unpackhi_epi8(s, zero), fade),
+                 _mm256_unpackhi_epi8(d, zero));
+    _mm256_storeu_si256((__m256i *)(dst + i * 4),
+                        _mm256_packus_epi16(low, high));
+  }
+  blendRowSse2(dst + i * 4, src + i * 4, count - i, alpha);
+}
+
+AVX2 static void coverageRowAvx2(Uint8 *dst, const Uint8 *coverage,
+                                 int count, Uint32 color, Uint8 alpha) {
+  __m256i zero = _mm256_setzero_si256();
+  __m256i fade = _mm256_set1_epi16(alpha);
+  __m256i rgba = _mm256_unpacklo_epi8(_mm256_set1_epi32((int)color), zero);
+  int i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256i k = spreadCoverageAvx2(coverage + i);
+    __m256i d = _mm256_loadu_si256((const __m256i *)(dst + i * 4));
+    __m256i kLow = mul255Avx2(_mm256_unpacklo_epi8(k, zero), fade);
+    __m256i kHigh = mul255Avx2(_mm256_unpackhi_epi8(k, zero), fade);
+    __m256i low = overAvx2(mul255Avx2(rgba, kLow),
+                           _mm256_unpacklo_epi8(d, zero));
+    __m256i high = overAvx2(mul255Avx2(rgba, kHigh),
+                            _mm256_unpackhi_epi8(d, zero));
+    _mm256_storeu_si256((__m256i *)(dst + i * 4),
+                        _mm256_packus_epi16(low, high));
+  }
+  coverageRowSse2(dst + i * 4, coverage + i, count - i, color, alpha);
+}
+
+AVX2 static void fillRowAvx2(Uint8 *dst, int count, Uint32 color) {
+  __m256i zero = _mm256_setzero_si256();
+  __m256i rgba = _mm256_unpacklo_epi8(_mm256_set1_epi32((int)color), zero);
+  int i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256i d = _mm256_loadu_si256((const __m256i *)(dst + i * 4));
+    __m256i low = overAvx2(rgba, _mm256_unpacklo_epi8(d, zero));
+    __m256i high = overAvx2(rgba, _mm256_unpackhi_epi8(d, zero));
+    _mm256_storeu_si256((__m256i *)(dst + i * 4),
+                        _mm256_packus_epi16(low, high));
+  }
+  fillRowSse2(dst + i * 4, count - i, color);
+}
+
+const PixelBlendKernels pixelBlendAvx2 = {
+    "avx2",
+    blendRowAvx2,
+    coverageRowAvx2,
+    fillRowAvx2,
+};
+
+#endif
@@ -0,0 +1,187 @@
+#include "profiler.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "frame_pacer.h"
+
+#define HUD_X 10
+#define HUD_Y 10
+#define HUD_PADDING 8
+#define HUD_LINES 4
+#define GRAPH_BAR_WIDTH 3
+#define GRAPH_HEIGHT 66 // Pixels for two frame budgets
+
+static float ticksToMs(Uint64 ticks) {
+  return (float)(ticks * 1000.0 / SDL_GetPerformanceFrequency());
+}
+
+void profilerBeginFrame(Profiler *profiler) {
+  profiler->frameStart = SDL_GetPerformanceCounter();
+  profiler->stageStart = profiler->frameStart;
+  for (int i = 0; i < PROFILE_STAGE_COUNT; i++) {
+    profiler->stageTicks[i] = 0;
+  }
+  profiler->pendingDrawCalls = 0;
+  profiler->pendingTextures = 0;
+}
+
+void profilerMark(Profiler *profiler, ProfileStage stage) {
+  Uint64 now = SDL_GetPerformanceCounter();
+  profiler->stageTicks[stage] += now - profiler->stageStart;
+  profiler->stageStart = now;
+}
+
+void profilerBeginScene(Profiler *profiler, const LabelCache *cache,
+                        Uint64 primitiveDraws) {
+  profiler->sceneDraws = cache->draws + primitiveDraws;
+  profiler->sceneRasterTicks = cache->rasterTicks;
+  profiler->sceneTextures = cache->texturesCreated;
+  profiler->stageStart = SDL_GetPerformanceCounter();
+}
+
+void profilerEndScene(Profiler *profiler, const LabelCache *cache,
+                      Uint64 primitiveDraws) {
+  Uint64 now = SDL_GetPerformanceCounter();
+  Uint64 elapsed = now - profiler->stageStart;
+  Uint64 raster = cache->rasterTicks - profiler->sceneRasterTicks;
+  if (raster > elapsed) {
+    raster = elapsed;
+  }
+  profiler->stageTicks[PROFILE_RASTER] += raster;
+  profiler->stageTicks[PROFILE_SCENE] += elapsed - raster;
+  profiler->stageStart = now;
+
+  profiler->pendingDrawCalls +=
+      (int)(cache->draws + primitiveDraws - profiler->sceneDraws);
+  profiler->pendingTextures +=
+      (int)(cache->texturesCreated - profiler->sceneTextures);
+  profiler->texturesTotal = cache->texturesCreated;
+}
+
+void profilerEndFrame(Profiler *profiler) {
+  for (int i = 0; i < PROFILE_STAGE_COUNT; i++) {
+    profiler->stageMs[i] = ticksToMs(profiler->stageTicks[i]);
+  }
+  profiler->drawCalls = profiler->pendingDrawCalls;
+  profiler->texturesCreated = profiler->pendingTextures;
+
+  profiler->frameMs[profiler->historyNext] =
+      ticksToMs(SDL_GetPerformanceCounter() - profiler->frameStart);
+  profiler->historyNext = (profiler->historyNext + 1) % PROFILER_HISTORY;
+  if (profiler->historyCount < PROFILER_HISTORY) {
+    profiler->historyCount++;
+  }
+}
+
+static int compareFloat(const void *a, const void *b) {
+  float x = *(const float *)a;
+  float y = *(const float *)b;
+  return x < y ? -1 : x > y;
+}
+
+// Blit text one glyph at a time with a fixed advance (the HUD font is
+// monospaced), so only the ~40 distinct characters are ever cached
+static void drawText(LabelCache *cache, TTF_Font *font, const char *text,
+                     int x, int y, int advance) {
+  char glyph[2] = {0, 0};
+  for (const char *c = text; *c; c++) {
+    if (*c != ' ') {
+      glyph[0] = *c;
+      labelCacheDraw(cache, font, glyph, x, y, 255);
+    }
+    x += advance;
+  }
+}
+
+void profilerDraw(Profiler *profiler, SDL_Renderer *renderer,
+                  LabelCache *cache, TTF_Font *font, double rate) {
+  const LabelEntry *digit = labelCacheGet(cache, font, "0");
+  if (!digit) {
+    return;
+  }
+  int advance = digit->rect.w;
+  int lineHeight = digit->rect.h;
+
+  // Summaries over the graph window
+  float sorted[PROFILER_HISTORY];
+  int count = profiler->historyCount;
+  memcpy(sorted, profiler->frameMs, sizeof(sorted));
+  qsort(sorted, count, sizeof(sorted[0]), compareFloat);
+  int last = (profiler->historyNext + PROFILER_HISTORY - 1) % PROFILER_HISTORY;
+  float latest = count > 0 ? profiler->frameMs[last] : 0.0f;
+  float p99 = count > 0 ? sorted[(int)(0.99f * (count - 1) + 0.5f)] : 0.0f;
+  float worst = count > 0 ? sorted[count - 1] : 0.0f;
+
+  char lines[HUD_LINES][64];
+  const float *ms = profiler->stageMs;
+  snprintf(lines[0], sizeof(lines[0]), "frame %6.2f  p99 %6.2f  max %6.2f",
+           latest, p99, worst);
+  snprintf(lines[1], sizeof(lines[1]),
+           "events %5.2f  scene %5.2f  raster %5.2f", ms[PROFILE_EVENTS],
+           ms[PROFILE_SCENE], ms[PROFILE_RASTER]);
+  snprintf(lines[2], sizeof(lines[2]), "hud %5.2f  present %6.2f ms",
+           ms[PROFILE_HUD], ms[PROFILE_PRESENT]);
+  snprintf(lines[3], sizeof(lines[3]), "draws %d  textures %llu (+%d)",
+           profiler->drawCalls, (unsigned long long)profiler->texturesTotal,
+           profiler->texturesCreated);
+
+  // Panel behind text and graph
+  int graphWidth = PROFILER_HISTORY * GRAPH_BAR_WIDTH;
+  int textWidth = 0;
+  for (int i = 0; i < HUD_LINES; i++) {
+    int width = (int)strlen(lines[i]) * advance;
+    textWidth = width > textWidth ? width : textWidth;
+  }
+  SDL_Rect panel = {HUD_X, HUD_Y,
+                    (graphWidth > textWidth ? graphWidth : textWidth) +
+                        2 * HUD_PADDING,
+                    HUD_LINES * lineHeight + GRAPH_HEIGHT + 3 * HUD_PADDING};
+  SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+  SDL_SetRenderDrawColor(renderer, 0, 0, 0, 200);
+  SDL_RenderFillRect(renderer, &panel);
+
+  int y = HUD_Y + HUD_PADDING;
+  for (int i = 0; i < HUD_LINES; i++) {
+    drawText(cache, font, lines[i], HUD_X + HUD_PADDING, y, advance);
+    y += lineHeight;
+  }
+
+  // Frame time bars, oldest on the left, batched by colour: within budget,
+  // over budget, and more than two frames
+  double budgetRate = rate > 0 ? rate : FRAME_PACER_DEFAULT_RATE;
+  float budgetMs = (float)(1000.0 / budgetRate);
+  float graphMaxMs = 2 * budgetMs;
+  SDL_Rect bars[3][PROFILER_HISTORY];
+  int barCounts[3] = {0, 0, 0};
+  int graphBottom = y + HUD_PADDING + GRAPH_HEIGHT;
+  int first = (profiler->historyNext + PROFILER_HISTORY - count) %
+              PROFILER_HISTORY;
+  for (int i = 0; i < count; i++) {
+    float frame = profiler->frameMs[(first + i) % PROFILER_HISTORY];
+    int band = frame <= budgetMs ? 0 : frame <= graphMaxMs ? 1 : 2;
+    float clamped = frame < graphMaxMs ? frame : graphMaxMs;
+    int height = (int)(clamped * GRAPH_HEIGHT / graphMaxMs) + 1;
+    SDL_Rect *bar = &bars[band][barCounts[band]++];
+    bar->x = HUD_X + HUD_PADDING + i * GRAPH_BAR_WIDTH;
+    bar->y = graphBottom - height;
+    bar->w = GRAPH_BAR_WIDTH - 1;
+    bar->h = height;
+  }
+  static const SDL_Color bandColors[3] = {
+      {80, 200, 80, 255}, {230, 200, 60, 255}, {230, 70, 60, 255}};
+  for (int band = 0; band < 3; band++) {
+    if (barCounts[band] > 0) {
+      SDL_SetRenderDrawColor(renderer, bandColors[band].r, bandColors[band].g,
+                             bandColors[band].b, bandColors[band].a);
+      SDL_RenderFillRects(renderer, bars[band], barCounts[band]);
+    }
+  }
+
+  // Frame budget line
+  int budgetY = graphBottom - (int)(budgetMs * GRAPH_HEIGHT / graphMaxMs);
+  SDL_SetRenderDrawColor(renderer, 255, 255, 255, 120);
+  SDL_RenderDrawLine(renderer, HUD_X + HUD_PADDING, budgetY,
+                     HUD_X + HUD_PADDING + graphWidth, budgetY);
+}
@@ -0,0 +1,79 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdbool.h>
+
+#ifdef _WIN32
+#include <SDL.h>
+#include <SDL_ttf.h>
+#else
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#endif
+
+#include "label_cache.h"
+
+#define PROFILER_HISTORY 120 // Frames shown in the rolling graph
+
+// Consecutive parts of a frame, timed with SDL_GetPerformanceCounter()
+typedef enum {
+  PROFILE_EVENTS,  // Polling SDL, plus laying out keys when headless
+  PROFILE_SCENE,   // Key line scans and draw calls
+  PROFILE_RASTER,  // FreeType rasterization of label cache misses
+  PROFILE_HUD,     // Drawing the profiler HUD itself
+  PROFILE_PRESENT, // SDL_RenderPresent, including any vsync wait
+  PROFILE_STAGE_COUNT
+} ProfileStage;
+
+// Zero-initialized is ready to use; visible controls whether it is drawn
+typedef struct {
+  bool visible;
+
+  Uint64 frameStart;
+  Uint64 stageStart;
+  Uint64 stageTicks[PROFILE_STAGE_COUNT]; // Frame in progress
+
+  // Last finished frame
+  float stageMs[PROFILE_STAGE_COUNT];
+  int drawCalls;
+  int texturesCreated;
+  Uint64 texturesTotal;
+
+  // Rolling frame times, oldest first starting at historyNext
+  float frameMs[PROFILER_HISTORY];
+  int historyNext;
+  int historyCount;
+
+  // Counter values when the scene started drawing
+  Uint64 sceneDraws;
+  Uint64 sceneRasterTicks;
+  Uint64 sceneTextures;
+  int pendingDrawCalls;
+  int pendingTextures;
+} Profiler;
+
+// Start timing a frame; everything until the first mark is PROFILE_EVENTS
+void profilerBeginFrame(Profiler *profiler);
+
+// Charge the time since the previous mark to stage
+void profilerMark(Profiler *profiler, ProfileStage stage);
+
+// Bracket renderScene so its time is split between PROFILE_SCENE and
+// PROFILE_RASTER, and its draw calls and new textures are counted.
+// primitiveDraws is sceneDrawCalls; label blits come from the cache.
+void profilerBeginScene(Profiler *profiler, const LabelCache *cache,
+                        Uint64 primitiveDraws);
+void profilerEndScene(Profiler *profiler, const LabelCache *cache,
+                      Uint64 primitiveDraws);
+
+// Close the frame and push its total time into the graph
+void profilerEndFrame(Profiler *profiler);
+
+// Draw the HUD in the top-left corner, away from the key line. Text is
+// blitted one cached glyph at a time so changing numbers never rasterize.
+// The graph's budget is one frame at rate (the frame pacer's), or at 60 Hz
+// if rate is 0.
+void profilerDraw(Profiler *profiler, SDL_Renderer *renderer,
+                  LabelCache *cache, TTF_Font *font, double rate);
+
+#endif
@@ -0,0 +1,785 @@
+#include "scene.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "pixel_blend.h"
+#include "scene_clock.h"
+
+#define KEY_LINE_MASK (KEY_LINE_CAPACITY - 1)
+#define SCROLL_SNAP 0.05f // Offsets below this many pixels end the scroll
+
+static KeyLine mainLine;      // The window's keys on screen, oldest first
+KeyLine *keyLine = &mainLine; // The line the model functions change
+SceneLayout sceneLayout;     // The canvas being drawn to
+Button toggleButton;         // Toggle button for alignment
+LabelCache labelCache;       // Rasterized labels shared by every view
+Uint64 sceneDrawCalls = 0;   // Primitive draw calls, for the profiler HUD
+LineComposite lineComposite; // The key line drawn once for fade frames
+
+static KeyDisplay *keyAt(unsigned int index) {
+  return &keyLine->keys[index & KEY_LINE_MASK];
+}
+
+// A size in pixels at the default canvas, at an output scale
+static int scaleSize(int size, float scale) {
+  int scaled = (int)(size * scale + 0.5f);
+  return scaled > 0 ? scaled : 1;
+}
+
+bool sceneLayoutInit(SceneLayout *layout, int width, int height,
+                     float scale) {
+  if (scale <= 0.0f) {
+    scale = (float)height / WINDOW_HEIGHT;
+  }
+  int steps = sceneScaleSteps(scale);
+  scale = (float)steps / SCENE_SCALE_STEPS;
+
+  const SceneFonts *fonts = sceneFontsGet(
+      steps, scaleSize(FONT_SIZE, scale), scaleSize(BUTTON_FONT_SIZE, scale));
+  if (!fonts) {
+    return false;
+  }
+
+  layout->width = width;
+  layout->height = height;
+  layout->scale = scale;
+  layout->fonts = fonts;
+  layout->keyGap = scaleSize(KEY_GAP, scale);
+  layout->leftMargin = scaleSize(LEFT_MARGIN, scale);
+  layout->rightMargin = scaleSize(RIGHT_MARGIN, scale);
+  layout->maxWidth = width - layout->leftMargin - layout->rightMargin;
+  if (layout->maxWidth < 1) {
+    layout->maxWidth = 1;
+  }
+  layout->linePadding = scaleSize(LINE_PADDING, scale);
+  layout->atlasSize = LABEL_ATLAS_SIZE * ((steps + SCENE_SCALE_STEPS - 1) /
+                                          SCENE_SCALE_STEPS);
+  return true;
+}
+
+bool setSceneCanvas(int width, int height, float scale) {
+  if (!sceneLayoutInit(&sceneLayout, width, height, scale)) {
+    return false;
+  }
+  initToggleButton();
+  return true;
+}
+
+void initScene(void) {
+  clearKeyDisplays();
+  keyLine->layout = sceneLayout;
+  initToggleButton();
+}
+
+void clearKeyDisplays(void) {
+  keyLine->tail = 0;
+  keyLine->first = 0;
+  keyLine->head = 0;
+  keyLine->departingWidth = 0;
+  keyLine->tallestHead = 0;
+  keyLine->tallestTail = 0;
+  keyLine->scrollOffset = 0.0f;
+  keyLine->version++;
+  keyLine->activeKeyCount = 0;
+  keyLine->currentLineWidth = 0;
+}
+
+// Height of the tallest key in the line, from the front of the monotonic
+// queue
+static int keyLineMaxHeight(void) {
+  if (keyLine->tallestHead == keyLine->tallestTail) {
+    return 0;
+  }
+  return keyAt(keyLine->tallest[keyLine->tallestHead & KEY_LINE_MASK])->height;
+}
+
+// Move the oldest key out of the line. It keeps being drawn, clipped, while
+// the scroll carries it off screen.
+static void retireOldestKey(void) {
+  KeyDisplay *oldest = keyAt(keyLine->first);
+  if (keyLine->tallestHead != keyLine->tallestTail &&
+      keyLine->tallest[keyLine->tallestHead & KEY_LINE_MASK] ==
+          keyLine->first) {
+    keyLine->tallestHead++;
+  }
+  keyLine->first++;
+  keyLine->version++;
+  keyLine->activeKeyCount--;
+
+  int advance = oldest->width + keyLine->layout.keyGap;
+  keyLine->departingWidth += advance;
+  keyLine->currentLineWidth -=
+      keyLine->activeKeyCount > 0 ? advance : oldest->width;
+
+  // Left-aligned lines shift every remaining key left by the gap it leaves;
+  // start them where they were and let the scroll catch up
+  if (!keyLine->rightAligned) {
+    keyLine->scrollOffset += advance;
+  }
+}
+
+// Forget keys that have finished scrolling off
+static void dropDepartedKeys(void) {
+  if (keyLine->tail != keyLine->first) {
+    keyLine->tail = keyLine->first;
+    keyLine->departingWidth = 0;
+    keyLine->version++;
+  }
+}
+
+// Scroll offset left after easing toward zero for elapsed microseconds.
+// Exponential, so it can be evaluated for any time without stepping.
+static float easeScroll(float offset, Uint64 elapsed) {
+  offset *= (float)SDL_exp(-(double)elapsed / (SCROLL_SMOOTHING_MS * 1000.0));
+  return offset < SCROLL_SNAP ? 0.0f : offset;
+}
+
+// Bring the line up to now before changing it or taking a snapshot: ease
+// the scroll, forgetting departing keys once it settles, and forget the
+// whole line once it has faded out
+static void advanceKeyLine(Uint64 now) {
+  keyLine->scrollOffset =
+      easeScroll(keyLine->scrollOffset, now - keyLine->lastScrollTime);
+  keyLine->lastScrollTime = now;
+  if (keyLine->scrollOffset == 0.0f) {
+    dropDepartedKeys();
+  }
+  if (keyLine->activeKeyCount > 0 &&
+      now - keyLine->lastKeyPressTime > FADE_DURATION * 1000ull) {
+    clearKeyDisplays();
+  }
+}
+
+// Add the key at index to the max-height queue. Keys no taller than it can
+// never be the maximum again.
+static void trackKeyHeight(unsigned int index) {
+  int height = keyAt(index)->height;
+  while (keyLine->tallestTail != keyLine->tallestHead &&
+         keyAt(keyLine->tallest[(keyLine->tallestTail - 1) & KEY_LINE_MASK])
+                 ->height <= height) {
+    keyLine->tallestTail--;
+  }
+  keyLine->tallest[keyLine->tallestTail++ & KEY_LINE_MASK] = index;
+}
+
+void addKeyDisplay(const KeyCap *cap, int width, int height) {
+  advanceKeyLine(sceneClockNowUs());
+
+  // Make room in the ring, dropping departing keys before live ones
+  if (keyLine->head - keyLine->tail >= KEY_LINE_CAPACITY) {
+    if (keyLine->tail == keyLine->first) {
+      retireOldestKey();
+    }
+    keyLine->departingWidth -=
+        keyAt(keyLine->tail)->width + keyLine->layout.keyGap;
+    keyLine->tail++;
+  }
+
+  // Right-aligned lines grow to the left: existing keys slide over to make
+  // room while the new key slides in from the right
+  if (keyLine->rightAligned && keyLine->activeKeyCount > 0) {
+    keyLine->scrollOffset += width + keyLine->layout.keyGap;
+  }
+
+  // Set up the new key display
+  KeyDisplay *key = keyAt(keyLine->head);
+  key->cap = *cap;
+  key->width = width;
+  key->height = height;
+  trackKeyHeight(keyLine->head);
+
+  keyLine->head++;
+  keyLine->version++;
+  keyLine->activeKeyCount++;
+
+  // Keep a flood of keys from scrolling forever
+  if (keyLine->scrollOffset > keyLine->layout.maxWidth) {
+    keyLine->scrollOffset = keyLine->layout.maxWidth;
+  }
+
+  // Update the last key press time for all keys to fade together
+  keyLine->lastKeyPressTime = sceneClockNowUs();
+}
+
+// Initialize the toggle button
+void initToggleButton(void) {
+  float scale = sceneLayout.scale;
+  int margin = scaleSize(BUTTON_MARGIN, scale);
+  toggleButton.rect.w = scaleSize(BUTTON_WIDTH, scale);
+  toggleButton.rect.h = scaleSize(BUTTON_HEIGHT, scale);
+  toggleButton.rect.x = sceneLayout.width - toggleButton.rect.w - margin;
+  toggleButton.rect.y = sceneLayout.height - toggleButton.rect.h - margin;
+  strcpy(toggleButton.text, TOGGLE_BUTTON_TEXT);
+  toggleButton.hovered = false;
+  toggleButton.pressed = false;
+}
+
+// Check if a point is inside the button
+bool isPointInButton(int x, int y, Button *button) {
+  return (x >= button->rect.x && x < button->rect.x + button->rect.w &&
+          y >= button->rect.y && y < button->rect.y + button->rect.h);
+}
+
+// Draw the toggle button
+void drawButton(SDL_Renderer *renderer, TTF_Font *font, Button *button) {
+  // Draw button background
+  SDL_Color bgColor = {100, 100, 100, 255}; // Gray background
+  if (button->hovered) {
+    bgColor.r = 120;
+    bgColor.g = 120;
+    bgColor.b = 120;
+  }
+  if (button->pressed) {
+    bgColor.r = 80;
+    bgColor.g = 80;
+    bgColor.b = 80;
+  }
+
+  SDL_SetRenderDrawColor(renderer, bgColor.r, bgColor.g, bgColor.b, bgColor.a);
+  SDL_RenderFillRect(renderer, &button->rect);
+  sceneDrawCalls++;
+
+  // Draw button border
+  SDL_SetRenderDrawColor(renderer, 50, 50, 50, 255);
+  SDL_RenderDrawRect(renderer, &button->rect);
+  sceneDrawCalls++;
+
+  // Draw button text from the label atlas
+  const LabelEntry *label = labelCacheGet(&labelCache, font, button->text);
+  if (label) {
+    // Center text in button
+    labelCacheDraw(&labelCache, font, button->text,
+                   button->rect.x + (button->rect.w - label->rect.w) / 2,
+                   button->rect.y + (button->rect.h - label->rect.h) / 2, 255);
+  }
+}
+
+
+// Size of a cap from the metrics measured when the font was loaded
+static void measureKeyCap(const KeyCap *cap, int *width, int *height) {
+  const KeyFontMetrics *font = &keyLine->layout.fonts->metrics;
+  *width = 0;
+  *height = 0;
+  for (int i = 0; i < cap->symbolCount; i++) {
+    const KeySymbolMetrics *metrics = keySymbolMetrics(font, cap->symbols[i]);
+    if (i > 0) {
+      *width += keyCapGlyphWidth(font, KEY_CAP_PLUS[0]);
+    }
+    *width += metrics->width;
+    *height = metrics->height > *height ? metrics->height : *height;
+  }
+  if (cap->count > 1) {
+    char digits[8];
+    snprintf(digits, sizeof(digits), "%d", cap->count);
+    *width += keyLine->layout.keyGap + keyCapGlyphWidth(font, KEY_CAP_TIMES[0]);
+    for (int i = 0; digits[i]; i++) {
+      *width += keyCapGlyphWidth(font, digits[i]);
+    }
+  }
+}
+
+void setKeyLineLayout(const SceneLayout *layout) {
+  keyLine->layout = *layout;
+
+  // Measure the keys in the line again, forgetting the departing ones
+  keyLine->tail = keyLine->first;
+  keyLine->departingWidth = 0;
+  keyLine->tallestHead = 0;
+  keyLine->tallestTail = 0;
+  keyLine->currentLineWidth = 0;
+  for (unsigned int i = keyLine->first; i != keyLine->head; i++) {
+    KeyDisplay *key = keyAt(i);
+    measureKeyCap(&key->cap, &key->width, &key->height);
+    trackKeyHeight(i);
+    if (i != keyLine->first) {
+      keyLine->currentLineWidth += layout->keyGap;
+    }
+    keyLine->currentLineWidth += key->width;
+  }
+
+  // A narrower canvas fits fewer keys; the rest go without scrolling off
+  while (keyLine->activeKeyCount > 1 &&
+         keyLine->currentLineWidth > layout->maxWidth) {
+    retireOldestKey();
+  }
+  dropDepartedKeys();
+  keyLine->scrollOffset = 0.0f;
+  keyLine->version++;
+}
+
+// Process a key press
+void processKeyPress(KeySymbol symbol) {
+  processKeyPresses(symbol, 1);
+}
+
+void processKeyPresses(KeySymbol symbol, int count) {
+  KeyCap cap = {{symbol}, 1, count};
+  if (cap.count > KEY_CAP_MAX_COUNT) {
+    cap.count = KEY_CAP_MAX_COUNT;
+  }
+  pushKeyCap(&cap);
+}
+
+void pushKeyCap(const KeyCap *cap) {
+  advanceKeyLine(sceneClockNowUs());
+
+  int keyWidth;
+  int keyHeight;
+  measureKeyCap(cap, &keyWidth, &keyHeight);
+
+  // Scroll the oldest keys off until the new one fits
+  int gap = keyLine->layout.keyGap;
+  while (keyLine->activeKeyCount > 0 &&
+         keyLine->currentLineWidth + gap + keyWidth >
+             keyLine->layout.maxWidth) {
+    retireOldestKey();
+  }
+
+  // Add key to display
+  addKeyDisplay(cap, keyWidth, keyHeight);
+
+  // Update current line width (add key width + gap)
+  if (keyLine->currentLineWidth > 0) {
+    keyLine->currentLineWidth += gap;
+  }
+  keyLine->currentLineWidth += keyWidth;
+}
+
+void updateNewestKeyCap(const KeyCap *cap) {
+  advanceKeyLine(sceneClockNowUs());
+  if (keyLine->activeKeyCount == 0) {
+    pushKeyCap(cap);
+    return;
+  }
+
+  KeyDisplay *newest = keyAt(keyLine->head - 1);
+  int keyWidth;
+  int keyHeight;
+  measureKeyCap(cap, &keyWidth, &keyHeight);
+  int growth = keyWidth - newest->width;
+
+  // A growing cap pushes the oldest keys off like a new one would
+  while (keyLine->activeKeyCount > 1 &&
+         keyLine->currentLineWidth + growth > keyLine->layout.maxWidth) {
+    retireOldestKey();
+  }
+
+  // Right-aligned lines grow to the left, so the older keys slide over
+  if (keyLine->rightAligned) {
+    keyLine->scrollOffset += growth;
+  }
+
+  newest->cap = *cap;
+  newest->width = keyWidth;
+  keyLine->version++;
+  keyLine->currentLineWidth += growth;
+
+  // The newest key is always last in the height queue; re-add it if it grew
+  if (keyHeight > newest->height) {
+    newest->height = keyHeight;
+    keyLine->tallestTail--;
+    trackKeyHeight(keyLine->head - 1);
+  }
+
+  // Update the last key press time for all keys to fade together
+  keyLine->lastKeyPressTime = sceneClockNowUs();
+}
+
+const KeyCap *newestKeyCap(void) {
+  return keyLine->activeKeyCount > 0 ? &keyAt(keyLine->head - 1)->cap : NULL;
+}
+
+// Draw one cap: its labels joined by '+', then the count if above one.
+// Every glyph comes from the label cache, so a changing count never
+// rasterizes new text.
+static void drawKeyCap(const SceneLayout *layout, const KeyDisplay *key,
+                       float x, float y, Uint8 alpha) {
+  TTF_Font *font = layout->fonts->keyFont;
+  const KeyFontMetrics *metrics = &layout->fonts->metrics;
+  const KeyCap *cap = &key->cap;
+  for (int i = 0; i < cap->symbolCount; i++) {
+    if (i > 0) {
+      labelCacheDraw(&labelCache, font, KEY_CAP_PLUS, x, y, alpha);
+      x += keyCapGlyphWidth(metrics, KEY_CAP_PLUS[0]);
+    }
+    labelCacheDraw(&labelCache, font, keySymbolLabel(cap->symbols[i]), x, y,
+                   alpha);
+    x += keySymbolMetrics(metrics, cap->symbols[i])->width;
+  }
+  if (cap->count > 1) {
+    char digits[8];
+    snprintf(digits, sizeof(digits), "%d", cap->count);
+    x += layout->keyGap;
+    labelCacheDraw(&labelCache, font, KEY_CAP_TIMES, x, y, alpha);
+    x += keyCapGlyphWidth(metrics, KEY_CAP_TIMES[0]);
+    for (int i = 0; digits[i]; i++) {
+      char glyph[2] = {digits[i], '\0'};
+      labelCacheDraw(&labelCache, font, glyph, x, y, alpha);
+      x += keyCapGlyphWidth(metrics, digits[i]);
+    }
+  }
+}
+
+// Draw the background and the snapshot's caps from firstKey on, culled to
+// clip. Positions are window coordinates, moved by -originX/-originY when
+// drawing into the composite. With software set, everything is blended
+// into its pixels (and labels into the label cache's software target).
+static void drawKeyStrip(SDL_Renderer *renderer,
+                         const LineComposite *software,
+                         const SceneSnapshot *snapshot, int firstKey,
+                         const SDL_Rect *clip, float stripStart,
+                         float lineEnd, int y, int originX, int originY,
+                         Uint8 alpha) {
+  const SceneLayout *layout = &snapshot->layout;
+  SDL_Color bgColor = {0, 0, 0, 255}; // Black background for text
+  float clipEnd = (float)(clip->x + clip->w);
+  float padding = (float)layout->linePadding;
+
+  // Draw a single background for all keys
+  SDL_FRect bgRect;
+  bgRect.x = stripStart - padding > clip->x ? stripStart - padding : clip->x;
+  bgRect.y = (float)clip->y;
+  bgRect.w = (lineEnd + padding < clipEnd ? lineEnd + padding : clipEnd) -
+             bgRect.x;
+  bgRect.h = (float)clip->h;
+  bgRect.x -= originX;
+  bgRect.y -= originY;
+  if (software) {
+    // Whole pixels, the way the software renderer fills rects
+    int x = (int)bgRect.x;
+    int width = (int)bgRect.w;
+    int height = (int)bgRect.h;
+    if (x < 0) {
+      width += x;
+      x = 0;
+    }
+    if (x + width > software->width) {
+      width = software->width - x;
+    }
+    if (height > software->height) {
+      height = software->height;
+    }
+    if (width > 0 && height > 0) {
+      pixelBlendFill(software->pixels + x * 4, software->width * 4, width,
+                     height,
+                     pixelBlendColor(bgColor.r, bgColor.g, bgColor.b, alpha));
+    }
+  } else {
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+    SDL_SetRenderDrawColor(renderer, bgColor.r, bgColor.g, bgColor.b,
+                           alpha);
+    SDL_RenderFillRectF(renderer, &bgRect);
+  }
+  sceneDrawCalls++;
+
+  // One pass over the keys on screen, at sub-pixel positions
+  float currentX = stripStart;
+  for (int i = firstKey; i < snapshot->keyCount; i++) {
+    const KeyDisplay *key = &snapshot->keys[i];
+    if (currentX + key->width > clip->x && currentX < clipEnd) {
+      // Blit the cached labels
+      drawKeyCap(layout, key, currentX - originX, (float)(y - originY),
+                 alpha);
+    }
+
+    // Update X position for next key
+    currentX += key->width + layout->keyGap;
+  }
+}
+
+// Software framebuffer version of composeKeyLine: the strip goes into the
+// composite's pixels through the blend kernels
+static bool composeKeyLinePixels(SDL_Renderer *renderer,
+                                 LineComposite *composite,
+                                 const SceneSnapshot *snapshot, int firstKey,
+                                 const SDL_Rect *clip, float stripStart,
+                                 float lineEnd, int y) {
+  // Grow only when the clip outgrows it
+  if (!composite->pixels || composite->width < clip->w ||
+      composite->height < clip->h) {
+    destroyLineComposite(composite);
+    composite->pixels = SDL_malloc((size_t)clip->w * clip->h * 4);
+    if (!composite->pixels) {
+      return false;
+    }
+    composite->width = clip->w;
+    composite->height = clip->h;
+  }
+  composite->renderer = renderer;
+
+  int pitch = composite->width * 4;
+  for (int row = 0; row < clip->h; row++) {
+    memset(composite->pixels + row * pitch, 0, clip->w * 4);
+  }
+  sceneDrawCalls++;
+  labelCacheSetSoftwareTarget(&labelCache, composite->pixels, pitch, clip->w,
+                              clip->h);
+  drawKeyStrip(renderer, composite, snapshot, firstKey, clip, stripStart,
+               lineEnd, y, clip->x, clip->y, 255);
+  labelCacheSetSoftwareTarget(&labelCache, NULL, 0, 0, 0);
+
+  composite->valid = true;
+  composite->version = snapshot->version;
+  composite->stripStart = stripStart;
+  composite->y = y;
+  return true;
+}
+
+// Fade the composed line onto the software framebuffer at clip. Draw calls
+// queued before it (the clear) have to reach the pixels first.
+static void blendLineComposite(SDL_Renderer *renderer,
+                               const LineComposite *composite,
+                               const SDL_Rect *clip, Uint8 alpha) {
+#if SDL_VERSION_ATLEAST(2, 0, 10)
+  SDL_RenderFlush(renderer);
+#endif
+  SDL_Surface *framebuffer = composite->framebuffer;
+  int left = clip->x > 0 ? clip->x : 0;
+  int top = clip->y > 0 ? clip->y : 0;
+  int right = clip->x + clip->w < framebuffer->w ? clip->x + clip->w
+                                                  : framebuffer->w;
+  int bottom = clip->y + clip->h < framebuffer->h ? clip->y + clip->h
+                                                   : framebuffer->h;
+  if (right <= left || bottom <= top) {
+    return;
+  }
+  int pitch = composite->width * 4;
+  pixelBlendCopy((Uint8 *)framebuffer->pixels + top * framebuffer->pitch +
+                     left * 4,
+                 framebuffer->pitch,
+                 composite->pixels + (top - clip->y) * pitch +
+                     (left - clip->x) * 4,
+                 pitch, right - left, bottom - top, alpha);
+  sceneDrawCalls++;
+}
+
+// Draw the strip at full opacity into the composite texture, which covers
+// exactly the clip rect. Returns false if the renderer cannot render to
+// textures, after which keys are always drawn directly.
+static bool composeKeyLine(SDL_Renderer *renderer, LineComposite *composite,
+                           const SceneSnapshot *snapshot, int firstKey,
+                           const SDL_Rect *clip, float stripStart,
+                           float lineEnd, int y) {
+  composite->valid = false;
+  if (composite->framebuffer && labelCache.coverage) {
+    return composeKeyLinePixels(renderer, composite, snapshot, firstKey,
+                                clip, stripStart, lineEnd, y);
+  }
+  if (composite->unsupported) {
+    return false;
+  }
+
+  // Grow (or move to a new renderer) only when the clip outgrows it
+  if (!composite->texture || composite->renderer != renderer ||
+      composite->width < clip->w || composite->height < clip->h) {
+    destroyLineComposite(composite);
+    composite->texture =
+        SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888,
+                          SDL_TEXTUREACCESS_TARGET, clip->w, clip->h);
+    if (!composite->texture) {
+      printf("Key line composite unavailable, drawing keys directly: %s\n",
+             SDL_GetError());
+      composite->unsupported = true;
+      return false;
+    }
+    SDL_SetTextureBlendMode(composite->texture, SDL_BLENDMODE_BLEND);
+    composite->renderer = renderer;
+    composite->width = clip->w;
+    composite->height = clip->h;
+  }
+
+  // The line may itself be drawn into a view's texture; go back to it after
+  SDL_Texture *target = SDL_GetRenderTarget(renderer);
+  if (SDL_SetRenderTarget(renderer, composite->texture) < 0) {
+    return false;
+  }
+  SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+  SDL_RenderClear(renderer);
+  sceneDrawCalls++;
+  drawKeyStrip(renderer, NULL, snapshot, firstKey, clip, stripStart,
+               lineEnd, y, clip->x, clip->y, 255);
+  SDL_SetRenderTarget(renderer, target);
+
+  composite->valid = true;
+  composite->version = snapshot->version;
+  composite->stripStart = stripStart;
+  composite->y = y;
+  return true;
+}
+
+void destroyLineComposite(LineComposite *composite) {
+  if (composite->texture) {
+    SDL_DestroyTexture(composite->texture);
+    composite->texture = NULL;
+  }
+  SDL_free(composite->pixels);
+  composite->pixels = NULL;
+  composite->renderer = NULL;
+  composite->valid = false;
+}
+
+// Where the line ends for a given scroll offset. Both alignments read
+// oldest to newest from left to right.
+static float keyLineEnd(const SceneLayout *layout, bool rightAlign,
+                        float scroll, int lineWidth) {
+  if (rightAlign) {
+    return layout->width - layout->rightMargin + scroll;
+  }
+  return layout->leftMargin + scroll + lineWidth;
+}
+
+void captureSceneSnapshot(SceneSnapshot *snapshot, Uint64 now) {
+  advanceKeyLine(now);
+
+  // Departing keys past the left margin only ever move further left
+  const SceneLayout *layout = &keyLine->layout;
+  float stripStart = keyLineEnd(layout, keyLine->rightAligned,
+                                keyLine->scrollOffset,
+                                keyLine->currentLineWidth) -
+                     keyLine->currentLineWidth - keyLine->departingWidth;
+  while (keyLine->tail != keyLine->first &&
+         stripStart + keyAt(keyLine->tail)->width <=
+             layout->leftMargin - layout->linePadding) {
+    int advance = keyAt(keyLine->tail)->width + layout->keyGap;
+    stripStart += advance;
+    keyLine->departingWidth -= advance;
+    keyLine->tail++;
+    keyLine->version++;
+  }
+
+  snapshot->keyCount = 0;
+  for (unsigned int i = keyLine->tail; i != keyLine->head; i++) {
+    snapshot->keys[snapshot->keyCount++] = *keyAt(i);
+  }
+  snapshot->departingCount = (int)(keyLine->first - keyLine->tail);
+  snapshot->departingWidth = keyLine->departingWidth;
+  snapshot->lineWidth = keyLine->currentLineWidth;
+  snapshot->maxHeight = keyLineMaxHeight();
+  snapshot->rightAligned = keyLine->rightAligned;
+  snapshot->scrollOffset = keyLine->scrollOffset;
+  snapshot->scrollTime = now;
+  snapshot->lastKeyPressTime = keyLine->lastKeyPressTime;
+  snapshot->version = keyLine->version;
+  snapshot->layout = keyLine->layout;
+}
+
+// Microseconds from then to now, or zero if then is (slightly) ahead
+static Uint64 elapsedSince(Uint64 then, Uint64 now) {
+  return now > then ? now - then : 0;
+}
+
+bool sceneSnapshotVisible(const SceneSnapshot *snapshot, Uint64 now) {
+  return snapshot->keyCount > snapshot->departingCount &&
+         elapsedSince(snapshot->lastKeyPressTime, now) <=
+             FADE_DURATION * 1000ull;
+}
+
+Uint8 sceneSnapshotAlpha(const SceneSnapshot *snapshot, Uint64 now) {
+  if (!sceneSnapshotVisible(snapshot, now)) {
+    return 0;
+  }
+  Uint64 elapsedTime = elapsedSince(snapshot->lastKeyPressTime, now);
+  return 255 - (Uint8)((elapsedTime * 255) / (FADE_DURATION * 1000ull));
+}
+
+int keyCapText(const KeyCap *cap, char *text, int size) {
+  int length = 0;
+  text[0] = '\0';
+  for (int i = 0; i < cap->symbolCount && length < size; i++) {
+    length += snprintf(text + length, size - length, "%s%s",
+                       i > 0 ? KEY_CAP_PLUS : "",
+                       keySymbolLabel(cap->symbols[i]));
+  }
+  if (cap->count > 1 && length < size) {
+    length += snprintf(text + length, size - length, " " KEY_CAP_TIMES "%d",
+                       cap->count);
+  }
+  return length < size ? length : size - 1;
+}
+
+bool renderKeyLine(SDL_Renderer *renderer, LineComposite *composite,
+                   const SceneSnapshot *snapshot, Uint64 currentTime) {
+  // Define colors
+  SDL_Color chromaKeyColor = {0, 0, 0, 0}; // Transparent background
+
+  // Clear screen with transparent background
+  SDL_SetRenderDrawColor(renderer, chromaKeyColor.r, chromaKeyColor.g,
+                         chromaKeyColor.b, chromaKeyColor.a);
+  SDL_RenderClear(renderer);
+  sceneDrawCalls++;
+
+  // Only proceed if we have active keys that have not faded out
+  bool visible = sceneSnapshotVisible(snapshot, currentTime);
+  if (visible) {
+    // Calculate alpha for fading (both text and background)
+    Uint8 alpha = sceneSnapshotAlpha(snapshot, currentTime);
+
+    // Ease the scroll from where the snapshot left it; departing keys are
+    // gone once it settles
+    float scroll =
+        easeScroll(snapshot->scrollOffset,
+                   elapsedSince(snapshot->scrollTime, currentTime));
+    int firstKey = 0;
+    int departingWidth = snapshot->departingWidth;
+    if (scroll == 0.0f) {
+      firstKey = snapshot->departingCount;
+      departingWidth = 0;
+    }
+
+    // Calculate Y position to center vertically
+    const SceneLayout *layout = &snapshot->layout;
+    int maxHeight = snapshot->maxHeight;
+    int y = layout->height / 2 - maxHeight / 2;
+
+    // The strip of departing and live keys, displaced by the scroll
+    float lineEnd = keyLineEnd(layout, snapshot->rightAligned, scroll,
+                               snapshot->lineWidth);
+    float lineStart = lineEnd - snapshot->lineWidth;
+    float stripStart = lineStart - departingWidth;
+
+    // Keys outside the margins are clipped while they scroll in or out
+    int padding = layout->linePadding;
+    SDL_Rect clip = {layout->leftMargin - padding, y - padding,
+                     layout->maxWidth + 2 * padding,
+                     maxHeight + 2 * padding};
+
+    // Re-compose only when the keys or their positions changed; a frame
+    // that only fades is one blit of the composite
+    if (composite->valid && composite->renderer == renderer &&
+        composite->version == snapshot->version &&
+        composite->stripStart == stripStart && composite->y == y) {
+      composite->reused++;
+    } else if (composeKeyLine(renderer, composite, snapshot, firstKey, &clip,
+                              stripStart, lineEnd, y)) {
+      composite->rebuilt++;
+    }
+
+    if (composite->valid && composite->pixels) {
+      blendLineComposite(renderer, composite, &clip, alpha);
+    } else if (composite->valid) {
+      SDL_Rect source = {0, 0, clip.w, clip.h};
+      SDL_SetTextureAlphaMod(composite->texture, alpha);
+      SDL_RenderCopy(renderer, composite->texture, &source, &clip);
+      sceneDrawCalls++;
+    } else {
+      // No render targets; draw the keys straight to the screen
+      SDL_RenderSetClipRect(renderer, &clip);
+      drawKeyStrip(renderer, NULL, snapshot, firstKey, &clip, stripStart,
+                   lineEnd, y, 0, 0, alpha);
+      SDL_RenderSetClipRect(renderer, NULL);
+    }
+  }
+  return visible;
+}
+
+// Draw the key line, its background and the toggle button
+bool renderScene(SDL_Renderer *renderer, const SceneSnapshot *snapshot,
+                 Uint64 currentTime) {
+  bool visible =
+      renderKeyLine(renderer, &lineComposite, snapshot, currentTime);
+
+  // Draw the toggle button with the smaller font
+  drawButton(renderer, sceneLayout.fonts->buttonFont, &toggleButton);
+  return visible;
+}
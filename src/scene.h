@@ -0,0 +1,246 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <stdbool.h>
+
+#ifdef _WIN32
+#include <SDL.h>
+#include <SDL_ttf.h>
+#else
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#endif
+
+#include "keysyms.h"
+#include "label_cache.h"
+#include "scene_fonts.h"
+
+// Default canvas. The sizes in pixels below are for this canvas and are
+// multiplied by the output scale.
+#define WINDOW_WIDTH 1280
+#define WINDOW_HEIGHT 720
+#define KEY_LINE_CAPACITY 1024 // Keys remembered by the line; power of two
+#define SCROLL_SMOOTHING_MS 80 // Time constant of the scroll animation
+#define FADE_DURATION 2000  // Time in milliseconds for keys to fade out
+#define KEY_GAP 4           // 4 pixel gap between keys
+#define FONT_SIZE 36        // Larger text size
+#define BUTTON_FONT_SIZE 18 // Smaller font size for button
+#define LEFT_MARGIN 50      // Left margin for alignment
+#define RIGHT_MARGIN 50     // Right margin for alignment
+#define LINE_PADDING 4      // Background around the keys
+#define BUTTON_WIDTH 160 // Width of the toggle button (wider for monospaced font)
+#define BUTTON_HEIGHT 40 // Height of the toggle button
+#define BUTTON_MARGIN 20 // Distance of the button from the bottom right
+#define TOGGLE_BUTTON_TEXT "Toggle Align"
+
+#define KEY_CAP_MAX_SYMBOLS 4 // Modifiers plus a key in one chord cap
+#define KEY_CAP_MAX_COUNT 9999
+
+// What one cap on the line shows: a key, or a chord of modifiers followed by
+// a key, pressed count times in a row
+typedef struct {
+  KeySymbol symbols[KEY_CAP_MAX_SYMBOLS];
+  int symbolCount;
+  int count;
+} KeyCap;
+
+typedef struct {
+  KeyCap cap;
+  int width;
+  int height;
+} KeyDisplay;
+
+// A canvas size and the sizes above at its output scale, in pixels
+typedef struct {
+  int width;
+  int height;
+  float scale;
+  const SceneFonts *fonts; // Opened at this scale
+  int keyGap;
+  int leftMargin;
+  int rightMargin;
+  int maxWidth; // Longest line between the margins
+  int linePadding;
+  int atlasSize; // Label atlas side that fits labels at this scale
+} SceneLayout;
+
+// The key line as a ring, oldest first. Keys in [first, head) make up the
+// line; keys in [tail, first) were pushed out and are still scrolling off.
+// Indices grow freely and are masked on access.
+typedef struct {
+  KeyDisplay keys[KEY_LINE_CAPACITY];
+  unsigned int tail;
+  unsigned int first;
+  unsigned int head;
+  int departingWidth; // Width of [tail, first) including gaps
+
+  // Monotonic queue of key indices with decreasing heights; the front is
+  // the tallest key in the line
+  unsigned int tallest[KEY_LINE_CAPACITY];
+  unsigned int tallestHead;
+  unsigned int tallestTail;
+
+  // Pixels the keys are drawn to the right of their resting place; eases
+  // back to zero so shifts in the line scroll instead of jumping
+  float scrollOffset;
+  Uint64 lastScrollTime; // Scene clock microseconds, like lastKeyPressTime
+
+  unsigned int version; // Bumped whenever a key is added, changed or dropped
+
+  SceneLayout layout; // What the keys were measured and laid out for
+  int activeKeyCount; // Keys in the line, not counting departing ones
+  Uint64 lastKeyPressTime; // All keys fade together from the newest press
+  int currentLineWidth;
+  bool rightAligned; // The line grows to the left from the right margin
+} KeyLine;
+
+// The key line (background and caps) drawn once at full opacity into a
+// render target. Frames where only the fade changes are a single
+// alpha-modulated copy of it.
+typedef struct {
+  SDL_Texture *texture;
+  SDL_Renderer *renderer; // Owner of texture
+  int width;
+  int height;
+  bool valid; // Cleared when render target contents are lost
+  bool unsupported; // Renderer has no render targets; draw keys directly
+
+  // What the texture shows
+  unsigned int version;
+  float stripStart;
+  int y;
+
+  Uint64 reused;  // Frames served from the composite
+  Uint64 rebuilt; // Frames that re-composed it
+
+  // Set when the renderer draws into this RGBA32 software framebuffer: the
+  // line is then composed into pixels instead of texture and faded onto the
+  // framebuffer with the pixel blend kernels, skipping SDL's blitters
+  SDL_Surface *framebuffer;
+  Uint8 *pixels; // Premultiplied RGBA32, width x height
+} LineComposite;
+
+// Immutable copy of the key line, handed from the thread that lays keys out
+// to the thread that draws them. Positions and the fade are derived from it
+// at draw time, so one snapshot can be drawn for as many frames as needed.
+typedef struct {
+  KeyDisplay keys[KEY_LINE_CAPACITY]; // Departing keys first, then the line
+  int keyCount;
+  int departingCount;
+  int departingWidth;
+  int lineWidth;
+  int maxHeight;
+  bool rightAligned;
+  float scrollOffset; // At scrollTime; eases toward zero from there
+  Uint64 scrollTime;  // Scene clock microseconds
+  Uint64 lastKeyPressTime;
+  unsigned int version; // The line's version when taken
+  SceneLayout layout;   // Draw the keys with this, whatever the canvas is now
+
+  // Filled in by the producer: a number that changes with every publish,
+  // and how many keys had been laid out when it was taken
+  Uint64 sequence;
+  Uint64 keysLaidOut;
+} SceneSnapshot;
+
+typedef struct {
+  SDL_Rect rect;
+  char text[32];
+  bool hovered;
+  bool pressed;
+} Button;
+
+// The key line and everything drawn around it. main.c owns the window, the
+// capture sources and the loops; the benchmark drives these directly.
+//
+// The key line model (the line keyLine points at, and the functions that
+// change it) belongs to one thread, which publishes SceneSnapshots. Point
+// keyLine at another line to drive several views, each laid out for its own
+// canvas, from the same keys. The canvas layout, the label cache and
+// everything drawn belong to the render thread; the label cache keys labels
+// by font, so views at different scales share one atlas.
+extern KeyLine *keyLine;
+extern SceneLayout sceneLayout;
+extern Button toggleButton;
+extern LabelCache labelCache;
+
+// Fills, outlines and clears issued so far; label blits are counted by the
+// label cache
+extern Uint64 sceneDrawCalls;
+
+extern LineComposite lineComposite;
+
+// Size a layout for a width x height canvas at an output scale, or at the
+// scale that fills it from the default canvas if scale is 0, opening the
+// fonts for a new scale. Returns false, leaving layout alone, if the fonts
+// cannot be loaded.
+bool sceneLayoutInit(SceneLayout *layout, int width, int height,
+                     float scale);
+
+// Size the window's scene (sceneLayout) as sceneLayoutInit does and move the
+// toggle button; the key line follows through setKeyLineLayout. Returns
+// false, keeping the previous canvas, if the fonts cannot be loaded.
+bool setSceneCanvas(int width, int height, float scale);
+
+// Reset the key line to the canvas and lay out the toggle button; call after
+// setSceneCanvas
+void initScene(void);
+
+// Measure and lay the key line out again for a new canvas, keeping as many
+// of its keys as still fit
+void setKeyLineLayout(const SceneLayout *layout);
+
+// Drop every key from the line
+void clearKeyDisplays(void);
+
+// Free a composite's texture; call before destroying its renderer
+void destroyLineComposite(LineComposite *composite);
+
+void addKeyDisplay(const KeyCap *cap, int width, int height);
+void processKeyPress(KeySymbol symbol);
+
+// Lay out one cap standing for count presses of symbol ("Wheel Down ×14")
+void processKeyPresses(KeySymbol symbol, int count);
+
+// Lay out a new cap at the end of the line
+void pushKeyCap(const KeyCap *cap);
+
+// Replace the newest cap in place (a higher count or a longer chord), or
+// push it if the line is empty
+void updateNewestKeyCap(const KeyCap *cap);
+
+// The cap at the end of the line, or NULL when the line is empty
+const KeyCap *newestKeyCap(void);
+
+void initToggleButton(void);
+bool isPointInButton(int x, int y, Button *button);
+void drawButton(SDL_Renderer *renderer, TTF_Font *font, Button *button);
+
+// Copy the key line into snapshot as of now, first forgetting it if it has
+// faded out and dropping departing keys that can no longer be seen. Times
+// passed to the snapshot functions are scene clock microseconds.
+void captureSceneSnapshot(SceneSnapshot *snapshot, Uint64 now);
+
+// Whether drawing snapshot at now shows any keys
+bool sceneSnapshotVisible(const SceneSnapshot *snapshot, Uint64 now);
+
+// Opacity of the snapshot's key line at now; 0 once it has faded out. The
+// curve only depends on the time since the newest press, never on how many
+// frames were drawn in between.
+Uint8 sceneSnapshotAlpha(const SceneSnapshot *snapshot, Uint64 now);
+
+// Write what a cap shows, e.g. "Ctrl+z \xD73", into text as Latin-1.
+// Returns the length, truncated to fit size.
+int keyCapText(const KeyCap *cap, char *text, int size);
+
+// Clear the render target and draw the snapshot's key line and its
+// background, through composite. Returns whether any keys were drawn.
+bool renderKeyLine(SDL_Renderer *renderer, LineComposite *composite,
+                   const SceneSnapshot *snapshot, Uint64 currentTime);
+
+// Draw the window: renderKeyLine through lineComposite, then the toggle
+// button. Returns whether any keys were drawn.
+bool renderScene(SDL_Renderer *renderer, const SceneSnapshot *snapshot,
+                 Uint64 currentTime);
+
+#endif
@@ -0,0 +1,34 @@
+#include "scene_clock.h"
+
+#include <stdbool.h>
+
+static bool useVirtualClock = false;
+static Uint64 virtualNow = 0;
+
+// Counter value and SDL_GetTicks() (in microseconds) at sceneClockInit
+static Uint64 baseCounter = 0;
+static Uint64 baseUs = 0;
+
+Uint64 sceneClockNowUs(void) {
+  if (useVirtualClock) {
+    return virtualNow;
+  }
+  // Whole seconds and the remainder apart, so a fast counter cannot
+  // overflow the multiplication
+  Uint64 frequency = SDL_GetPerformanceFrequency();
+  Uint64 ticks = SDL_GetPerformanceCounter() - baseCounter;
+  return baseUs + ticks / frequency * 1000000 +
+         ticks % frequency * 1000000 / frequency;
+}
+
+Uint32 sceneClockNow(void) { return (Uint32)(sceneClockNowUs() / 1000); }
+
+void sceneClockInit(void) {
+  baseCounter = SDL_GetPerformanceCounter();
+  baseUs = (Uint64)SDL_GetTicks() * 1000;
+}
+
+void sceneClockSet(Uint64 nowUs) {
+  useVirtualClock = true;
+  virtualNow = nowUs;
+}
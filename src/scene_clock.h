@@ -0,0 +1,27 @@
+#ifndef SCENE_CLOCK_H
+#define SCENE_CLOCK_H
+
+#ifdef _WIN32
+#include <SDL.h>
+#else
+#include <SDL2/SDL.h>
+#endif
+
+// Time source for everything animated on screen, in microseconds from the
+// performance counter so fades and scrolls step evenly at any frame rate.
+// Windowed mode follows the counter, lined up with SDL_GetTicks() by
+// sceneClockInit(); headless mode drives a virtual clock one frame at a time
+// so it can render faster (or slower) than real time.
+Uint64 sceneClockNowUs(void);
+
+// The same clock in milliseconds, for timers (coalescing, replay)
+Uint32 sceneClockNow(void);
+
+// Line the real clock up with SDL_GetTicks(). Call once after SDL_Init,
+// before other threads read the clock.
+void sceneClockInit(void);
+
+// Switch to the virtual clock and set its current time in microseconds
+void sceneClockSet(Uint64 nowUs);
+
+#endif
@@ -0,0 +1,83 @@
+#include "scene_fonts.h"
+
+#include <stdio.h>
+
+#include "baked_fonts.h"
+
+bool sceneFontsBaked = true;
+
+static SceneFonts sceneFonts[SCENE_SCALE_MAX_STEPS + 1];
+
+int sceneScaleSteps(float scale) {
+  int steps = (int)(scale * SCENE_SCALE_STEPS + 0.5f);
+  if (steps < SCENE_SCALE_MIN_STEPS) {
+    return SCENE_SCALE_MIN_STEPS;
+  }
+  return steps > SCENE_SCALE_MAX_STEPS ? SCENE_SCALE_MAX_STEPS : steps;
+}
+
+// Open an embedded font at a point size
+static TTF_Font *openEmbeddedFont(const unsigned char *data, size_t length,
+                                  int pointSize) {
+  SDL_RWops *source = SDL_RWFromConstMem(data, (int)length);
+  return source ? TTF_OpenFontRW(source, 1, pointSize) : NULL;
+}
+
+const SceneFonts *sceneFontsGet(int scaleSteps, int fontSize,
+                                int buttonFontSize) {
+  SceneFonts *fonts = &sceneFonts[scaleSteps];
+  if (fonts->keyFont) {
+    return fonts;
+  }
+
+  fonts->keyFont =
+      openEmbeddedFont(bakedKeyFontData, bakedKeyFontLength, fontSize);
+  if (!fonts->keyFont) {
+    printf("Failed to load font! TTF_Error: %s\n", TTF_GetError());
+    return NULL;
+  }
+
+  // Every key label is measured up front so layout never calls into
+  // FreeType; the build already did it for the baked scale
+  if (sceneFontsBaked && scaleSteps == bakedScaleSteps) {
+    fonts->metrics = bakedKeyMetrics;
+  } else {
+    keySymbolsMeasure(&fonts->metrics, fonts->keyFont);
+  }
+
+  fonts->buttonFont = openEmbeddedFont(bakedButtonFontData,
+                                       bakedButtonFontLength, buttonFontSize);
+  if (!fonts->buttonFont) {
+    // Fall back to main font if button font can't be loaded
+    fonts->buttonFont = fonts->keyFont;
+  }
+  fonts->scaleSteps = scaleSteps;
+  return fonts;
+}
+
+bool sceneFontsLoadLabels(LabelCache *cache, const SceneFonts *fonts) {
+  // Baked button labels were drawn with the button font
+  if (!sceneFontsBaked || fonts->scaleSteps != bakedScaleSteps ||
+      fonts->buttonFont == fonts->keyFont) {
+    return false;
+  }
+  TTF_Font *owners[2];
+  owners[BAKED_FONT_KEY] = fonts->keyFont;
+  owners[BAKED_FONT_BUTTON] = fonts->buttonFont;
+  return labelCacheLoadImage(cache, &bakedLabels, owners);
+}
+
+void sceneFontsCloseAll(void) {
+  for (int i = 0; i <= SCENE_SCALE_MAX_STEPS; i++) {
+    SceneFonts *fonts = &sceneFonts[i];
+    if (!fonts->keyFont) {
+      continue;
+    }
+    if (fonts->buttonFont != fonts->keyFont) {
+      TTF_CloseFont(fonts->buttonFont);
+    }
+    TTF_CloseFont(fonts->keyFont);
+    fonts->keyFont = NULL;
+    fonts->buttonFont = NULL;
+  }
+}
@@ -0,0 +1,54 @@
+#ifndef SCENE_FONTS_H
+#define SCENE_FONTS_H
+
+#include <stdbool.h>
+
+#ifdef _WIN32
+#include <SDL.h>
+#include <SDL_ttf.h>
+#else
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#endif
+
+#include "keysyms.h"
+#include "label_cache.h"
+
+// Output scales are rounded to quarters, so dragging a window through every
+// size opens at most a handful of font sizes
+#define SCENE_SCALE_STEPS 4
+#define SCENE_SCALE_MIN_STEPS 2  // 0.5x
+#define SCENE_SCALE_MAX_STEPS 16 // 4x
+
+// The fonts for one output scale, opened from the copies embedded in the
+// binary. Labels are rasterized from these at the scale's pixel size, and
+// the label cache keys them by font, so every scale has its own cached
+// labels.
+typedef struct {
+  int scaleSteps; // Scale in quarters
+  TTF_Font *keyFont;
+  TTF_Font *buttonFont; // keyFont when the button font is missing
+  KeyFontMetrics metrics; // Measured with keyFont
+} SceneFonts;
+
+// Use the metrics and labels baked at build time for the scale they were
+// baked at (default); off measures and rasterizes everything at runtime
+extern bool sceneFontsBaked;
+
+// Nearest scale fonts can be opened at, in quarters
+int sceneScaleSteps(float scale);
+
+// The fonts for a scale from sceneScaleSteps, opened at the given point
+// sizes and measured the first time the scale is used. They stay open until
+// sceneFontsCloseAll, so snapshots and the label cache may keep pointing at
+// them. Returns NULL if the key font cannot be loaded. Main thread only.
+const SceneFonts *sceneFontsGet(int scaleSteps, int fontSize,
+                                int buttonFontSize);
+
+// Fill a freshly created label cache with the labels baked for fonts' scale.
+// Returns false if there are none; labels are then rasterized on first use.
+bool sceneFontsLoadLabels(LabelCache *cache, const SceneFonts *fonts);
+
+void sceneFontsCloseAll(void);
+
+#endif
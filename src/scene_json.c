@@ -0,0 +1,145 @@
+#include "scene_json.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+
+#define EVENT_RESERVE 32 // Room kept for the closing "omitted" count
+#define KEY_MAX 192      // Longest key entry: a quoted 64 byte cap and sizes
+#define LINE_RESERVE 64  // Room kept to close the line and open the events
+
+typedef struct {
+  char *out;
+  int size;
+  int length;
+} JsonWriter;
+
+static int writerSpace(const JsonWriter *writer) {
+  return writer->size - writer->length;
+}
+
+// Append formatted text; text that does not fit is cut off, and the caller
+// keeps within size by checking writerSpace first
+static void writeFormat(JsonWriter *writer, const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  int written = vsnprintf(writer->out + writer->length, writerSpace(writer),
+                          format, args);
+  va_end(args);
+  if (written > 0) {
+    writer->length += written < writerSpace(writer) ? written
+                                                    : writerSpace(writer) - 1;
+  }
+}
+
+// Append a Latin-1 label as a quoted UTF-8 JSON string
+static void writeLabel(JsonWriter *writer, const char *label) {
+  char quoted[128];
+  int length = 0;
+  quoted[length++] = '"';
+  for (const unsigned char *c = (const unsigned char *)label;
+       *c && length < (int)sizeof(quoted) - 8; c++) {
+    if (*c == '"' || *c == '\\') {
+      quoted[length++] = '\\';
+      quoted[length++] = (char)*c;
+    } else if (*c < 0x20) {
+      length += snprintf(quoted + length, sizeof(quoted) - length,
+                         "\\u%04x", *c);
+    } else if (*c >= 0x80) {
+      quoted[length++] = (char)(0xC0 | *c >> 6);
+      quoted[length++] = (char)(0x80 | (*c & 0x3F));
+    } else {
+      quoted[length++] = (char)*c;
+    }
+  }
+  quoted[length++] = '"';
+  quoted[length] = '\0';
+  writeFormat(writer, "%s", quoted);
+}
+
+// Format one key of the line into entry, KEY_MAX bytes; returns its length
+static int formatKey(const KeyDisplay *key, bool comma, char *entry) {
+  JsonWriter writer = {entry, KEY_MAX, 0};
+  char text[64];
+  keyCapText(&key->cap, text, sizeof(text));
+  writeFormat(&writer, "%s{\"label\":", comma ? "," : "");
+  writeLabel(&writer, text);
+  writeFormat(&writer, ",\"width\":%d,\"height\":%d}", key->width,
+              key->height);
+  return writer.length;
+}
+
+// Write the keys from first to end that fit in room bytes, keeping the
+// newest, since the end of the line is what is being read. Returns the
+// first key written.
+static int writeNewestKeys(JsonWriter *writer, const SceneSnapshot *snapshot,
+                           int first, int end, int room) {
+  char entry[KEY_MAX];
+  int start = end;
+  while (start > first) {
+    int length = formatKey(&snapshot->keys[start - 1], true, entry);
+    if (length >= room) {
+      break;
+    }
+    room -= length;
+    start--;
+  }
+  for (int i = start; i < end; i++) {
+    formatKey(&snapshot->keys[i], i > start, entry);
+    writeFormat(writer, "%s", entry);
+  }
+  return start;
+}
+
+int sceneJsonFormat(char *out, int size, Uint64 frame,
+                    const SceneSnapshot *snapshot, Uint64 now,
+                    const KeyEvent *events, int eventCount) {
+  JsonWriter writer = {out, size, 0};
+  const SceneLayout *layout = &snapshot->layout;
+
+  // Only the live line; departing keys are an animation detail
+  bool visible = sceneSnapshotVisible(snapshot, now);
+  writeFormat(&writer,
+              "{\"frame\":%llu,\"time\":%u,\"line\":{\"alpha\":%.3f,"
+              "\"align\":\"%s\",\"width\":%d,\"height\":%d,\"scale\":%.2f,"
+              "\"keys\":[",
+              (unsigned long long)frame, (unsigned)(now / 1000),
+              sceneSnapshotAlpha(snapshot, now) / 255.0,
+              snapshot->rightAligned ? "right" : "left",
+              visible ? snapshot->lineWidth : 0,
+              visible ? snapshot->maxHeight : 0, layout->scale);
+
+  // Many small caps fit on a wide canvas, so the keys are bounded too
+  int first = snapshot->departingCount;
+  int end = visible ? snapshot->keyCount : first;
+  int keysStart = writer.length;
+  int start = first;
+  char entry[KEY_MAX];
+  for (int i = first; i < end; i++) {
+    int length = formatKey(&snapshot->keys[i], i > first, entry);
+    if (length >= writerSpace(&writer) - LINE_RESERVE - EVENT_RESERVE) {
+      // Start over with as many of the newest keys as fit
+      writer.length = keysStart;
+      start = writeNewestKeys(&writer, snapshot, first, end,
+                              writerSpace(&writer) - LINE_RESERVE -
+                                  EVENT_RESERVE);
+      break;
+    }
+    writeFormat(&writer, "%s", entry);
+  }
+  writeFormat(&writer, "],\"omitted\":%d},\"events\":[", start - first);
+
+  // The line is bounded by the canvas width, but a burst of events is not
+  int written = 0;
+  for (; written < eventCount; written++) {
+    if (writerSpace(&writer) < 64 + EVENT_RESERVE) {
+      break;
+    }
+    writeFormat(&writer, "%s{\"label\":", written > 0 ? "," : "");
+    writeLabel(&writer, keySymbolLabel(events[written].symbol));
+    writeFormat(&writer, ",\"repeat\":%s,\"count\":%d}",
+                events[written].flags & KEY_EVENT_REPEAT ? "true" : "false",
+                keyEventCount(&events[written]));
+  }
+  writeFormat(&writer, "],\"omitted\":%d}", eventCount - written);
+  return writer.length;
+}
@@ -0,0 +1,24 @@
+#ifndef SCENE_JSON_H
+#define SCENE_JSON_H
+
+#include "key_ring.h"
+#include "scene.h"
+
+// Format one frame for browser overlays as a JSON object in UTF-8:
+//
+//   {"frame":N,"time":MS,
+//    "line":{"alpha":A,"align":"left"|"right","width":W,"height":H,
+//            "scale":S,"keys":[{"label":"Ctrl+z ×3","width":W,
+//                               "height":H},...],"omitted":N},
+//    "events":[{"label":"z","repeat":false,"count":1},...],"omitted":N}
+//
+// line is the key line as drawn at now, alpha from 0 (faded out) to 1, and
+// sizes in canvas pixels; its omitted counts the oldest keys left out to
+// stay within size. events are the keys first shown by this frame,
+// with count above 1 for a burst of clicks or wheel steps folded into one;
+// omitted counts those left out to stay within size. Returns the length.
+int sceneJsonFormat(char *out, int size, Uint64 frame,
+                    const SceneSnapshot *snapshot, Uint64 now,
+                    const KeyEvent *events, int eventCount);
+
+#endif
@@ -0,0 +1,164 @@
+#include "scene_view.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "scene_clock.h"
+
+bool sceneViewParse(SceneView *view, char *spec) {
+  memset(view, 0, sizeof(*view));
+  view->width = WINDOW_WIDTH;
+  view->height = WINDOW_HEIGHT;
+
+  char *option = spec;
+  while (option) {
+    char *next = strchr(option, ',');
+    if (next) {
+      *next++ = '\0';
+    }
+
+    int width;
+    int height;
+    if (sscanf(option, "%dx%d", &width, &height) == 2 && width > 0 &&
+        height > 0) {
+      view->width = width;
+      view->height = height;
+    } else if (strncmp(option, "scale=", 6) == 0) {
+      view->scale = (float)atof(option + 6);
+    } else if (strcmp(option, "left") == 0) {
+      view->rightAligned = false;
+    } else if (strcmp(option, "right") == 0) {
+      view->rightAligned = true;
+    } else if (strncmp(option, "out=", 4) == 0 && option[4]) {
+      view->outputPath = option + 4;
+#ifndef _WIN32
+    } else if (strncmp(option, "shm=", 4) == 0 && option[4]) {
+      view->shmName = option + 4;
+#endif
+    } else {
+      printf("Unknown view option: %s\n", option);
+      return false;
+    }
+    option = next;
+  }
+  return true;
+}
+
+#ifndef _WIN32
+// Publish each finished view frame to its shared memory ring
+static void publishViewFrame(const SDL_Surface *frame, Uint64 frameIndex,
+                             void *userdata) {
+  shmOutputPublish((ShmOutput *)userdata, frame);
+}
+#endif
+
+bool sceneViewOpen(SceneView *view, SDL_Renderer *renderer, bool coalesce,
+                   Uint32 coalesceWindow, bool coalesceChords, int shmSlots) {
+  if (!sceneLayoutInit(&view->layout, view->width, view->height,
+                       view->scale)) {
+    printf("Could not open the fonts for a %dx%d view.\n", view->width,
+           view->height);
+    return false;
+  }
+  if (!headlessInitTexture(&view->target, renderer, view->width,
+                           view->height, view->outputPath)) {
+    return false;
+  }
+#ifndef _WIN32
+  if (view->shmName) {
+    view->shmOpen = shmOutputOpen(&view->shm, view->shmName, view->width,
+                                  view->height, shmSlots);
+    if (view->shmOpen) {
+      headlessSetFrameCallback(&view->target, publishViewFrame, &view->shm);
+    }
+  }
+#endif
+
+  // The simulation thread is not running yet, so the line can be set up
+  // from here
+  KeyLine *mainLine = keyLine;
+  keyLine = &view->line;
+  clearKeyDisplays();
+  setKeyLineLayout(&view->layout);
+  keyLine->rightAligned = view->rightAligned;
+  keyLine = mainLine;
+
+  view->coalesce = coalesce;
+  keyCoalescerInit(&view->coalescer, coalesceWindow, coalesceChords);
+  snapshotBufferInit(&view->snapshots);
+  view->needsRedraw = true;
+  return true;
+}
+
+void sceneViewClose(SceneView *view) {
+  destroyLineComposite(&view->composite);
+#ifndef _WIN32
+  if (view->shmOpen) {
+    shmOutputClose(&view->shm);
+    view->shmOpen = false;
+  }
+#endif
+  headlessDestroy(&view->target);
+}
+
+void sceneViewFeed(SceneView *view, const KeyEvent *events, int count) {
+  KeyLine *mainLine = keyLine;
+  keyLine = &view->line;
+  for (int i = 0; i < count; i++) {
+    if (view->coalesce) {
+      keyCoalescerFeed(&view->coalescer, &events[i], sceneClockNow());
+    } else {
+      processKeyPresses(events[i].symbol, keyEventCount(&events[i]));
+    }
+  }
+  keyLine = mainLine;
+}
+
+void sceneViewStep(SceneView *view, Uint64 now) {
+  KeyLine *mainLine = keyLine;
+  keyLine = &view->line;
+  if (view->coalesce) {
+    keyCoalescerFlush(&view->coalescer, (Uint32)(now / 1000));
+  }
+
+  SceneSnapshot *snapshot = snapshotBufferBack(&view->snapshots);
+  captureSceneSnapshot(snapshot, now);
+  if (keyLine->version != view->publishedVersion) {
+    view->publishedVersion = keyLine->version;
+    snapshot->sequence = ++view->snapshotSequence;
+    snapshotBufferPublish(&view->snapshots);
+  }
+  keyLine = mainLine;
+}
+
+int sceneViewTimeout(const SceneView *view, Uint32 now) {
+  return view->coalesce ? keyCoalescerTimeout(&view->coalescer, now) : -1;
+}
+
+bool sceneViewRender(SceneView *view, Uint64 now, bool force) {
+  const SceneSnapshot *snapshot = snapshotBufferAcquire(&view->snapshots);
+  if (!force && !view->needsRedraw && !view->lineOnScreen &&
+      snapshot->sequence == view->drawnSequence) {
+    return false;
+  }
+  view->needsRedraw = false;
+  view->drawnSequence = snapshot->sequence;
+
+  headlessBegin(&view->target);
+  view->lineOnScreen = renderKeyLine(view->target.renderer, &view->composite,
+                                     snapshot, now);
+  headlessPresent(&view->target);
+  view->framesRendered++;
+  return view->lineOnScreen;
+}
+
+void sceneViewPrintStats(const SceneView *view, int index) {
+  printf("View %d (%dx%d at %.2fx, %s): %llu frames, %llu from the cached "
+         "composite, %llu re-composed\n",
+         index, view->width, view->height, view->layout.scale,
+         view->rightAligned ? "right" : "left",
+         (unsigned long long)view->framesRendered,
+         (unsigned long long)view->composite.reused,
+         (unsigned long long)view->composite.rebuilt);
+}
@@ -0,0 +1,96 @@
+#ifndef SCENE_VIEW_H
+#define SCENE_VIEW_H
+
+#include <stdbool.h>
+
+#ifdef _WIN32
+#include <SDL.h>
+#else
+#include <SDL2/SDL.h>
+#endif
+
+#include "headless.h"
+#include "key_coalesce.h"
+#include "key_ring.h"
+#include "scene.h"
+#include "shm_output.h"
+#include "snapshot_buffer.h"
+
+#define SCENE_VIEW_MAX 8 // Views besides the window or headless canvas
+
+// Another output of the same keys with its own canvas, scale and alignment,
+// e.g. a right-aligned copy or a small corner version. The simulation thread
+// lays every key out on the view's own line right after the main one and
+// publishes its snapshots; the render thread draws them with the main
+// renderer into a texture that is read back for the view's outputs. Sharing
+// the renderer shares the fonts and the label atlas, so a view costs its
+// layout and its blits, never rasterization the main canvas already did.
+typedef struct {
+  // Options, from sceneViewParse
+  int width;
+  int height;
+  float scale; // 0 = follow the canvas height
+  bool rightAligned;
+  const char *outputPath; // Raw RGBA frames, if any
+  const char *shmName;    // Shared memory frame ring, if any
+
+  // Simulation side
+  KeyLine line;
+  KeyCoalescer coalescer;
+  bool coalesce;
+  SnapshotBuffer snapshots;
+  Uint64 snapshotSequence;
+  unsigned int publishedVersion; // The line's version in the last snapshot
+
+  // Render side
+  SceneLayout layout;
+  LineComposite composite;
+  HeadlessTarget target;
+#ifndef _WIN32
+  ShmOutput shm;
+  bool shmOpen;
+#endif
+  Uint64 drawnSequence;
+  bool lineOnScreen;
+  bool needsRedraw;
+  Uint64 framesRendered;
+} SceneView;
+
+// Fill in a view's options from a comma-separated spec, e.g.
+// "640x120,scale=0.5,right,shm=/keycapper-corner":
+//   WxH       canvas size (default 1280x720)
+//   scale=X   output scale (default: follow the canvas height)
+//   left      line grows from the left margin (default)
+//   right     line grows to the left from the right margin
+//   out=FILE  append every frame to FILE as raw RGBA
+//   shm=NAME  publish every frame to a shared memory ring (not on Windows)
+// Splits spec in place. Returns false for an unknown option.
+bool sceneViewParse(SceneView *view, char *spec);
+
+// Lay the view out and create its target and outputs on renderer, which
+// also draws the main canvas; call before creating the label cache so its
+// atlas can be sized for every view. Coalescing follows the main line.
+// Main thread only.
+bool sceneViewOpen(SceneView *view, SDL_Renderer *renderer, bool coalesce,
+                   Uint32 coalesceWindow, bool coalesceChords, int shmSlots);
+void sceneViewClose(SceneView *view);
+
+// Simulation side: lay a batch of keys out on the view's line
+void sceneViewFeed(SceneView *view, const KeyEvent *events, int count);
+
+// Simulation side: show held-back modifiers that are due and publish a
+// snapshot of the view's line if it changed. now is in scene clock
+// microseconds, as for captureSceneSnapshot.
+void sceneViewStep(SceneView *view, Uint64 now);
+
+// Milliseconds until sceneViewStep has work to do, or -1 if never
+int sceneViewTimeout(const SceneView *view, Uint32 now);
+
+// Render side: draw the view's newest snapshot and hand the frame to its
+// outputs, if it changed, is still fading or force is set. Returns whether
+// any keys are on screen. Call after the frame's labelCacheBeginFrame.
+bool sceneViewRender(SceneView *view, Uint64 now, bool force);
+
+void sceneViewPrintStats(const SceneView *view, int index);
+
+#endif
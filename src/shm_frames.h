@@ -0,0 +1,53 @@
+#ifndef SHM_FRAMES_H
+#define SHM_FRAMES_H
+
+// Layout of the shared-memory frame ring published with --shm-out. This
+// header is shared with tools/shm_reader.c, so it only uses plain C types.
+//
+// The object starts with a ShmFrameHeader, followed by slotCount slots of
+// slotSize bytes. Each slot is a ShmSlotHeader followed by height rows of
+// stride bytes of RGBA8 pixels with premultiplied alpha.
+//
+// Every slot is guarded by a seqlock: the writer makes sequence odd, writes
+// the slot, then makes it even again. A reader takes sequence before and
+// after reading and retries if either value is odd or the two differ.
+
+#include <stdint.h>
+
+#define SHM_FRAMES_MAGIC 0x4B434652u // "KCFR"
+#define SHM_FRAMES_VERSION 1
+#define SHM_FRAMES_DEFAULT_NAME "/keycapper"
+#define SHM_FRAMES_DEFAULT_SLOTS 3
+#define SHM_FRAMES_ALIGN 64
+
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t width;
+  uint32_t height;
+  uint32_t stride;     // Bytes per pixel row
+  uint32_t slotCount;
+  uint64_t slotOffset; // Offset of slot 0 from the start of the object
+  uint64_t slotSize;   // Distance between consecutive slots
+  uint64_t latestFrame; // Frame number of the newest complete frame + 1;
+                        // 0 until the first frame is published
+} ShmFrameHeader;
+
+typedef struct {
+  uint64_t sequence;      // Seqlock counter, odd while the slot is written
+  uint64_t frameNumber;   // Monotonic frame counter; slot = frame % slotCount
+  uint64_t publishTimeNs; // CLOCK_MONOTONIC time the frame was completed
+  uint64_t reserved;
+} ShmSlotHeader;
+
+static inline uint64_t shmFramesSlotSize(uint32_t stride, uint32_t height) {
+  uint64_t size = sizeof(ShmSlotHeader) + (uint64_t)stride * height;
+  return (size + SHM_FRAMES_ALIGN - 1) & ~(uint64_t)(SHM_FRAMES_ALIGN - 1);
+}
+
+static inline uint64_t shmFramesSlotOffset(void) {
+  return (sizeof(ShmFrameHeader) + SHM_FRAMES_ALIGN - 1) &
+         ~(uint64_t)(SHM_FRAMES_ALIGN - 1);
+}
+
+#endif
@@ -0,0 +1,116 @@
+#ifndef _WIN32
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "shm_output.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+static uint64_t monotonicNs(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+}
+
+bool shmOutputOpen(ShmOutput *output, const char *name, int width, int height,
+                   int slotCount) {
+  memset(output, 0, sizeof(*output));
+  output->fd = -1;
+  snprintf(output->name, sizeof(output->name), "%s", name);
+
+  uint32_t stride = (uint32_t)width * 4;
+  uint64_t slotSize = shmFramesSlotSize(stride, (uint32_t)height);
+  output->size = (size_t)(shmFramesSlotOffset() + slotSize * slotCount);
+
+  // Start from a fresh object so stale readers never see a resized layout
+  shm_unlink(name);
+  output->fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (output->fd < 0) {
+    printf("Failed to create shared memory %s\n", name);
+    return false;
+  }
+  if (ftruncate(output->fd, (off_t)output->size) < 0) {
+    printf("Failed to size shared memory %s\n", name);
+    shmOutputClose(output);
+    return false;
+  }
+
+  void *base = mmap(NULL, output->size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                    output->fd, 0);
+  if (base == MAP_FAILED) {
+    printf("Failed to map shared memory %s\n", name);
+    shmOutputClose(output);
+    return false;
+  }
+  output->base = base;
+
+  ShmFrameHeader *header = (ShmFrameHeader *)output->base;
+  header->width = (uint32_t)width;
+  header->height = (uint32_t)height;
+  header->stride = stride;
+  header->slotCount = (uint32_t)slotCount;
+  header->slotOffset = shmFramesSlotOffset();
+  header->slotSize = slotSize;
+  header->latestFrame = 0;
+  header->version = SHM_FRAMES_VERSION;
+
+  // Readers check the magic last, once the rest of the header is valid
+  __atomic_store_n(&header->magic, SHM_FRAMES_MAGIC, __ATOMIC_RELEASE);
+  output->header = header;
+
+  printf("Publishing frames to shared memory %s (%d slots of %dx%d)\n", name,
+         slotCount, width, height);
+  return true;
+}
+
+void shmOutputPublish(ShmOutput *output, const SDL_Surface *frame) {
+  ShmFrameHeader *header = output->header;
+  if (!header || (uint32_t)frame->w != header->width ||
+      (uint32_t)frame->h != header->height) {
+    return;
+  }
+
+  uint64_t frameNumber = output->framesPublished;
+  unsigned char *slot = output->base + header->slotOffset +
+                        header->slotSize * (frameNumber % header->slotCount);
+  ShmSlotHeader *slotHeader = (ShmSlotHeader *)slot;
+  unsigned char *pixels = slot + sizeof(ShmSlotHeader);
+
+  // Enter the write side of the seqlock
+  uint64_t sequence = __atomic_load_n(&slotHeader->sequence, __ATOMIC_RELAXED);
+  __atomic_store_n(&slotHeader->sequence, sequence + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+
+  for (int y = 0; y < frame->h; y++) {
+    memcpy(pixels + (size_t)y * header->stride,
+           (const unsigned char *)frame->pixels + (size_t)y * frame->pitch,
+           header->stride);
+  }
+  slotHeader->frameNumber = frameNumber;
+  slotHeader->publishTimeNs = monotonicNs();
+
+  // Leave the seqlock, then advertise the frame as the newest one
+  __atomic_store_n(&slotHeader->sequence, sequence + 2, __ATOMIC_RELEASE);
+  __atomic_store_n(&header->latestFrame, frameNumber + 1, __ATOMIC_RELEASE);
+  output->framesPublished++;
+}
+
+void shmOutputClose(ShmOutput *output) {
+  if (output->base) {
+    munmap(output->base, output->size);
+    output->base = NULL;
+    output->header = NULL;
+  }
+  if (output->fd >= 0) {
+    close(output->fd);
+    output->fd = -1;
+    shm_unlink(output->name);
+  }
+}
+
+#endif
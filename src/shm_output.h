@@ -0,0 +1,36 @@
+#ifndef SHM_OUTPUT_H
+#define SHM_OUTPUT_H
+
+#ifndef _WIN32
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <SDL2/SDL.h>
+
+#include "shm_frames.h"
+
+// Writer side of the shared-memory frame ring described in shm_frames.h
+typedef struct {
+  char name[64];
+  int fd;
+  unsigned char *base;
+  size_t size;
+  ShmFrameHeader *header;
+  uint64_t framesPublished;
+} ShmOutput;
+
+// Create (or replace) the POSIX shared memory object name, sized for
+// width x height frames in slotCount slots
+bool shmOutputOpen(ShmOutput *output, const char *name, int width, int height,
+                   int slotCount);
+
+// Copy a finished RGBA32 frame into the next slot and publish it
+void shmOutputPublish(ShmOutput *output, const SDL_Surface *frame);
+
+// Unmap and unlink the shared memory object
+void shmOutputClose(ShmOutput *output);
+
+#endif
+
+#endif
@@ -0,0 +1,63 @@
+#include "snapshot_buffer.h"
+
+#include <string.h>
+
+#define SLOT_MASK 3
+#define SLOT_UNREAD 4 // Set on latest until the consumer takes it
+
+void snapshotBufferInit(SnapshotBuffer *buffer) {
+  memset(buffer, 0, sizeof(*buffer));
+  buffer->front = 0;
+  buffer->back = 2;
+  SDL_AtomicSet(&buffer->latest, 1);
+  SDL_AtomicSet(&buffer->waiting, 0);
+}
+
+SceneSnapshot *snapshotBufferBack(SnapshotBuffer *buffer) {
+  return &buffer->slots[buffer->back];
+}
+
+void snapshotBufferPublish(SnapshotBuffer *buffer) {
+  // Publish the slot contents before the slot index becomes visible
+  SDL_MemoryBarrierRelease();
+  int previous = SDL_AtomicSet(&buffer->latest, buffer->back | SLOT_UNREAD);
+  buffer->back = previous & SLOT_MASK;
+
+  // Only pay for a wakeup when the consumer is actually going to sleep
+  if (SDL_AtomicGet(&buffer->waiting) &&
+      SDL_AtomicCAS(&buffer->waiting, 1, 0) && buffer->wake) {
+    buffer->wake(buffer->wakeUserdata);
+  }
+}
+
+const SceneSnapshot *snapshotBufferAcquire(SnapshotBuffer *buffer) {
+  if (SDL_AtomicGet(&buffer->latest) & SLOT_UNREAD) {
+    // Swap our old slot for the newest one in a single exchange
+    int latest = SDL_AtomicSet(&buffer->latest, buffer->front);
+    SDL_MemoryBarrierAcquire();
+    buffer->front = latest & SLOT_MASK;
+  }
+  return &buffer->slots[buffer->front];
+}
+
+void snapshotBufferSetWake(SnapshotBuffer *buffer, SnapshotWakeFn wake,
+                           void *userdata) {
+  buffer->wake = wake;
+  buffer->wakeUserdata = userdata;
+}
+
+bool snapshotBufferPrepareWait(SnapshotBuffer *buffer) {
+  SDL_AtomicSet(&buffer->waiting, 1);
+
+  // Re-check after publishing the flag: either we see the unread snapshot
+  // here, or the producer sees the flag and calls wake
+  if (SDL_AtomicGet(&buffer->latest) & SLOT_UNREAD) {
+    SDL_AtomicSet(&buffer->waiting, 0);
+    return false;
+  }
+  return true;
+}
+
+void snapshotBufferCancelWait(SnapshotBuffer *buffer) {
+  SDL_AtomicSet(&buffer->waiting, 0);
+}
@@ -0,0 +1,58 @@
+#ifndef SNAPSHOT_BUFFER_H
+#define SNAPSHOT_BUFFER_H
+
+#include <stdbool.h>
+
+#ifdef _WIN32
+#include <SDL.h>
+#else
+#include <SDL2/SDL.h>
+#endif
+
+#include "key_ring.h"
+#include "scene.h"
+
+// Called from the producer thread when the consumer asked to be woken
+typedef void (*SnapshotWakeFn)(void *userdata);
+
+// Lock-free triple buffer of scene snapshots. One thread fills the back
+// slot and publishes it; another always picks up the newest published one.
+// Neither side ever blocks, and publishing faster than the consumer reads
+// simply replaces the unread snapshot.
+typedef struct {
+  SceneSnapshot slots[3];
+  SDL_atomic_t latest; // Newest published slot, plus a flag while unread
+  char padLatest[KEY_RING_PAD - sizeof(SDL_atomic_t)];
+  SDL_atomic_t waiting; // Set while the consumer is about to sleep
+  int back;  // Producer's slot
+  int front; // Consumer's slot
+  SnapshotWakeFn wake;
+  void *wakeUserdata;
+} SnapshotBuffer;
+
+void snapshotBufferInit(SnapshotBuffer *buffer);
+
+// Producer side: the slot to fill in before publishing
+SceneSnapshot *snapshotBufferBack(SnapshotBuffer *buffer);
+
+// Producer side: make the back slot the newest snapshot, replacing the
+// previous one if the consumer never picked it up
+void snapshotBufferPublish(SnapshotBuffer *buffer);
+
+// Consumer side: the newest published snapshot, which stays valid (and
+// unchanged) until the next call
+const SceneSnapshot *snapshotBufferAcquire(SnapshotBuffer *buffer);
+
+// Install the function the producer uses to wake a sleeping consumer
+void snapshotBufferSetWake(SnapshotBuffer *buffer, SnapshotWakeFn wake,
+                           void *userdata);
+
+// Consumer side: announce an upcoming sleep. Returns false (and cancels the
+// announcement) if an unread snapshot is already waiting; otherwise the next
+// publish calls the wake function exactly once.
+bool snapshotBufferPrepareWait(SnapshotBuffer *buffer);
+
+// Consumer side: withdraw the announcement after waking for any reason
+void snapshotBufferCancelWait(SnapshotBuffer *buffer);
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef USAGE_FILE_H
+#define USAGE_FILE_H
+
+// Layout of the usage statistics file kept with --usage-stats. It only uses
+// plain C types so other tools can include it, map the file read-only and
+// read the counters live while keycapper updates them; there is nothing to
+// lock or ask for. The file is one UsageFile in host byte order, created
+// zeroed and then only ever updated in place.
+//
+// Every counter is a naturally aligned 64-bit (or 32-bit) value written by
+// a single thread, so a reader never sees one torn; related counters may
+// be a key apart. Auto-repeats and mouse buttons are counted per key but
+// left out of the key totals, keys per minute and the per-second window.
+
+#include <stdint.h>
+
+#define USAGE_FILE_MAGIC 0x5355434Bu // "KCUS"
+#define USAGE_FILE_VERSION 1
+#define USAGE_FILE_KEYS 256 // Key slots, indexed by KeySymbol id
+#define USAGE_FILE_MODIFIERS 5 // Modifier bits in a chord mask, see below
+#define USAGE_FILE_CHORD_MASKS (1 << USAGE_FILE_MODIFIERS)
+#define USAGE_FILE_SECONDS 3600 // Per-second window: the last hour
+#define USAGE_FILE_KPM_BUCKETS 512
+#define USAGE_FILE_KPM_WIDTH 4 // Keys per minute per bucket; the last
+                               // bucket also holds everything above
+
+// Chord mask bits, in the order modifiers are written in a chord's label
+#define USAGE_MOD_CTRL 0x01
+#define USAGE_MOD_ALT 0x02
+#define USAGE_MOD_SHIFT 0x04
+#define USAGE_MOD_SUPER 0x08
+#define USAGE_MOD_FN 0x10
+
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t keySlots;    // USAGE_FILE_KEYS
+  uint32_t secondSlots; // USAGE_FILE_SECONDS
+
+  // Sessions (one per keycapper run), times in Unix seconds
+  uint64_t createdTime;
+  uint64_t sessionCount;
+  uint64_t sessionStart;
+  uint64_t sessionKeys;
+
+  // Totals over every session
+  uint64_t totalKeys;    // Key presses, without auto-repeat
+  uint64_t totalRepeats; // Auto-repeats
+  uint64_t totalMouse;   // Mouse button presses and wheel steps
+  uint64_t totalChords;  // Presses with modifiers just before them
+
+  // Keys per minute: every minute with at least one key press is added to
+  // kpm[] once the next key press falls in a later minute
+  uint64_t activeMinutes;
+  uint64_t currentMinute; // Unix minute being counted
+  uint64_t currentMinuteKeys;
+  uint64_t reserved[5];
+
+  uint64_t keys[USAGE_FILE_KEYS];    // Presses per key, the heatmap
+  uint64_t repeats[USAGE_FILE_KEYS]; // Auto-repeats per key
+  // Presses per modifier mask and key; chords[0] is unused
+  uint64_t chords[USAGE_FILE_CHORD_MASKS][USAGE_FILE_KEYS];
+  uint64_t kpm[USAGE_FILE_KPM_BUCKETS]; // Active minutes per KPM bucket
+
+  // Rolling per-second key presses: slot t % USAGE_FILE_SECONDS counts Unix
+  // second t if secondTimes[slot] == (uint32_t)t, otherwise it is stale
+  uint32_t secondTimes[USAGE_FILE_SECONDS];
+  uint32_t seconds[USAGE_FILE_SECONDS];
+} UsageFile;
+
+#endif
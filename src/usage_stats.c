@@ -0,0 +1,378 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "usage_stats.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "keysyms.h"
+
+#define DUMP_TOP_KEYS 15
+#define DUMP_TOP_CHORDS 10
+
+// Map the file read-write at sizeof(UsageFile), growing a new (empty) file
+// to that size. Returns NULL if it cannot, or if an existing file has
+// another size.
+static UsageFile *mapFile(UsageStats *stats, const char *path) {
+  size_t size = sizeof(UsageFile);
+#ifdef _WIN32
+  HANDLE file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE,
+                            FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                            OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE) {
+    return NULL;
+  }
+  // Mapping a larger size than the file extends it with zeros
+  HANDLE mapping =
+      CreateFileMappingA(file, NULL, PAGE_READWRITE, 0, (DWORD)size, NULL);
+  void *data =
+      mapping ? MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size) : NULL;
+  if (!data) {
+    if (mapping) {
+      CloseHandle(mapping);
+    }
+    CloseHandle(file);
+    return NULL;
+  }
+  stats->fileHandle = file;
+  stats->mappingHandle = mapping;
+#else
+  int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    return NULL;
+  }
+  struct stat info;
+  if (fstat(fd, &info) < 0 ||
+      (info.st_size == 0 && ftruncate(fd, (off_t)size) < 0) ||
+      (info.st_size != 0 && (size_t)info.st_size != size)) {
+    close(fd);
+    return NULL;
+  }
+  void *data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    return NULL;
+  }
+#endif
+  stats->size = size;
+  return (UsageFile *)data;
+}
+
+static void unmapFile(UsageStats *stats) {
+#ifdef _WIN32
+  FlushViewOfFile(stats->file, stats->size);
+  UnmapViewOfFile(stats->file);
+  CloseHandle(stats->mappingHandle);
+  CloseHandle(stats->fileHandle);
+#else
+  msync(stats->file, stats->size, MS_SYNC);
+  munmap(stats->file, stats->size);
+#endif
+  stats->file = NULL;
+}
+
+bool usageStatsOpen(UsageStats *stats, const char *path,
+                    Uint32 chordWindowMs) {
+  memset(stats, 0, sizeof(*stats));
+  stats->path = path;
+  stats->chordWindowMs = chordWindowMs;
+
+  UsageFile *file = mapFile(stats, path);
+  if (!file) {
+    printf("Failed to open usage statistics file %s\n", path);
+    return false;
+  }
+  stats->file = file;
+
+  Uint64 now = (Uint64)time(NULL);
+  if (file->magic == 0) {
+    // A new file: every counter starts at zero
+    file->magic = USAGE_FILE_MAGIC;
+    file->version = USAGE_FILE_VERSION;
+    file->keySlots = USAGE_FILE_KEYS;
+    file->secondSlots = USAGE_FILE_SECONDS;
+    file->createdTime = now;
+  } else if (file->magic != USAGE_FILE_MAGIC ||
+             file->version != USAGE_FILE_VERSION ||
+             file->keySlots != USAGE_FILE_KEYS ||
+             file->secondSlots != USAGE_FILE_SECONDS) {
+    printf("%s is not a keycapper usage statistics file\n", path);
+    unmapFile(stats);
+    return false;
+  }
+
+  file->sessionCount++;
+  file->sessionStart = now;
+  file->sessionKeys = 0;
+  stats->baseUnixMs = now * 1000;
+  stats->baseTicks = SDL_GetTicks();
+  return true;
+}
+
+// Chord mask bit for a modifier, or 0 for other keys
+static unsigned int modifierBit(KeySymbol symbol) {
+  switch (symbol) {
+  case KSYM_CTRL:
+    return USAGE_MOD_CTRL;
+  case KSYM_ALT:
+    return USAGE_MOD_ALT;
+  case KSYM_SHIFT:
+    return USAGE_MOD_SHIFT;
+  case KSYM_SUPER:
+    return USAGE_MOD_SUPER;
+  case KSYM_FN:
+    return USAGE_MOD_FN;
+  default:
+    return 0;
+  }
+}
+
+// Add a finished minute to the keys-per-minute histogram
+static void closeMinute(UsageFile *file) {
+  if (file->currentMinuteKeys == 0) {
+    return;
+  }
+  Uint64 bucket = file->currentMinuteKeys / USAGE_FILE_KPM_WIDTH;
+  if (bucket >= USAGE_FILE_KPM_BUCKETS) {
+    bucket = USAGE_FILE_KPM_BUCKETS - 1;
+  }
+  file->kpm[bucket]++;
+  file->activeMinutes++;
+  file->currentMinuteKeys = 0;
+}
+
+void usageStatsRecord(UsageStats *stats, const KeyEvent *event) {
+  UsageFile *file = stats->file;
+  KeySymbol symbol = event->symbol;
+  if (!file || (unsigned int)symbol >= USAGE_FILE_KEYS) {
+    return;
+  }
+  int count = keyEventCount(event);
+
+  if (event->flags & KEY_EVENT_REPEAT) {
+    file->repeats[symbol] += count;
+    file->totalRepeats += count;
+    return;
+  }
+  file->keys[symbol] += count;
+  if (keySymbolIsMouse(symbol)) {
+    file->totalMouse += count;
+    return;
+  }
+
+  // Modifiers arm a chord for the key that follows them within the window
+  Uint32 sinceModifier = event->timestamp - stats->chordTime;
+  unsigned int bit = modifierBit(symbol);
+  if (bit) {
+    if (sinceModifier > stats->chordWindowMs) {
+      stats->chordMask = 0;
+    }
+    stats->chordMask |= bit;
+    stats->chordTime = event->timestamp;
+  } else if (stats->chordMask) {
+    if (sinceModifier <= stats->chordWindowMs) {
+      file->chords[stats->chordMask][symbol] += count;
+      file->totalChords += count;
+    }
+    stats->chordMask = 0;
+  }
+
+  file->totalKeys += count;
+  file->sessionKeys += count;
+
+  Uint64 unixMs = stats->baseUnixMs + (event->timestamp - stats->baseTicks);
+  Uint64 second = unixMs / 1000;
+  Uint64 minute = second / 60;
+  if (minute != file->currentMinute) {
+    closeMinute(file);
+    file->currentMinute = minute;
+  }
+  file->currentMinuteKeys += count;
+
+  int slot = (int)(second % USAGE_FILE_SECONDS);
+  if (file->secondTimes[slot] != (uint32_t)second) {
+    file->seconds[slot] = 0;
+    file->secondTimes[slot] = (uint32_t)second;
+  }
+  file->seconds[slot] += count;
+}
+
+void usageStatsClose(UsageStats *stats) {
+  if (stats->file) {
+    printf("Usage statistics: %llu keys this session, %llu in total, in "
+           "%s\n",
+           (unsigned long long)stats->file->sessionKeys,
+           (unsigned long long)stats->file->totalKeys, stats->path);
+    unmapFile(stats);
+  }
+}
+
+// Keys per minute below which fraction of the active minutes fall, to
+// within a histogram bucket
+static int kpmPercentile(const UsageFile *file, double fraction) {
+  Uint64 target = (Uint64)(fraction * file->activeMinutes);
+  Uint64 seen = 0;
+  for (int i = 0; i < USAGE_FILE_KPM_BUCKETS; i++) {
+    seen += file->kpm[i];
+    if (seen > target) {
+      return i * USAGE_FILE_KPM_WIDTH + USAGE_FILE_KPM_WIDTH / 2;
+    }
+  }
+  return 0;
+}
+
+// Write a chord such as "Ctrl+Shift+z" into label
+static void formatChord(char *label, size_t size, unsigned int mask,
+                        KeySymbol symbol) {
+  static const KeySymbol modifiers[USAGE_FILE_MODIFIERS] = {
+      KSYM_CTRL, KSYM_ALT, KSYM_SHIFT, KSYM_SUPER, KSYM_FN};
+  size_t length = 0;
+  label[0] = '\0';
+  for (int i = 0; i < USAGE_FILE_MODIFIERS && length < size; i++) {
+    if (mask & (1u << i)) {
+      length += snprintf(label + length, size - length, "%s+",
+                         keySymbolLabel(modifiers[i]));
+    }
+  }
+  if (length < size) {
+    snprintf(label + length, size - length, "%s", keySymbolLabel(symbol));
+  }
+}
+
+static void printTime(const char *what, Uint64 unixSeconds) {
+  time_t seconds = (time_t)unixSeconds;
+  struct tm *local = localtime(&seconds);
+  char text[32] = "?";
+  if (local) {
+    strftime(text, sizeof(text), "%Y-%m-%d %H:%M", local);
+  }
+  printf("%s %s\n", what, text);
+}
+
+bool usageStatsDump(const char *path) {
+  // Work from a copy; keys counted while it is printed show up next time
+  size_t size = 0;
+  UsageFile *file = (UsageFile *)SDL_LoadFile(path, &size);
+  if (!file) {
+    printf("Failed to open usage statistics file %s\n", path);
+    return false;
+  }
+  if (size != sizeof(UsageFile) || file->magic != USAGE_FILE_MAGIC ||
+      file->version != USAGE_FILE_VERSION) {
+    printf("%s is not a keycapper usage statistics file\n", path);
+    SDL_free(file);
+    return false;
+  }
+
+  printf("Usage statistics in %s\n", path);
+  printTime("First session:", file->createdTime);
+  printTime("Latest session:", file->sessionStart);
+  printf("Sessions: %llu\n", (unsigned long long)file->sessionCount);
+  printf("Keys: %llu in total, %llu in the latest session (plus %llu "
+         "auto-repeats, %llu mouse buttons and wheel steps)\n",
+         (unsigned long long)file->totalKeys,
+         (unsigned long long)file->sessionKeys,
+         (unsigned long long)file->totalRepeats,
+         (unsigned long long)file->totalMouse);
+
+  // Every minute but the one still being counted
+  if (file->activeMinutes > 0) {
+    printf("Keys per minute over %llu active minutes: p50 %d, p90 %d, p99 "
+           "%d\n",
+           (unsigned long long)file->activeMinutes, kpmPercentile(file, 0.5),
+           kpmPercentile(file, 0.9), kpmPercentile(file, 0.99));
+  }
+
+  // The per-second window, relative to its newest second
+  uint32_t newest = 0;
+  for (int i = 0; i < USAGE_FILE_SECONDS; i++) {
+    if (file->seconds[i] > 0 && file->secondTimes[i] > newest) {
+      newest = file->secondTimes[i];
+    }
+  }
+  Uint64 lastMinute = 0;
+  uint32_t busiest = 0;
+  for (int i = 0; i < USAGE_FILE_SECONDS; i++) {
+    uint32_t age = newest - file->secondTimes[i];
+    if (file->seconds[i] == 0 || age >= USAGE_FILE_SECONDS) {
+      continue;
+    }
+    if (age < 60) {
+      lastMinute += file->seconds[i];
+    }
+    if (file->seconds[i] > busiest) {
+      busiest = file->seconds[i];
+    }
+  }
+  if (newest > 0) {
+    printTime("Last key:", newest);
+    printf("Keys in the minute before it: %llu; busiest second in the hour "
+           "before it: %u\n",
+           (unsigned long long)lastMinute, busiest);
+  }
+
+  // Top keys, by picking the largest remaining count each time
+  bool taken[USAGE_FILE_KEYS] = {false};
+  printf("Top keys:\n");
+  for (int rank = 1; rank <= DUMP_TOP_KEYS; rank++) {
+    int best = -1;
+    for (int i = 0; i < USAGE_FILE_KEYS; i++) {
+      if (!taken[i] && file->keys[i] > 0 &&
+          (best < 0 || file->keys[i] > file->keys[best])) {
+        best = i;
+      }
+    }
+    if (best < 0) {
+      break;
+    }
+    taken[best] = true;
+    Uint64 total = file->totalKeys + file->totalMouse;
+    printf("  %2d. %-12s %10llu  %5.1f%%\n", rank,
+           best < KSYM_COUNT ? keySymbolLabel((KeySymbol)best) : "?",
+           (unsigned long long)file->keys[best],
+           total > 0 ? 100.0 * file->keys[best] / total : 0.0);
+  }
+
+  printf("Top chords (%llu in total):\n",
+         (unsigned long long)file->totalChords);
+  static bool chordTaken[USAGE_FILE_CHORD_MASKS][USAGE_FILE_KEYS];
+  memset(chordTaken, 0, sizeof(chordTaken));
+  for (int rank = 1; rank <= DUMP_TOP_CHORDS; rank++) {
+    int bestMask = 0;
+    int bestKey = 0;
+    Uint64 bestCount = 0;
+    for (int mask = 1; mask < USAGE_FILE_CHORD_MASKS; mask++) {
+      for (int key = 0; key < KSYM_COUNT && key < USAGE_FILE_KEYS; key++) {
+        if (!chordTaken[mask][key] && file->chords[mask][key] > bestCount) {
+          bestMask = mask;
+          bestKey = key;
+          bestCount = file->chords[mask][key];
+        }
+      }
+    }
+    if (bestCount == 0) {
+      break;
+    }
+    chordTaken[bestMask][bestKey] = true;
+    char label[64];
+    formatChord(label, sizeof(label), (unsigned int)bestMask,
+                (KeySymbol)bestKey);
+    printf("  %2d. %-20s %10llu\n", rank, label,
+           (unsigned long long)bestCount);
+  }
+
+  SDL_free(file);
+  return true;
+}
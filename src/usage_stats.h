@@ -0,0 +1,57 @@
+#ifndef USAGE_STATS_H
+#define USAGE_STATS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef _WIN32
+#include <SDL.h>
+#else
+#include <SDL2/SDL.h>
+#endif
+
+#include "key_ring.h"
+#include "usage_file.h"
+
+// Per-key usage statistics that outlive the key line: key counts for a
+// heatmap, chord counts, keys per minute and a per-second window, kept in a
+// memory-mapped UsageFile (see usage_file.h) so they survive restarts and
+// other programs can read them while keycapper runs. Recording a key is a
+// few counter bumps in the mapping, with no allocation or system call.
+typedef struct {
+  UsageFile *file; // The mapping
+  size_t size;
+#ifdef _WIN32
+  void *fileHandle;
+  void *mappingHandle;
+#endif
+  const char *path;
+
+  // Wall clock at open, to turn key timestamps into Unix time
+  Uint64 baseUnixMs;
+  Uint32 baseTicks;
+
+  // Modifiers pressed recently enough to make the next key a chord
+  Uint32 chordWindowMs;
+  unsigned int chordMask;
+  Uint32 chordTime;
+} UsageStats;
+
+// Map path, creating it if needed, and start a new session in it. Refuses
+// files that are not usage statistics rather than overwriting them.
+// Modifiers followed by a key within chordWindowMs count as a chord.
+bool usageStatsOpen(UsageStats *stats, const char *path,
+                    Uint32 chordWindowMs);
+
+// Count one captured key. Only the thread that lays keys out may call it.
+void usageStatsRecord(UsageStats *stats, const KeyEvent *event);
+
+// Write the counters back to the file and unmap it
+void usageStatsClose(UsageStats *stats);
+
+// Print top keys, keys-per-minute percentiles, chord frequencies and
+// session totals from a usage statistics file. Works while another keycapper
+// is updating it.
+bool usageStatsDump(const char *path);
+
+#endif
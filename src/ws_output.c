@@ -0,0 +1,730 @@
+#ifndef _WIN32
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "ws_output.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <SDL2/SDL.h>
+
+#define WS_MAX_CLIENTS 64
+#define WS_OUTBOX_SLOTS 8 // Messages in flight to the thread; power of two
+#define WS_CLIENT_QUEUE (64 * 1024) // Bytes queued for one client
+#define WS_INPUT_MAX 4096 // Handshake request, or one frame from a client
+#define WS_FRAME_HEADER_MAX 10
+#define WS_GUID "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+
+#ifdef MSG_NOSIGNAL
+#define SEND_FLAGS MSG_NOSIGNAL
+#else
+#define SEND_FLAGS 0 // SO_NOSIGPIPE is set on each socket instead
+#endif
+
+typedef enum { WS_HANDSHAKE, WS_OPEN, WS_CLOSING } WsClientState;
+
+// A request header that is absent is not the same as one that is there but
+// cannot be read: an unreadable Origin must not pass for no Origin
+typedef enum { HEADER_MISSING, HEADER_FOUND, HEADER_INVALID } HeaderStatus;
+
+typedef struct {
+  int fd;
+  int id; // Client number, for messages
+  WsClientState state;
+  char input[WS_INPUT_MAX + 1];
+  size_t inputLength;
+  unsigned char *queue; // Bytes [queueStart, queueEnd) are still to be sent
+  size_t queueStart;
+  size_t queueEnd;
+  bool resync; // Missed the newest message
+
+  Uint64 sent;    // Messages queued
+  Uint64 dropped; // Messages skipped because the queue was full
+} WsClient;
+
+typedef struct {
+  int length;
+  char text[WS_MESSAGE_MAX];
+} WsMessage;
+
+typedef struct {
+  Uint64 clients;
+  Uint64 refused;   // Bad handshakes and foreign origins
+  Uint64 published; // Messages handed over by the render thread
+  Uint64 sent;
+  Uint64 dropped;
+  Uint64 bytes;
+} WsOutputTotals;
+
+// Single-producer/single-consumer handoff from the render thread
+static WsMessage outbox[WS_OUTBOX_SLOTS];
+static SDL_atomic_t outboxHead;
+static SDL_atomic_t outboxTail;
+static SDL_atomic_t outboxDrops;
+static SDL_atomic_t stopping;
+
+// The newest message as a frame, for clients that missed it
+static unsigned char lastFrame[WS_FRAME_HEADER_MAX + WS_MESSAGE_MAX];
+static size_t lastFrameLength = 0;
+
+static WsClient clients[WS_MAX_CLIENTS];
+static int listenFd = -1;
+static int wakePipe[2] = {-1, -1};
+static char allowed[256];
+static pthread_t serverThread;
+static bool threadRunning = false;
+static WsOutputTotals totals;
+static int nextClientId = 1;
+
+static Uint32 rotateLeft(Uint32 value, int bits) {
+  return value << bits | value >> (32 - bits);
+}
+
+// SHA-1, only ever used for the handshake's accept key
+static void sha1(const unsigned char *data, size_t length,
+                 unsigned char digest[20]) {
+  Uint32 h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+  size_t padded = (length + 8) / 64 * 64 + 64;
+  for (size_t block = 0; block < padded; block += 64) {
+    Uint32 w[80];
+    for (int i = 0; i < 64; i++) {
+      size_t at = block + i;
+      Uint32 byte = 0;
+      if (at < length) {
+        byte = data[at];
+      } else if (at == length) {
+        byte = 0x80;
+      } else if (at >= padded - 8) {
+        byte = (Uint32)(((Uint64)length * 8) >> (8 * (padded - 1 - at))) &
+               0xFF;
+      }
+      if (i % 4 == 0) {
+        w[i / 4] = 0;
+      }
+      w[i / 4] |= byte << (8 * (3 - i % 4));
+    }
+    for (int i = 16; i < 80; i++) {
+      w[i] = rotateLeft(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+    }
+
+    Uint32 a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+    for (int i = 0; i < 80; i++) {
+      Uint32 f, k;
+      if (i < 20) {
+        f = (b & c) | (~b & d);
+        k = 0x5A827999;
+      } else if (i < 40) {
+        f = b ^ c ^ d;
+        k = 0x6ED9EBA1;
+      } else if (i < 60) {
+        f = (b & c) | (b & d) | (c & d);
+        k = 0x8F1BBCDC;
+      } else {
+        f = b ^ c ^ d;
+        k = 0xCA62C1D6;
+      }
+      Uint32 t = rotateLeft(a, 5) + f + e + k + w[i];
+      e = d;
+      d = c;
+      c = rotateLeft(b, 30);
+      b = a;
+      a = t;
+    }
+    h[0] += a;
+    h[1] += b;
+    h[2] += c;
+    h[3] += d;
+    h[4] += e;
+  }
+  for (int i = 0; i < 20; i++) {
+    digest[i] = (unsigned char)(h[i / 4] >> (8 * (3 - i % 4)));
+  }
+}
+
+static void base64(const unsigned char *data, size_t length, char *out) {
+  static const char alphabet[] =
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  for (size_t i = 0; i < length; i += 3) {
+    Uint32 group = (Uint32)data[i] << 16;
+    if (i + 1 < length) {
+      group |= (Uint32)data[i + 1] << 8;
+    }
+    if (i + 2 < length) {
+      group |= data[i + 2];
+    }
+    *out++ = alphabet[group >> 18 & 63];
+    *out++ = alphabet[group >> 12 & 63];
+    *out++ = i + 1 < length ? alphabet[group >> 6 & 63] : '=';
+    *out++ = i + 2 < length ? alphabet[group & 63] : '=';
+  }
+  *out = '\0';
+}
+
+// Write a server frame header (never masked) and return its length
+static size_t frameHeader(unsigned char *header, int opcode, size_t length) {
+  header[0] = (unsigned char)(0x80 | opcode);
+  if (length < 126) {
+    header[1] = (unsigned char)length;
+    return 2;
+  }
+  if (length < 65536) {
+    header[1] = 126;
+    header[2] = (unsigned char)(length >> 8);
+    header[3] = (unsigned char)length;
+    return 4;
+  }
+  header[1] = 127;
+  for (int i = 0; i < 8; i++) {
+    header[2 + i] = (unsigned char)((Uint64)length >> (8 * (7 - i)));
+  }
+  return 10;
+}
+
+static bool setNonBlocking(int fd) {
+  int flags = fcntl(fd, F_GETFL, 0);
+  return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+static void closeClient(WsClient *client) {
+  if (client->state != WS_HANDSHAKE) {
+    printf("WebSocket client %d closed: %llu messages sent, %llu dropped\n",
+           client->id, (unsigned long long)client->sent,
+           (unsigned long long)client->dropped);
+  }
+  close(client->fd);
+  free(client->queue);
+  client->queue = NULL;
+  client->fd = -1;
+}
+
+// Queue bytes for a client. Returns false, queueing nothing, if they do not
+// fit.
+static bool enqueue(WsClient *client, const void *data, size_t length) {
+  if (client->queueEnd + length > WS_CLIENT_QUEUE &&
+      client->queueStart > 0) {
+    memmove(client->queue, client->queue + client->queueStart,
+            client->queueEnd - client->queueStart);
+    client->queueEnd -= client->queueStart;
+    client->queueStart = 0;
+  }
+  if (client->queueEnd + length > WS_CLIENT_QUEUE) {
+    return false;
+  }
+  memcpy(client->queue + client->queueEnd, data, length);
+  client->queueEnd += length;
+  return true;
+}
+
+// Send queued bytes until the socket would block
+static void flushClient(WsClient *client) {
+  while (client->queueStart < client->queueEnd) {
+    ssize_t bytes = send(client->fd, client->queue + client->queueStart,
+                         client->queueEnd - client->queueStart, SEND_FLAGS);
+    if (bytes < 0 && errno == EINTR) {
+      continue;
+    }
+    if (bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      return;
+    }
+    if (bytes <= 0) {
+      closeClient(client);
+      return;
+    }
+    client->queueStart += (size_t)bytes;
+    totals.bytes += (Uint64)bytes;
+  }
+  client->queueStart = client->queueEnd = 0;
+  if (client->state == WS_CLOSING) {
+    closeClient(client);
+  }
+}
+
+// Queue the newest message. Returns false if the client has no room for it.
+static bool sendLastFrame(WsClient *client) {
+  if (!enqueue(client, lastFrame, lastFrameLength)) {
+    return false;
+  }
+  client->resync = false;
+  client->sent++;
+  totals.sent++;
+  return true;
+}
+
+static void acceptClients(void) {
+  for (;;) {
+    int fd = accept(listenFd, NULL, NULL);
+    if (fd < 0) {
+      return;
+    }
+    WsClient *client = NULL;
+    for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+      if (clients[i].fd < 0) {
+        client = &clients[i];
+        break;
+      }
+    }
+    if (!client || !setNonBlocking(fd)) {
+      printf("WebSocket client refused: %d clients already connected\n",
+             WS_MAX_CLIENTS);
+      close(fd);
+      continue;
+    }
+#ifdef SO_NOSIGPIPE
+    int noSignal = 1;
+    setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &noSignal, sizeof(noSignal));
+#endif
+    unsigned char *queue = malloc(WS_CLIENT_QUEUE);
+    if (!queue) {
+      close(fd);
+      continue;
+    }
+
+    memset(client, 0, sizeof(*client));
+    client->fd = fd;
+    client->id = nextClientId++;
+    client->state = WS_HANDSHAKE;
+    client->queue = queue;
+  }
+}
+
+// Pages on this machine, or the origin given with --ws-origin. The opaque
+// origin "null" is only let in when given that way: browsers send it for
+// file:// pages, but also for any site's sandboxed iframes.
+static bool originAllowed(const char *origin) {
+  static const char *const localHosts[] = {"localhost", "127.0.0.1",
+                                           "[::1]"};
+  if (!origin || strncmp(origin, "file://", 7) == 0 ||
+      (allowed[0] && strcmp(origin, allowed) == 0)) {
+    return true;
+  }
+  const char *host = strstr(origin, "://");
+  if (!host) {
+    return false;
+  }
+  host += 3;
+  for (size_t i = 0; i < sizeof(localHosts) / sizeof(localHosts[0]); i++) {
+    size_t length = strlen(localHosts[i]);
+    if (strncmp(host, localHosts[i], length) == 0 &&
+        (host[length] == '\0' || host[length] == ':')) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Copy the trimmed value of a request header into value
+static HeaderStatus findHeader(const char *request, const char *name,
+                               char *value, size_t size) {
+  size_t nameLength = strlen(name);
+  for (const char *line = strstr(request, "\r\n"); line;
+       line = strstr(line, "\r\n")) {
+    line += 2;
+    if (strncasecmp(line, name, nameLength) != 0 || line[nameLength] != ':') {
+      continue;
+    }
+    const char *start = line + nameLength + 1;
+    const char *end = strstr(start, "\r\n");
+    if (!end) {
+      return HEADER_INVALID;
+    }
+    while (start < end && (*start == ' ' || *start == '\t')) {
+      start++;
+    }
+    while (end > start && (end[-1] == ' ' || end[-1] == '\t')) {
+      end--;
+    }
+    if ((size_t)(end - start) >= size) {
+      return HEADER_INVALID;
+    }
+    memcpy(value, start, (size_t)(end - start));
+    value[end - start] = '\0';
+    return HEADER_FOUND;
+  }
+  return HEADER_MISSING;
+}
+
+static void refuseClient(WsClient *client, const char *status) {
+  char response[128];
+  int length = snprintf(response, sizeof(response),
+                        "HTTP/1.1 %s\r\nConnection: close\r\n\r\n", status);
+  send(client->fd, response, (size_t)length, SEND_FLAGS);
+  totals.refused++;
+  closeClient(client);
+}
+
+// Answer the opening request once it is complete
+static void handshake(WsClient *client) {
+  client->input[client->inputLength] = '\0';
+  char *end = strstr(client->input, "\r\n\r\n");
+  if (!end) {
+    if (client->inputLength == WS_INPUT_MAX) {
+      refuseClient(client, "431 Request Header Fields Too Large");
+    }
+    return;
+  }
+  end[2] = '\0';
+
+  char key[64];
+  char origin[256];
+  HeaderStatus originStatus =
+      findHeader(client->input, "Origin", origin, sizeof(origin));
+  if (strncmp(client->input, "GET ", 4) != 0 ||
+      findHeader(client->input, "Sec-WebSocket-Key", key, sizeof(key)) !=
+          HEADER_FOUND) {
+    refuseClient(client, "400 Bad Request");
+    return;
+  }
+  // Only a request without any Origin comes from outside a browser
+  if (originStatus == HEADER_INVALID) {
+    printf("WebSocket client refused: unreadable or overlong origin\n");
+    refuseClient(client, "403 Forbidden");
+    return;
+  }
+  if (!originAllowed(originStatus == HEADER_FOUND ? origin : NULL)) {
+    const char *hint = strcmp(origin, "null") == 0
+                           ? "; file:// pages need --ws-origin null"
+                           : "";
+    printf("WebSocket client refused: origin %s is not allowed (see "
+           "--ws-origin%s)\n",
+           origin, hint);
+    refuseClient(client, "403 Forbidden");
+    return;
+  }
+
+  char keyAndGuid[128];
+  unsigned char digest[20];
+  char encoded[32];
+  snprintf(keyAndGuid, sizeof(keyAndGuid), "%s%s", key, WS_GUID);
+  sha1((const unsigned char *)keyAndGuid, strlen(keyAndGuid), digest);
+  base64(digest, sizeof(digest), encoded);
+
+  char response[256];
+  int length = snprintf(response, sizeof(response),
+                        "HTTP/1.1 101 Switching Protocols\r\n"
+                        "Upgrade: websocket\r\n"
+                        "Connection: Upgrade\r\n"
+                        "Sec-WebSocket-Accept: %s\r\n\r\n",
+                        encoded);
+  enqueue(client, response, (size_t)length);
+  client->state = WS_OPEN;
+  client->inputLength = 0;
+  totals.clients++;
+  printf("WebSocket client %d connected\n", client->id);
+
+  // Start the client off with the line as it is now
+  client->resync = lastFrameLength > 0 && !sendLastFrame(client);
+  flushClient(client);
+}
+
+// Handle the frames a client sends: answer pings and close requests, and
+// ignore everything else. Returns false if the client was closed.
+static bool readFrames(WsClient *client) {
+  unsigned char *data = (unsigned char *)client->input;
+  size_t consumed = 0;
+  for (;;) {
+    size_t available = client->inputLength - consumed;
+    unsigned char *frame = data + consumed;
+    if (available < 2) {
+      break;
+    }
+    int opcode = frame[0] & 0x0F;
+    Uint64 length = frame[1] & 0x7F;
+    size_t header = 2;
+    if (length == 126) {
+      header = 4;
+    } else if (length == 127) {
+      header = 10;
+    }
+    if (!(frame[1] & 0x80)) {
+      closeClient(client); // Client frames must be masked
+      return false;
+    }
+    if (available < header) {
+      break;
+    }
+    if (header > 2) {
+      length = 0;
+      for (size_t i = 2; i < header; i++) {
+        length = length << 8 | frame[i];
+      }
+    }
+    if (length > WS_INPUT_MAX - header - 4) {
+      closeClient(client); // Nothing a client needs to send is that long
+      return false;
+    }
+    if (available < header + 4 + length) {
+      break;
+    }
+
+    unsigned char *mask = frame + header;
+    unsigned char *payload = mask + 4;
+    for (Uint64 i = 0; i < length; i++) {
+      payload[i] ^= mask[i % 4];
+    }
+    unsigned char reply[WS_FRAME_HEADER_MAX + 125];
+    if (opcode == 0x8 && client->state == WS_OPEN) {
+      // Echo the status code and close once the queue is sent
+      size_t replyLength = length >= 2 ? 2 : 0;
+      size_t start = frameHeader(reply, 0x8, replyLength);
+      memcpy(reply + start, payload, replyLength);
+      enqueue(client, reply, start + replyLength);
+      client->state = WS_CLOSING;
+    } else if (opcode == 0x9 && length <= 125) {
+      size_t start = frameHeader(reply, 0xA, (size_t)length);
+      memcpy(reply + start, payload, (size_t)length);
+      enqueue(client, reply, start + (size_t)length);
+    }
+    consumed += header + 4 + (size_t)length;
+  }
+
+  memmove(data, data + consumed, client->inputLength - consumed);
+  client->inputLength -= consumed;
+  return true;
+}
+
+static void readClient(WsClient *client) {
+  ssize_t bytes;
+  do {
+    bytes = read(client->fd, client->input + client->inputLength,
+                 WS_INPUT_MAX - client->inputLength);
+  } while (bytes < 0 && errno == EINTR);
+  if (bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+    return;
+  }
+  if (bytes <= 0) {
+    closeClient(client);
+    return;
+  }
+  client->inputLength += (size_t)bytes;
+
+  if (client->state == WS_HANDSHAKE) {
+    handshake(client);
+  } else if (readFrames(client)) {
+    flushClient(client);
+  }
+}
+
+// Frame every message the render thread handed over and queue it for each
+// client, then send as much as every socket takes right away
+static void deliverOutbox(void) {
+  unsigned int tail = (unsigned int)SDL_AtomicGet(&outboxTail);
+  unsigned int head = (unsigned int)SDL_AtomicGet(&outboxHead);
+  SDL_MemoryBarrierAcquire();
+  if (tail == head) {
+    return;
+  }
+  for (; tail != head; tail++) {
+    const WsMessage *message = &outbox[tail & (WS_OUTBOX_SLOTS - 1)];
+    size_t start = frameHeader(lastFrame, 0x1, (size_t)message->length);
+    memcpy(lastFrame + start, message->text, (size_t)message->length);
+    lastFrameLength = start + (size_t)message->length;
+    totals.published++;
+
+    // A full queue drops the message for that client alone
+    for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+      WsClient *client = &clients[i];
+      if (client->fd >= 0 && client->state == WS_OPEN &&
+          !sendLastFrame(client)) {
+        client->resync = true;
+        client->dropped++;
+        totals.dropped++;
+      }
+    }
+  }
+  // Hand the slots back to the render thread in one store
+  SDL_MemoryBarrierRelease();
+  SDL_AtomicSet(&outboxTail, (int)tail);
+
+  for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+    if (clients[i].fd >= 0) {
+      flushClient(&clients[i]);
+    }
+  }
+}
+
+static void *wsThread(void *param) {
+  struct pollfd fds[WS_MAX_CLIENTS + 2];
+  int slots[WS_MAX_CLIENTS + 2];
+  for (;;) {
+    int count = 0;
+    fds[count].fd = wakePipe[0];
+    fds[count].events = POLLIN;
+    slots[count++] = -1;
+    fds[count].fd = listenFd;
+    fds[count].events = POLLIN;
+    slots[count++] = -1;
+    for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+      WsClient *client = &clients[i];
+      if (client->fd < 0) {
+        continue;
+      }
+      // A client that missed the newest message gets it once it has room
+      if (client->resync && client->state == WS_OPEN) {
+        sendLastFrame(client);
+      }
+      fds[count].fd = client->fd;
+      fds[count].events = POLLIN;
+      if (client->queueStart < client->queueEnd) {
+        fds[count].events |= POLLOUT;
+      }
+      slots[count++] = i;
+    }
+
+    if (poll(fds, (nfds_t)count, -1) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+
+    if (fds[0].revents) {
+      char drain[64];
+      while (read(wakePipe[0], drain, sizeof(drain)) > 0) {
+      }
+      if (SDL_AtomicGet(&stopping)) {
+        return NULL;
+      }
+      deliverOutbox();
+    }
+    if (fds[1].revents) {
+      acceptClients();
+    }
+    for (int i = 2; i < count; i++) {
+      WsClient *client = &clients[slots[i]];
+      if (client->fd < 0 || client->fd != fds[i].fd) {
+        continue;
+      }
+      if (fds[i].revents & POLLOUT) {
+        flushClient(client);
+      }
+      if (client->fd >= 0 && (fds[i].revents & (POLLIN | POLLHUP | POLLERR))) {
+        readClient(client);
+      }
+    }
+  }
+  return NULL;
+}
+
+static void closeSockets(void) {
+  for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+    if (clients[i].fd >= 0) {
+      closeClient(&clients[i]);
+    }
+  }
+  if (listenFd >= 0) {
+    close(listenFd);
+    listenFd = -1;
+  }
+  for (int i = 0; i < 2; i++) {
+    if (wakePipe[i] >= 0) {
+      close(wakePipe[i]);
+      wakePipe[i] = -1;
+    }
+  }
+}
+
+bool wsOutputStart(int port, const char *allowedOrigin) {
+  for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+    clients[i].fd = -1;
+  }
+  snprintf(allowed, sizeof(allowed), "%s", allowedOrigin ? allowedOrigin : "");
+  SDL_AtomicSet(&outboxHead, 0);
+  SDL_AtomicSet(&outboxTail, 0);
+  SDL_AtomicSet(&outboxDrops, 0);
+  SDL_AtomicSet(&stopping, 0);
+
+  // The render thread must never block on the wakeup either
+  if (pipe(wakePipe) < 0 || !setNonBlocking(wakePipe[0]) ||
+      !setNonBlocking(wakePipe[1])) {
+    closeSockets();
+    return false;
+  }
+
+  // Loopback only: the stream is every key typed
+  struct sockaddr_in address;
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = htons((uint16_t)port);
+  listenFd = socket(AF_INET, SOCK_STREAM, 0);
+  int reuse = 1;
+  if (listenFd < 0 ||
+      setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &reuse,
+                 sizeof(reuse)) < 0 ||
+      bind(listenFd, (struct sockaddr *)&address, sizeof(address)) < 0 ||
+      listen(listenFd, WS_MAX_CLIENTS) < 0 || !setNonBlocking(listenFd)) {
+    printf("Failed to listen for WebSocket clients on 127.0.0.1:%d: %s\n",
+           port, strerror(errno));
+    closeSockets();
+    return false;
+  }
+
+  if (pthread_create(&serverThread, NULL, wsThread, NULL) != 0) {
+    closeSockets();
+    return false;
+  }
+  threadRunning = true;
+  printf("Streaming key events to WebSocket clients on ws://127.0.0.1:%d/\n",
+         port);
+  return true;
+}
+
+void wsOutputPublish(const char *text, int length) {
+  if (!threadRunning || length <= 0 || length > WS_MESSAGE_MAX) {
+    return;
+  }
+  unsigned int head = (unsigned int)SDL_AtomicGet(&outboxHead);
+  unsigned int tail = (unsigned int)SDL_AtomicGet(&outboxTail);
+  if (head - tail >= WS_OUTBOX_SLOTS) {
+    SDL_AtomicAdd(&outboxDrops, 1);
+    return;
+  }
+  WsMessage *message = &outbox[head & (WS_OUTBOX_SLOTS - 1)];
+  memcpy(message->text, text, (size_t)length);
+  message->length = length;
+
+  // Publish the slot contents before the new head becomes visible
+  SDL_MemoryBarrierRelease();
+  SDL_AtomicSet(&outboxHead, (int)(head + 1));
+  char byte = 0;
+  if (write(wakePipe[1], &byte, 1) < 0) {
+    // Pipe full: the server thread has a wakeup pending already
+  }
+}
+
+void wsOutputStop(void) {
+  if (!threadRunning) {
+    return;
+  }
+  SDL_AtomicSet(&stopping, 1);
+  char byte = 0;
+  if (write(wakePipe[1], &byte, 1) == 1) {
+    pthread_join(serverThread, NULL);
+  }
+  threadRunning = false;
+  closeSockets();
+}
+
+void wsOutputPrintStats(void) {
+  printf("WebSocket: %llu clients, %llu refused, %llu messages published, "
+         "%llu dropped before sending, %llu sent, %llu dropped for slow "
+         "clients, %llu bytes\n",
+         (unsigned long long)totals.clients,
+         (unsigned long long)totals.refused,
+         (unsigned long long)totals.published,
+         (unsigned long long)SDL_AtomicGet(&outboxDrops),
+         (unsigned long long)totals.sent, (unsigned long long)totals.dropped,
+         (unsigned long long)totals.bytes);
+}
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef WS_OUTPUT_H
+#define WS_OUTPUT_H
+
+#ifndef _WIN32
+
+#include <stdbool.h>
+
+#define WS_MESSAGE_MAX 16384 // Longest message that can be published
+
+// Localhost WebSocket server for browser-source overlays. A thread accepts
+// clients on 127.0.0.1:port and sends each of them every published message
+// as a text frame. Every client has a bounded send queue: when one falls
+// behind, messages are dropped for it alone and it is sent the newest one as
+// soon as it has room, so it never holds up the render loop or other
+// clients.
+//
+// Browsers are only let in from pages on this machine (localhost, 127.0.0.1)
+// or from allowedOrigin if not NULL, so a web page cannot read keys from the
+// overlay. Pages opened from file:// send the origin "null", which any web
+// page can also send from a sandboxed iframe, so they need allowedOrigin
+// "null".
+bool wsOutputStart(int port, const char *allowedOrigin);
+
+// Render thread: hand a message to the server thread. Never blocks; the
+// message is dropped if the server thread is several messages behind.
+void wsOutputPublish(const char *text, int length);
+
+// Close every client and the listening socket, and join the server thread
+void wsOutputStop(void);
+
+void wsOutputPrintStats(void);
+
+#endif
+
+#endif
@@ -0,0 +1,284 @@
+// Build step: embeds the font files and pre-rasterizes every key label, cap
+// glyph and the button text at the default scale into a packed atlas with
+// its metrics, written out as C (see src/baked_fonts.h).
+//
+// Usage: bake_fonts OUTPUT.c  (run from the repository root so the fonts
+// are found)
+
+#ifdef _WIN32
+#define SDL_MAIN_HANDLED
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/baked_fonts.h"
+#include "../src/keysyms.h"
+#include "../src/label_cache.h"
+#include "../src/scene.h"
+#include "../src/scene_fonts.h"
+
+#define KEY_FONT_PATH "./PixelifySans[wght].ttf"
+#define BUTTON_FONT_PATH "./JetBrainsMono-Medium.ttf"
+#define MAX_LABELS LABEL_CACHE_CAPACITY
+
+typedef struct {
+  int font;
+  int order; // Position in the vocabulary
+  char text[LABEL_TEXT_MAX];
+  SDL_Surface *surface;
+  SDL_Rect rect;
+  int shelf;
+} BakeLabel;
+
+static BakeLabel labels[MAX_LABELS];
+static int labelCount;
+static LabelImageShelf shelves[LABEL_MAX_SHELVES];
+static int shelfCount;
+static int nextShelfY;
+
+// Rasterize a label once, exactly as the label cache would at runtime
+static bool addLabel(TTF_Font *font, int fontIndex, const char *text) {
+  for (int i = 0; i < labelCount; i++) {
+    if (labels[i].font == fontIndex && strcmp(labels[i].text, text) == 0) {
+      return true;
+    }
+  }
+  if (labelCount == MAX_LABELS) {
+    fprintf(stderr, "bake_fonts: more than %d labels\n", MAX_LABELS);
+    return false;
+  }
+
+  SDL_Color white = {255, 255, 255, 255};
+  SDL_Surface *surface = TTF_RenderText_Blended(font, text, white);
+  if (surface && surface->format->format != SDL_PIXELFORMAT_ARGB8888) {
+    SDL_Surface *converted =
+        SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_ARGB8888, 0);
+    SDL_FreeSurface(surface);
+    surface = converted;
+  }
+  if (!surface) {
+    fprintf(stderr, "bake_fonts: cannot rasterize \"%s\": %s\n", text,
+            TTF_GetError());
+    return false;
+  }
+
+  BakeLabel *label = &labels[labelCount];
+  label->order = labelCount++;
+  label->font = fontIndex;
+  strncpy(label->text, text, LABEL_TEXT_MAX - 1);
+  label->surface = surface;
+  return true;
+}
+
+// Tallest first; ties in vocabulary order so builds are reproducible
+static int compareHeight(const void *a, const void *b) {
+  const BakeLabel *x = a;
+  const BakeLabel *y = b;
+  if (x->surface->h != y->surface->h) {
+    return y->surface->h - x->surface->h;
+  }
+  return x->order - y->order;
+}
+
+// Shelf-pack the tallest labels first, choosing shelves like the cache does
+static bool packLabels(void) {
+  qsort(labels, labelCount, sizeof(labels[0]), compareHeight);
+  for (int i = 0; i < labelCount; i++) {
+    BakeLabel *label = &labels[i];
+    int w = label->surface->w;
+    int h = label->surface->h;
+
+    int best = -1;
+    for (int s = 0; s < shelfCount; s++) {
+      if (shelves[s].height >= h &&
+          shelves[s].nextX + w <= LABEL_ATLAS_SIZE &&
+          (best < 0 || shelves[s].height < shelves[best].height)) {
+        best = s;
+      }
+    }
+    if (best < 0) {
+      if (shelfCount == LABEL_MAX_SHELVES || w > LABEL_ATLAS_SIZE ||
+          nextShelfY + h > LABEL_ATLAS_SIZE) {
+        fprintf(stderr, "bake_fonts: labels do not fit the atlas\n");
+        return false;
+      }
+      best = shelfCount++;
+      shelves[best].y = nextShelfY;
+      shelves[best].height = h;
+      shelves[best].nextX = 0;
+      nextShelfY += h + LABEL_SHELF_PADDING;
+    }
+
+    label->rect.x = shelves[best].nextX;
+    label->rect.y = shelves[best].y;
+    label->rect.w = w;
+    label->rect.h = h;
+    label->shelf = best;
+    shelves[best].nextX += w + LABEL_SHELF_PADDING;
+  }
+  return true;
+}
+
+static bool writeBytes(FILE *out, const char *declaration,
+                       const unsigned char *data, size_t length) {
+  fprintf(out, "%s[] = {", declaration);
+  for (size_t i = 0; i < length; i++) {
+    fprintf(out, "%s%u,", i % 20 == 0 ? "\n" : "", data[i]);
+  }
+  fprintf(out, "\n};\n");
+  return !ferror(out);
+}
+
+// Write a file as NAMEData and its size as NAMELength
+static bool embedFile(FILE *out, const char *path, const char *name) {
+  size_t length;
+  void *data = SDL_LoadFile(path, &length);
+  if (!data) {
+    fprintf(stderr, "bake_fonts: cannot read %s: %s\n", path, SDL_GetError());
+    return false;
+  }
+  char declaration[64];
+  snprintf(declaration, sizeof(declaration), "const unsigned char %sData",
+           name);
+  bool ok = writeBytes(out, declaration, data, length);
+  fprintf(out, "const size_t %sLength = %lu;\n\n", name,
+          (unsigned long)length);
+  SDL_free(data);
+  return ok;
+}
+
+// Labels are Latin-1; escape anything that is not plain printable ASCII
+static void writeString(FILE *out, const char *text) {
+  fputc('"', out);
+  for (const unsigned char *c = (const unsigned char *)text; *c; c++) {
+    if (*c == '"' || *c == '\\' || *c < 0x20 || *c >= 0x7F) {
+      fprintf(out, "\\%03o", *c);
+    } else {
+      fputc(*c, out);
+    }
+  }
+  fputc('"', out);
+}
+
+static void writeMetrics(FILE *out, const KeyFontMetrics *metrics) {
+  fprintf(out, "const KeyFontMetrics bakedKeyMetrics = {\n    {");
+  for (int i = 0; i < KSYM_COUNT; i++) {
+    fprintf(out, "%s{%d, %d},", i % 6 == 0 ? "\n     " : " ",
+            metrics->symbols[i].width, metrics->symbols[i].height);
+  }
+  fprintf(out, "\n    },\n    {");
+  for (int i = 0; i < 256; i++) {
+    fprintf(out, "%s%d,", i % 16 == 0 ? "\n     " : " ",
+            metrics->capGlyphWidths[i]);
+  }
+  fprintf(out, "\n    },\n};\n\n");
+}
+
+static void writeLabels(FILE *out) {
+  int height = nextShelfY > 0 ? nextShelfY - LABEL_SHELF_PADDING : 0;
+  unsigned char *alpha = calloc((size_t)LABEL_ATLAS_SIZE * height + 1, 1);
+  for (int i = 0; i < labelCount; i++) {
+    SDL_Surface *surface = labels[i].surface;
+    for (int y = 0; y < surface->h; y++) {
+      const Uint32 *row =
+          (const Uint32 *)((const Uint8 *)surface->pixels + y * surface->pitch);
+      unsigned char *dst =
+          alpha + (size_t)(labels[i].rect.y + y) * LABEL_ATLAS_SIZE +
+          labels[i].rect.x;
+      for (int x = 0; x < surface->w; x++) {
+        dst[x] = (unsigned char)(row[x] >> 24);
+      }
+    }
+  }
+  writeBytes(out, "static const Uint8 labelAlpha", alpha,
+             (size_t)LABEL_ATLAS_SIZE * height);
+  free(alpha);
+
+  fprintf(out, "\nstatic const LabelImageShelf labelShelves[] = {\n");
+  for (int i = 0; i < shelfCount; i++) {
+    fprintf(out, "    {%d, %d, %d},\n", shelves[i].y, shelves[i].height,
+            shelves[i].nextX);
+  }
+  fprintf(out, "};\n\nstatic const LabelImageEntry labelEntries[] = {\n");
+  for (int i = 0; i < labelCount; i++) {
+    fprintf(out, "    {%d, ", labels[i].font);
+    writeString(out, labels[i].text);
+    fprintf(out, ", {%d, %d, %d, %d}, %d},\n", labels[i].rect.x,
+            labels[i].rect.y, labels[i].rect.w, labels[i].rect.h,
+            labels[i].shelf);
+  }
+  fprintf(out, "};\n\n");
+  fprintf(out,
+          "const LabelAtlasImage bakedLabels = {%d, %d, labelAlpha,\n"
+          "                                     labelShelves, %d,\n"
+          "                                     labelEntries, %d};\n",
+          LABEL_ATLAS_SIZE, height, shelfCount, labelCount);
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+    fprintf(stderr, "Usage: bake_fonts OUTPUT.c\n");
+    return 1;
+  }
+  if (TTF_Init() < 0) {
+    fprintf(stderr, "SDL_ttf could not initialize! TTF_Error: %s\n",
+            TTF_GetError());
+    return 1;
+  }
+
+  // The default canvas scale, at the sizes scene.c opens fonts at
+  TTF_Font *keyFont = TTF_OpenFont(KEY_FONT_PATH, FONT_SIZE);
+  TTF_Font *buttonFont = TTF_OpenFont(BUTTON_FONT_PATH, BUTTON_FONT_SIZE);
+  if (!keyFont || !buttonFont) {
+    fprintf(stderr, "bake_fonts: cannot open the fonts: %s\n",
+            TTF_GetError());
+    return 1;
+  }
+
+  KeyFontMetrics metrics;
+  memset(&metrics, 0, sizeof(metrics));
+  keySymbolsMeasure(&metrics, keyFont);
+
+  // The whole key vocabulary, the glyphs of chord and counted caps, and
+  // the button text
+  bool ok = true;
+  for (int i = 0; i < KSYM_COUNT && ok; i++) {
+    ok = addLabel(keyFont, BAKED_FONT_KEY, keySymbolLabel((KeySymbol)i));
+  }
+  const char *glyphs = KEY_CAP_PLUS KEY_CAP_TIMES "0123456789";
+  for (const char *c = glyphs; *c && ok; c++) {
+    char text[2] = {*c, '\0'};
+    ok = addLabel(keyFont, BAKED_FONT_KEY, text);
+  }
+  ok = ok && addLabel(buttonFont, BAKED_FONT_BUTTON, TOGGLE_BUTTON_TEXT);
+  ok = ok && packLabels();
+
+  FILE *out = ok ? fopen(argv[1], "w") : NULL;
+  if (ok && !out) {
+    fprintf(stderr, "bake_fonts: cannot write %s\n", argv[1]);
+  }
+  if (out) {
+    fprintf(out, "// Generated by tools/bake_fonts.c; do not edit\n\n"
+                 "#include \"baked_fonts.h\"\n\n");
+    ok = embedFile(out, KEY_FONT_PATH, "bakedKeyFont") &&
+         embedFile(out, BUTTON_FONT_PATH, "bakedButtonFont");
+    fprintf(out, "const int bakedScaleSteps = %d;\n\n", SCENE_SCALE_STEPS);
+    writeMetrics(out, &metrics);
+    writeLabels(out);
+    ok = ok && !ferror(out);
+    ok = fclose(out) == 0 && ok;
+    if (!ok) {
+      remove(argv[1]);
+    }
+  }
+
+  for (int i = 0; i < labelCount; i++) {
+    SDL_FreeSurface(labels[i].surface);
+  }
+  TTF_CloseFont(keyFont);
+  TTF_CloseFont(buttonFont);
+  TTF_Quit();
+  return ok && out ? 0 : 1;
+}
@@ -0,0 +1,597 @@
+// Synthetic key-storm benchmark. Drives the key line (processKeyPress, or
+// the burst coalescer) and renderScene into the headless software
+// framebuffer on a virtual 60 fps clock, and prints one JSON object per
+// workload with frame time percentiles, event throughput, SDL allocations
+// per frame and how often the key line composite was reused. Some workloads
+// repeat at 1440p and 4K, with the scale following the canvas height. A
+// startup run times opening the fonts through the first frame, with and
+// without the label atlas baked at build time, and a views run times extra
+// views of the same keys drawn with the same renderer and label cache.
+// Before any of that, every blend kernel set the CPU runs is checked
+// against the scalar reference on random rows, and each one's throughput
+// compositing line-sized rectangles is measured.
+//
+// Usage: keycapper-bench [seconds]  (seconds of virtual time per workload,
+// default 10)
+
+#ifdef _WIN32
+#define SDL_MAIN_HANDLED
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/headless.h"
+#include "../src/key_coalesce.h"
+#include "../src/keysyms.h"
+#include "../src/label_cache.h"
+#include "../src/pixel_blend.h"
+#include "../src/scene.h"
+#include "../src/scene_clock.h"
+#include "../src/scene_fonts.h"
+#include "../src/scene_view.h"
+
+#define BENCH_FPS 60
+#define MAX_FRAMES (BENCH_FPS * 600)
+#define STARTUP_RUNS 9
+#define STARTUP_KEYS 40 // Keys on the line in the first frame
+#define VIEWS_KEYS_PER_SEC 100
+#define BLEND_MAX_SETS 4
+#define BLEND_EXACT_ROWS 20000
+#define BLEND_EXACT_WIDTH 70 // Longest random row, past every kernel's step
+#define BLEND_WIDTH 1200     // Rectangle about the size of the key line
+#define BLEND_HEIGHT 120
+
+// Picks the n-th key of a workload; seed is the workload's private LCG state
+typedef KeySymbol (*NextKeyFn)(Uint32 *seed, Uint64 n);
+
+typedef struct {
+  const char *name;
+  int keysPerSec;
+  NextKeyFn nextKey;
+  Uint16 flags;  // KEY_EVENT_* flags on every key
+  bool coalesce; // Feed keys through a KeyCoalescer like the app does
+  int height;    // 16:9 canvas height; 0 = the default canvas
+} Workload;
+
+// Every SDL (and SDL_ttf) allocation goes through these counters
+static SDL_malloc_func realMalloc;
+static SDL_calloc_func realCalloc;
+static SDL_realloc_func realRealloc;
+static SDL_free_func realFree;
+static Uint64 allocations;
+
+static void *countingMalloc(size_t size) {
+  allocations++;
+  return realMalloc(size);
+}
+
+static void *countingCalloc(size_t nmemb, size_t size) {
+  allocations++;
+  return realCalloc(nmemb, size);
+}
+
+static void *countingRealloc(void *mem, size_t size) {
+  allocations++;
+  return realRealloc(mem, size);
+}
+
+static void countingFree(void *mem) { realFree(mem); }
+
+static Uint32 nextRandom(Uint32 *seed) {
+  *seed = *seed * 1664525u + 1013904223u;
+  return *seed >> 8;
+}
+
+// Prose-like typing: letters with spaces, the odd backspace and return
+static KeySymbol steadyTyping(Uint32 *seed, Uint64 n) {
+  Uint32 r = nextRandom(seed) % 100;
+  if (r < 16) {
+    return KSYM_SPACE;
+  }
+  if (r < 19) {
+    return KSYM_BACKSPACE;
+  }
+  if (r < 20) {
+    return KSYM_RETURN;
+  }
+  return (KeySymbol)(KSYM_A + nextRandom(seed) % 26);
+}
+
+// A held key flooding the line with repeats of the same label
+static KeySymbol repeatFlood(Uint32 *seed, Uint64 n) {
+  return KSYM_BACKSPACE;
+}
+
+// Modifiers pressed on their own, as in shortcut-heavy editing
+static KeySymbol modifierSpam(Uint32 *seed, Uint64 n) {
+  static const KeySymbol modifiers[] = {KSYM_SHIFT, KSYM_CTRL, KSYM_ALT,
+                                        KSYM_SUPER};
+  return modifiers[n % 4];
+}
+
+// Only the widest labels, so the line wraps every few keys
+static KeySymbol longLabels(Uint32 *seed, Uint64 n) {
+  static const KeySymbol labels[] = {KSYM_RETURN, KSYM_SCROLL_LOCK,
+                                     KSYM_PAUSE,  KSYM_CLEAR,
+                                     KSYM_PRINT,  KSYM_BACKSPACE};
+  return labels[nextRandom(seed) % 6];
+}
+
+static const Workload workloads[] = {
+    {"steady-typing", 20, steadyTyping, 0, false, 0},
+    {"steady-typing", 100, steadyTyping, 0, false, 0},
+    {"steady-typing", 1000, steadyTyping, 0, false, 0},
+    {"repeat-flood", 1000, repeatFlood, 0, false, 0},
+    {"repeat-flood-coalesced", 1000, repeatFlood, KEY_EVENT_REPEAT, true, 0},
+    {"modifier-spam", 100, modifierSpam, 0, false, 0},
+    {"modifier-spam", 1000, modifierSpam, 0, false, 0},
+    {"wrap-long-labels", 100, longLabels, 0, false, 0},
+    {"wrap-long-labels", 1000, longLabels, 0, false, 0},
+    {"steady-typing", 100, steadyTyping, 0, false, 1440},
+    {"steady-typing", 100, steadyTyping, 0, false, 2160},
+};
+
+// Extra views for the views run: a right-aligned copy of the canvas, then a
+// half-scale corner version
+static const char *const viewSpecs[] = {"1280x720,right",
+                                        "640x120,scale=0.5,right"};
+#define VIEW_SPEC_COUNT (int)(sizeof(viewSpecs) / sizeof(viewSpecs[0]))
+
+static Uint64 frameTimes[MAX_FRAMES];
+static Uint64 viewTimes[MAX_FRAMES];
+static SceneSnapshot snapshot;
+static SceneView views[VIEW_SPEC_COUNT];
+
+static int compareU64(const void *a, const void *b) {
+  Uint64 x = *(const Uint64 *)a;
+  Uint64 y = *(const Uint64 *)b;
+  return x < y ? -1 : x > y;
+}
+
+static double percentileUs(const Uint64 *sorted, int count, double p,
+                           double ticksPerUs) {
+  int index = (int)(p * (count - 1) + 0.5);
+  return sorted[index] / ticksPerUs;
+}
+
+// Compose the key line in the target's memory with the blend kernels, as
+// keycapper --headless does. Called after every labelCacheInit.
+static bool useSoftwareComposite(HeadlessTarget *target) {
+  if (!labelCacheKeepCoverage(&labelCache)) {
+    return false;
+  }
+  lineComposite.framebuffer = target->surface;
+  return true;
+}
+
+static void randomBytes(Uint8 *bytes, int count, Uint32 *seed) {
+  for (int i = 0; i < count; i++) {
+    bytes[i] = (Uint8)nextRandom(seed);
+  }
+}
+
+// Random premultiplied pixels: no channel above its alpha
+static void randomPremultiplied(Uint8 *pixels, int count, Uint32 *seed) {
+  randomBytes(pixels, count * 4, seed);
+  for (int i = 0; i < count * 4; i += 4) {
+    for (int c = 0; c < 3; c++) {
+      pixels[i + c] = (Uint8)(pixels[i + c] * (pixels[i + 3] + 1) >> 8);
+    }
+  }
+}
+
+// Check every kernel set against the scalar one on rows of random length,
+// alignment, pixels and fade, including fully transparent and opaque fades
+static bool runBlendExact(void) {
+  static Uint8 source[(BLEND_EXACT_WIDTH + 4) * 4];
+  static Uint8 coverage[BLEND_EXACT_WIDTH + 4];
+  static Uint8 initial[(BLEND_EXACT_WIDTH + 4) * 4];
+  static Uint8 expected[(BLEND_EXACT_WIDTH + 4) * 4];
+  static Uint8 actual[(BLEND_EXACT_WIDTH + 4) * 4];
+  const PixelBlendKernels *sets[BLEND_MAX_SETS];
+  int setCount = pixelBlendAvailable(sets, BLEND_MAX_SETS);
+  Uint32 seed = 12345;
+  Uint64 mismatches = 0;
+
+  for (int row = 0; row < BLEND_EXACT_ROWS; row++) {
+    int width = nextRandom(&seed) % (BLEND_EXACT_WIDTH + 1);
+    int offset = nextRandom(&seed) % 4; // Pixels and coverage off alignment
+    Uint8 alpha = row % 3 == 0 ? 0 : row % 3 == 1 ? 255 : nextRandom(&seed);
+    Uint8 rgba[4];
+    randomPremultiplied(rgba, 1, &seed);
+    Uint32 color;
+    memcpy(&color, rgba, sizeof(color));
+    randomPremultiplied(source + offset * 4, width, &seed);
+    randomBytes(coverage + offset, width, &seed);
+    randomPremultiplied(initial, BLEND_EXACT_WIDTH + 4, &seed);
+
+    for (int op = 0; op < 3; op++) {
+      for (int i = 0; i < setCount; i++) {
+        Uint8 *dst = i == 0 ? expected : actual;
+        memcpy(dst, initial, sizeof(initial));
+        if (op == 0) {
+          sets[i]->blendRow(dst + offset * 4, source + offset * 4, width,
+                            alpha);
+        } else if (op == 1) {
+          sets[i]->coverageRow(dst + offset * 4, coverage + offset, width,
+                               color, alpha);
+        } else {
+          sets[i]->fillRow(dst + offset * 4, width, color);
+        }
+        if (i > 0 && memcmp(expected, actual, sizeof(actual)) != 0) {
+          if (mismatches == 0) {
+            fprintf(stderr, "Blend kernels %s differ from scalar (op %d, "
+                    "width %d, alpha %d)\n", sets[i]->name, op, width,
+                    alpha);
+          }
+          mismatches++;
+        }
+      }
+    }
+  }
+
+  printf("{\"bench\":\"blend-exact\",\"kernels\":\"");
+  for (int i = 0; i < setCount; i++) {
+    printf("%s%s", i > 0 ? "," : "", sets[i]->name);
+  }
+  printf("\",\"rows\":%d,\"mismatches\":%llu}\n", BLEND_EXACT_ROWS,
+         (unsigned long long)mismatches);
+  fflush(stdout);
+  return mismatches == 0;
+}
+
+// Megapixels per second of each kernel set and operation, compositing a
+// rectangle the size of the key line into a framebuffer-sized pitch
+static bool runBlendBench(double seconds) {
+  int pitch = WINDOW_WIDTH * 4 > BLEND_WIDTH * 4 ? WINDOW_WIDTH * 4
+                                                  : BLEND_WIDTH * 4;
+  Uint8 *dst = SDL_malloc((size_t)pitch * BLEND_HEIGHT);
+  Uint8 *source = SDL_malloc((size_t)BLEND_WIDTH * 4 * BLEND_HEIGHT);
+  Uint8 *coverage = SDL_malloc((size_t)BLEND_WIDTH * BLEND_HEIGHT);
+  if (!dst || !source || !coverage) {
+    SDL_free(dst);
+    SDL_free(source);
+    SDL_free(coverage);
+    return false;
+  }
+  Uint32 seed = 12345;
+  randomPremultiplied(dst, pitch / 4 * BLEND_HEIGHT, &seed);
+  randomPremultiplied(source, BLEND_WIDTH * BLEND_HEIGHT, &seed);
+  randomBytes(coverage, BLEND_WIDTH * BLEND_HEIGHT, &seed);
+  Uint32 color = pixelBlendColor(255, 255, 255, 255);
+
+  const PixelBlendKernels *sets[BLEND_MAX_SETS];
+  int setCount = pixelBlendAvailable(sets, BLEND_MAX_SETS);
+  static const char *const ops[] = {"copy", "coverage", "fill"};
+  Uint64 frequency = SDL_GetPerformanceFrequency();
+  // A hundredth of the workload time per measurement, at least one rect
+  Uint64 budget = (Uint64)(seconds * frequency / 100);
+
+  for (int i = 0; i < setCount; i++) {
+    for (int op = 0; op < 3; op++) {
+      Uint64 rects = 0;
+      Uint64 start = SDL_GetPerformanceCounter();
+      Uint64 elapsed;
+      do {
+        Uint8 alpha = (Uint8)(rects * 7);
+        for (int y = 0; y < BLEND_HEIGHT; y++) {
+          Uint8 *row = dst + y * pitch;
+          if (op == 0) {
+            sets[i]->blendRow(row, source + y * BLEND_WIDTH * 4,
+                              BLEND_WIDTH, alpha);
+          } else if (op == 1) {
+            sets[i]->coverageRow(row, coverage + y * BLEND_WIDTH,
+                                 BLEND_WIDTH, color, alpha);
+          } else {
+            sets[i]->fillRow(row, BLEND_WIDTH, color);
+          }
+        }
+        rects++;
+        elapsed = SDL_GetPerformanceCounter() - start;
+      } while (elapsed < budget);
+
+      double pixels = (double)rects * BLEND_WIDTH * BLEND_HEIGHT;
+      printf("{\"bench\":\"blend\",\"kernels\":\"%s\",\"op\":\"%s\","
+             "\"rect\":\"%dx%d\",\"rects\":%llu,"
+             "\"mpix_per_sec\":%.1f}\n",
+             sets[i]->name, ops[op], BLEND_WIDTH, BLEND_HEIGHT,
+             (unsigned long long)rects,
+             elapsed > 0 ? pixels * frequency / elapsed / 1000000.0 : 0.0);
+      fflush(stdout);
+    }
+  }
+
+  SDL_free(dst);
+  SDL_free(source);
+  SDL_free(coverage);
+  return true;
+}
+
+// Run one workload from an empty line and a cold label cache, on a target
+// of the workload's canvas size
+static bool runWorkload(const Workload *workload, HeadlessTarget *target,
+                        int frameCount) {
+  int height = workload->height > 0 ? workload->height : WINDOW_HEIGHT;
+  int width = height * WINDOW_WIDTH / WINDOW_HEIGHT;
+  if (target->surface->w != width || target->surface->h != height) {
+    headlessDestroy(target);
+    if (!headlessInit(target, width, height, NULL)) {
+      return false;
+    }
+  }
+  if (!setSceneCanvas(width, height, 0.0f)) {
+    return false;
+  }
+  initScene();
+
+  KeyCoalescer coalescer;
+  keyCoalescerInit(&coalescer, KEY_COALESCE_DEFAULT_WINDOW, false);
+  if (!labelCacheInit(&labelCache, target->renderer, sceneLayout.atlasSize) ||
+      !useSoftwareComposite(target)) {
+    return false;
+  }
+
+  double ticksPerUs = SDL_GetPerformanceFrequency() / 1000000.0;
+  Uint32 seed = 12345;
+  Uint64 events = 0;
+  Uint64 totalTicks = 0;
+  Uint64 allocationsBefore = allocations;
+  Uint64 reusedBefore = lineComposite.reused;
+  Uint64 rebuiltBefore = lineComposite.rebuilt;
+
+  for (int frame = 0; frame < frameCount; frame++) {
+    Uint64 now = (Uint64)frame * 1000000 / BENCH_FPS;
+    Uint64 due = (Uint64)(frame + 1) * workload->keysPerSec / BENCH_FPS;
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    sceneClockSet(now);
+    for (; events < due; events++) {
+      KeySymbol symbol = workload->nextKey(&seed, events);
+      if (workload->coalesce) {
+        KeyEvent event;
+        keyEventInit(&event, symbol, workload->flags);
+        keyCoalescerFeed(&coalescer, &event, (Uint32)(now / 1000));
+      } else {
+        processKeyPress(symbol);
+      }
+    }
+    captureSceneSnapshot(&snapshot, now);
+    labelCacheBeginFrame(&labelCache);
+    renderScene(target->renderer, &snapshot, now);
+    headlessPresent(target);
+    frameTimes[frame] = SDL_GetPerformanceCounter() - start;
+    totalTicks += frameTimes[frame];
+  }
+
+  Uint64 frameAllocations = allocations - allocationsBefore;
+  qsort(frameTimes, frameCount, sizeof(frameTimes[0]), compareU64);
+  double totalSeconds = totalTicks / (ticksPerUs * 1000000.0);
+
+  printf("{\"bench\":\"%s\",\"keys_per_sec\":%d,\"canvas\":\"%dx%d\","
+         "\"scale\":%.2f,\"frames\":%d,"
+         "\"events\":%llu,\"frame_us_p50\":%.1f,\"frame_us_p99\":%.1f,"
+         "\"frame_us_max\":%.1f,\"events_per_sec\":%.0f,"
+         "\"allocs_per_frame\":%.3f,\"label_misses\":%llu,"
+         "\"label_evictions\":%llu,\"composite_reused\":%llu,"
+         "\"composite_rebuilt\":%llu}\n",
+         workload->name, workload->keysPerSec, width, height,
+         sceneLayout.scale, frameCount,
+         (unsigned long long)events,
+         percentileUs(frameTimes, frameCount, 0.50, ticksPerUs),
+         percentileUs(frameTimes, frameCount, 0.99, ticksPerUs),
+         frameTimes[frameCount - 1] / ticksPerUs,
+         totalSeconds > 0 ? events / totalSeconds : 0.0,
+         (double)frameAllocations / frameCount,
+         (unsigned long long)labelCache.misses,
+         (unsigned long long)labelCache.evictions,
+         (unsigned long long)(lineComposite.reused - reusedBefore),
+         (unsigned long long)(lineComposite.rebuilt - rebuiltBefore));
+  fflush(stdout);
+
+  destroyLineComposite(&lineComposite);
+  labelCacheDestroy(&labelCache);
+  return true;
+}
+
+// Time one cold start on the default canvas: open the fonts, create the
+// label cache, and lay out and draw a first frame with a line of keys
+static bool runStartup(HeadlessTarget *target, Uint64 *ticks,
+                       Uint64 *misses) {
+  sceneFontsCloseAll();
+  Uint64 start = SDL_GetPerformanceCounter();
+  if (!setSceneCanvas(WINDOW_WIDTH, WINDOW_HEIGHT, 0.0f) ||
+      !labelCacheInit(&labelCache, target->renderer, sceneLayout.atlasSize) ||
+      !useSoftwareComposite(target)) {
+    return false;
+  }
+  sceneFontsLoadLabels(&labelCache, sceneLayout.fonts);
+  initScene();
+
+  Uint32 seed = 12345;
+  sceneClockSet(0);
+  for (Uint64 n = 0; n < STARTUP_KEYS; n++) {
+    processKeyPress(steadyTyping(&seed, n));
+  }
+  captureSceneSnapshot(&snapshot, 0);
+  labelCacheBeginFrame(&labelCache);
+  renderScene(target->renderer, &snapshot, 0);
+  headlessPresent(target);
+  *ticks = SDL_GetPerformanceCounter() - start;
+  *misses = labelCache.misses;
+
+  destroyLineComposite(&lineComposite);
+  labelCacheDestroy(&labelCache);
+  return true;
+}
+
+// Median time to first frame over several cold starts
+static bool runStartupBench(HeadlessTarget *target, bool baked) {
+  Uint64 ticks[STARTUP_RUNS];
+  Uint64 misses = 0;
+  sceneFontsBaked = baked;
+  for (int i = 0; i < STARTUP_RUNS; i++) {
+    if (!runStartup(target, &ticks[i], &misses)) {
+      return false;
+    }
+  }
+  qsort(ticks, STARTUP_RUNS, sizeof(ticks[0]), compareU64);
+
+  double ticksPerMs = SDL_GetPerformanceFrequency() / 1000.0;
+  printf("{\"bench\":\"startup\",\"baked_labels\":%s,\"runs\":%d,"
+         "\"first_frame_ms_p50\":%.2f,\"first_frame_ms_min\":%.2f,"
+         "\"label_misses\":%llu}\n",
+         baked ? "true" : "false", STARTUP_RUNS,
+         ticks[STARTUP_RUNS / 2] / ticksPerMs, ticks[0] / ticksPerMs,
+         (unsigned long long)misses);
+  fflush(stdout);
+  sceneFontsBaked = true;
+  return true;
+}
+
+// Steady typing on the default canvas plus viewCount extra views, all fed
+// from one key stream. The views' share of each frame (their layout, draw
+// calls and read-back) is timed on its own.
+static bool runViews(HeadlessTarget *target, int frameCount, int viewCount) {
+  if (target->surface->w != WINDOW_WIDTH ||
+      target->surface->h != WINDOW_HEIGHT) {
+    headlessDestroy(target);
+    if (!headlessInit(target, WINDOW_WIDTH, WINDOW_HEIGHT, NULL)) {
+      return false;
+    }
+  }
+  if (!setSceneCanvas(WINDOW_WIDTH, WINDOW_HEIGHT, 0.0f)) {
+    return false;
+  }
+  initScene();
+
+  int atlasSize = sceneLayout.atlasSize;
+  for (int i = 0; i < viewCount; i++) {
+    char spec[64];
+    snprintf(spec, sizeof(spec), "%s", viewSpecs[i]);
+    if (!sceneViewParse(&views[i], spec) ||
+        !sceneViewOpen(&views[i], target->renderer, false,
+                       KEY_COALESCE_DEFAULT_WINDOW, false, 0)) {
+      sceneViewClose(&views[i]);
+      while (i-- > 0) {
+        sceneViewClose(&views[i]);
+      }
+      return false;
+    }
+    if (views[i].layout.atlasSize > atlasSize) {
+      atlasSize = views[i].layout.atlasSize;
+    }
+  }
+  if (!labelCacheInit(&labelCache, target->renderer, atlasSize) ||
+      !useSoftwareComposite(target)) {
+    return false;
+  }
+
+  double ticksPerUs = SDL_GetPerformanceFrequency() / 1000000.0;
+  Uint32 seed = 12345;
+  Uint64 events = 0;
+  for (int frame = 0; frame < frameCount; frame++) {
+    Uint64 now = (Uint64)frame * 1000000 / BENCH_FPS;
+    Uint64 due = (Uint64)(frame + 1) * VIEWS_KEYS_PER_SEC / BENCH_FPS;
+    KeyEvent batch[VIEWS_KEYS_PER_SEC / BENCH_FPS + 1];
+    int batchCount = 0;
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    sceneClockSet(now);
+    for (; events < due; events++) {
+      KeySymbol symbol = steadyTyping(&seed, events);
+      processKeyPress(symbol);
+      keyEventInit(&batch[batchCount++], symbol, 0);
+    }
+    captureSceneSnapshot(&snapshot, now);
+    labelCacheBeginFrame(&labelCache);
+    renderScene(target->renderer, &snapshot, now);
+    headlessPresent(target);
+
+    Uint64 viewStart = SDL_GetPerformanceCounter();
+    for (int i = 0; i < viewCount; i++) {
+      sceneViewFeed(&views[i], batch, batchCount);
+      sceneViewStep(&views[i], now);
+      sceneViewRender(&views[i], now, true);
+    }
+    Uint64 end = SDL_GetPerformanceCounter();
+    frameTimes[frame] = end - start;
+    viewTimes[frame] = end - viewStart;
+  }
+
+  qsort(frameTimes, frameCount, sizeof(frameTimes[0]), compareU64);
+  qsort(viewTimes, frameCount, sizeof(viewTimes[0]), compareU64);
+  printf("{\"bench\":\"views\",\"views\":%d,\"keys_per_sec\":%d,"
+         "\"frames\":%d,\"frame_us_p50\":%.1f,\"frame_us_p99\":%.1f,"
+         "\"views_us_p50\":%.1f,\"views_us_p99\":%.1f,"
+         "\"label_misses\":%llu}\n",
+         viewCount, VIEWS_KEYS_PER_SEC, frameCount,
+         percentileUs(frameTimes, frameCount, 0.50, ticksPerUs),
+         percentileUs(frameTimes, frameCount, 0.99, ticksPerUs),
+         percentileUs(viewTimes, frameCount, 0.50, ticksPerUs),
+         percentileUs(viewTimes, frameCount, 0.99, ticksPerUs),
+         (unsigned long long)labelCache.misses);
+  fflush(stdout);
+
+  for (int i = 0; i < viewCount; i++) {
+    sceneViewClose(&views[i]);
+  }
+  destroyLineComposite(&lineComposite);
+  labelCacheDestroy(&labelCache);
+  return true;
+}
+
+int main(int argc, char *argv[]) {
+  double seconds = argc > 1 ? atof(argv[1]) : 10.0;
+  int frameCount = (int)(seconds * BENCH_FPS);
+  if (frameCount < 1) {
+    frameCount = 1;
+  }
+  if (frameCount > MAX_FRAMES) {
+    frameCount = MAX_FRAMES;
+  }
+
+  // Must be installed before SDL allocates anything
+  SDL_GetMemoryFunctions(&realMalloc, &realCalloc, &realRealloc, &realFree);
+  SDL_SetMemoryFunctions(countingMalloc, countingCalloc, countingRealloc,
+                         countingFree);
+
+  if (SDL_Init(SDL_INIT_EVENTS) < 0) {
+    fprintf(stderr, "SDL could not initialize! SDL_Error: %s\n",
+            SDL_GetError());
+    return 1;
+  }
+  if (TTF_Init() < 0) {
+    fprintf(stderr, "SDL_ttf could not initialize! TTF_Error: %s\n",
+            TTF_GetError());
+    SDL_Quit();
+    return 1;
+  }
+
+  HeadlessTarget target;
+  if (!headlessInit(&target, WINDOW_WIDTH, WINDOW_HEIGHT, NULL)) {
+    TTF_Quit();
+    SDL_Quit();
+    return 1;
+  }
+
+  int failed = !runBlendExact() || !runBlendBench(seconds) ||
+               !runStartupBench(&target, true) ||
+               !runStartupBench(&target, false);
+  for (size_t i = 0; i < sizeof(workloads) / sizeof(workloads[0]); i++) {
+    if (failed || !runWorkload(&workloads[i], &target, frameCount)) {
+      failed = 1;
+      break;
+    }
+  }
+  for (int count = 0; !failed && count <= VIEW_SPEC_COUNT; count++) {
+    failed = !runViews(&target, frameCount, count);
+  }
+
+  sceneFontsCloseAll();
+  headlessDestroy(&target);
+  TTF_Quit();
+  SDL_Quit();
+  return failed;
+}
@@ -0,0 +1,208 @@
+// Load generator for --listen and --listen-tcp (see src/net_keys.h). Types
+// synthetic prose at a fixed rate, in batches, and reports the rate it got
+// through and how long its writes were held up by backpressure.
+//
+// Usage: keycapper-producer [path | --tcp port] [keys/sec] [seconds] [batch]
+// (defaults: the default socket path, 1000 keys/sec, 10 seconds, batches of
+// up to 16 keys)
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../src/keysyms.h"
+#include "../src/net_keys.h"
+
+#define DEFAULT_BATCH 16
+
+static uint64_t monotonicNs(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+}
+
+static void sleepNs(uint64_t ns) {
+  struct timespec delay = {(time_t)(ns / 1000000000ull),
+                           (long)(ns % 1000000000ull)};
+  nanosleep(&delay, NULL);
+}
+
+static int connectUnix(const char *path) {
+  struct sockaddr_un address;
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  snprintf(address.sun_path, sizeof(address.sun_path), "%s", path);
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd >= 0 &&
+      connect(fd, (struct sockaddr *)&address, sizeof(address)) < 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+static int connectTcp(int port) {
+  struct sockaddr_in address;
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = htons((uint16_t)port);
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd >= 0 &&
+      connect(fd, (struct sockaddr *)&address, sizeof(address)) < 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+// Write all of size bytes, blocking while the reader is behind
+static int writeAll(int fd, const void *data, size_t size) {
+  const unsigned char *bytes = data;
+  while (size > 0) {
+    ssize_t written = write(fd, bytes, size);
+    if (written < 0 && errno == EINTR) {
+      continue;
+    }
+    if (written <= 0) {
+      return -1;
+    }
+    bytes += written;
+    size -= (size_t)written;
+  }
+  return 0;
+}
+
+// Prose-like typing: letters with the odd space, as in the benchmark
+static uint16_t nextSymbol(uint32_t *seed) {
+  *seed = *seed * 1664525u + 1013904223u;
+  uint32_t r = *seed >> 8;
+  if (r % 100 < 16) {
+    return KSYM_SPACE;
+  }
+  return (uint16_t)(KSYM_A + (r / 100) % 26);
+}
+
+int main(int argc, char *argv[]) {
+  const char *path = NET_KEYS_DEFAULT_PATH;
+  int port = 0;
+  int arg = 1;
+  if (arg < argc && strcmp(argv[arg], "--tcp") == 0 && arg + 1 < argc) {
+    port = atoi(argv[arg + 1]);
+    arg += 2;
+  } else if (arg < argc) {
+    path = argv[arg++];
+  }
+  double rate = arg < argc ? atof(argv[arg++]) : 1000.0;
+  double seconds = arg < argc ? atof(argv[arg++]) : 10.0;
+  int batch = arg < argc ? atoi(argv[arg++]) : DEFAULT_BATCH;
+  if (rate <= 0 || seconds <= 0) {
+    printf("keys/sec and seconds must be positive\n");
+    return 1;
+  }
+  if (batch < 1) {
+    batch = 1;
+  }
+  if (batch > NET_KEYS_MAX_BATCH) {
+    batch = NET_KEYS_MAX_BATCH;
+  }
+
+  // A closed connection should end the run with a message, not a signal
+  signal(SIGPIPE, SIG_IGN);
+
+  int fd = port > 0 ? connectTcp(port) : connectUnix(path);
+  if (fd < 0) {
+    if (port > 0) {
+      printf("Failed to connect to 127.0.0.1:%d (is keycapper running with "
+             "--listen-tcp?)\n",
+             port);
+    } else {
+      printf("Failed to connect to %s (is keycapper running with "
+             "--listen?)\n",
+             path);
+    }
+    return 1;
+  }
+
+  NetKeysHello hello = {SDL_SwapLE32(NET_KEYS_MAGIC),
+                        SDL_SwapLE16(NET_KEYS_VERSION),
+                        SDL_SwapLE16(sizeof(NetKeysRecord))};
+  if (writeAll(fd, &hello, sizeof(hello)) < 0) {
+    printf("Connection closed before the first batch\n");
+    return 1;
+  }
+
+  // One batch header followed by its records, sent in a single write
+  struct {
+    NetKeysBatchHeader header;
+    NetKeysRecord records[NET_KEYS_MAX_BATCH];
+  } message;
+
+  uint64_t total = (uint64_t)(rate * seconds);
+  uint64_t nsPerKey = rate < 1e9 ? (uint64_t)(1e9 / rate) : 1;
+  uint64_t start = monotonicNs();
+  uint64_t sent = 0;
+  uint64_t batches = 0;
+  uint64_t blockedNs = 0;
+  uint64_t worstWriteNs = 0;
+  uint32_t seed = 12345;
+
+  while (sent < total) {
+    uint64_t now = monotonicNs();
+    uint64_t due = (now - start) / nsPerKey + 1;
+    if (due > total) {
+      due = total;
+    }
+    if (due <= sent) {
+      // Wait for the next key to be due
+      sleepNs(start + sent * nsPerKey - now);
+      continue;
+    }
+
+    int count = due - sent > (uint64_t)batch ? batch : (int)(due - sent);
+    message.header.count = SDL_SwapLE16((uint16_t)count);
+    message.header.reserved = 0;
+    for (int i = 0; i < count; i++) {
+      // Age from when the key was due, so falling behind shows up as latency
+      uint64_t dueAt = start + (sent + i) * nsPerKey;
+      uint64_t ageUs = now > dueAt ? (now - dueAt) / 1000 : 0;
+      message.records[i].ageUs =
+          SDL_SwapLE32(ageUs > UINT32_MAX ? UINT32_MAX : (uint32_t)ageUs);
+      message.records[i].symbol = SDL_SwapLE16(nextSymbol(&seed));
+      message.records[i].flags = 0;
+    }
+
+    size_t size = sizeof(message.header) + count * sizeof(NetKeysRecord);
+    uint64_t writeStart = monotonicNs();
+    if (writeAll(fd, &message, size) < 0) {
+      printf("Connection closed after %llu keys\n", (unsigned long long)sent);
+      break;
+    }
+    uint64_t writeNs = monotonicNs() - writeStart;
+    blockedNs += writeNs;
+    if (writeNs > worstWriteNs) {
+      worstWriteNs = writeNs;
+    }
+    sent += count;
+    batches++;
+  }
+  close(fd);
+
+  double elapsed = (monotonicNs() - start) / 1e9;
+  printf("Sent %llu keys in %llu batches over %.2f s (%.0f keys/sec, target "
+         "%.0f)\n",
+         (unsigned long long)sent, (unsigned long long)batches, elapsed,
+         elapsed > 0 ? sent / elapsed : 0.0, rate);
+  printf("Blocked in write: %.1f ms total, %.2f ms worst\n", blockedNs / 1e6,
+         worstWriteNs / 1e6);
+  return sent == total ? 0 : 1;
+}
@@ -0,0 +1,153 @@
+// Reference reader for the shared-memory frame ring (see src/shm_frames.h).
+// Follows the newest frame, validates the seqlock and frame numbering, and
+// reports publish-to-read latency.
+//
+// Usage: keycapper-shm-reader [name] [seconds]
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../src/shm_frames.h"
+
+#define MAX_SAMPLES 100000
+
+static uint64_t monotonicNs(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+}
+
+static int compareU64(const void *a, const void *b) {
+  uint64_t x = *(const uint64_t *)a;
+  uint64_t y = *(const uint64_t *)b;
+  return x < y ? -1 : x > y;
+}
+
+static uint64_t latencies[MAX_SAMPLES];
+
+int main(int argc, char *argv[]) {
+  const char *name = argc > 1 ? argv[1] : SHM_FRAMES_DEFAULT_NAME;
+  double seconds = argc > 2 ? atof(argv[2]) : 10.0;
+
+  int fd = shm_open(name, O_RDONLY, 0);
+  if (fd < 0) {
+    printf("Failed to open shared memory %s (is keycapper running with "
+           "--shm-out?)\n",
+           name);
+    return 1;
+  }
+  struct stat info;
+  if (fstat(fd, &info) < 0 || (size_t)info.st_size < sizeof(ShmFrameHeader)) {
+    printf("Shared memory %s is too small\n", name);
+    return 1;
+  }
+  const unsigned char *base =
+      mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  if (base == MAP_FAILED) {
+    printf("Failed to map shared memory %s\n", name);
+    return 1;
+  }
+
+  const ShmFrameHeader *header = (const ShmFrameHeader *)base;
+  if (__atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) != SHM_FRAMES_MAGIC ||
+      header->version != SHM_FRAMES_VERSION) {
+    printf("Shared memory %s has an unknown layout\n", name);
+    return 1;
+  }
+  if (header->slotOffset + header->slotSize * header->slotCount >
+      (uint64_t)info.st_size) {
+    printf("Shared memory %s is smaller than its header claims\n", name);
+    return 1;
+  }
+  printf("Reading %ux%u frames from %s (%u slots)\n", header->width,
+         header->height, name, header->slotCount);
+
+  uint64_t framesRead = 0;
+  uint64_t framesSkipped = 0;
+  uint64_t tornReads = 0;
+  uint64_t errors = 0;
+  uint64_t lastFrame = 0;
+  int samples = 0;
+  uint64_t deadline = monotonicNs() + (uint64_t)(seconds * 1e9);
+
+  while (monotonicNs() < deadline) {
+    uint64_t latest = __atomic_load_n(&header->latestFrame, __ATOMIC_ACQUIRE);
+    if (latest == 0 || (framesRead > 0 && latest - 1 <= lastFrame)) {
+      // Nothing new yet
+      struct timespec nap = {0, 100000};
+      nanosleep(&nap, NULL);
+      continue;
+    }
+
+    uint64_t frameNumber = latest - 1;
+    const unsigned char *slot =
+        base + header->slotOffset +
+        header->slotSize * (frameNumber % header->slotCount);
+    const ShmSlotHeader *slotHeader = (const ShmSlotHeader *)slot;
+    const unsigned char *pixels = slot + sizeof(ShmSlotHeader);
+
+    // Read side of the seqlock; the frame is used in place, without a copy
+    uint64_t before = __atomic_load_n(&slotHeader->sequence, __ATOMIC_ACQUIRE);
+    uint64_t slotFrame = slotHeader->frameNumber;
+    uint64_t published = slotHeader->publishTimeNs;
+    volatile uint32_t checksum = 0;
+    for (uint32_t y = 0; y < header->height; y += 16) {
+      checksum += pixels[(size_t)y * header->stride];
+    }
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    uint64_t after = __atomic_load_n(&slotHeader->sequence, __ATOMIC_RELAXED);
+
+    if ((before & 1) || before != after) {
+      tornReads++;
+      continue;
+    }
+    if (slotFrame != frameNumber) {
+      // The writer already lapped this slot; try again with the new latest
+      tornReads++;
+      continue;
+    }
+    uint64_t readTime = monotonicNs();
+
+    // Each slot is written once every slotCount frames, two ticks a time
+    uint64_t expected = 2 * (frameNumber / header->slotCount + 1);
+    if (after != expected) {
+      printf("Frame %llu: slot sequence %llu, expected %llu\n",
+             (unsigned long long)frameNumber, (unsigned long long)after,
+             (unsigned long long)expected);
+      errors++;
+    }
+    if (framesRead > 0) {
+      framesSkipped += frameNumber - lastFrame - 1;
+    }
+    lastFrame = frameNumber;
+    framesRead++;
+
+    if (samples < MAX_SAMPLES && readTime >= published) {
+      latencies[samples++] = readTime - published;
+    }
+  }
+
+  printf("Frames read: %llu, skipped: %llu, torn reads retried: %llu, "
+         "errors: %llu\n",
+         (unsigned long long)framesRead, (unsigned long long)framesSkipped,
+         (unsigned long long)tornReads, (unsigned long long)errors);
+  if (samples > 0) {
+    qsort(latencies, samples, sizeof(latencies[0]), compareU64);
+    printf("Publish-to-read latency: p50 %.1f us, p99 %.1f us, max %.1f us\n",
+           latencies[samples / 2] / 1000.0,
+           latencies[(samples * 99) / 100] / 1000.0,
+           latencies[samples - 1] / 1000.0);
+  }
+
+  munmap((void *)base, (size_t)info.st_size);
+  close(fd);
+  return errors > 0 ? 1 : 0;
+}
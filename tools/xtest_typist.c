@@ -0,0 +1,123 @@
+// Load generator for XInput2 capture (--capture x11). Types synthetic prose
+// into the X display named by DISPLAY with XTest at a fixed rate, the same
+// way xdotool does, and reports the rate it got through. Compare with the
+// key presses keycapper reports on exit. Meant for Xvfb: the keys go to
+// whatever window has focus.
+//
+// Usage: keycapper-xtest [keys/sec] [seconds] [wheel]
+// (defaults: 1000 keys/sec, 10 seconds; "wheel" scrolls down instead of
+// typing)
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <X11/Xlib.h>
+#include <X11/extensions/XTest.h>
+#include <X11/keysym.h>
+
+#define WHEEL_DOWN_BUTTON 5
+
+static uint64_t monotonicNs(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+}
+
+static void sleepNs(uint64_t ns) {
+  struct timespec delay = {(time_t)(ns / 1000000000ull),
+                           (long)(ns % 1000000000ull)};
+  nanosleep(&delay, NULL);
+}
+
+// Prose-like typing: letters with the odd space, as in the benchmark
+static KeySym nextKeysym(uint32_t *seed) {
+  *seed = *seed * 1664525u + 1013904223u;
+  uint32_t r = *seed >> 8;
+  if (r % 100 < 16) {
+    return XK_space;
+  }
+  return XK_a + (r / 100) % 26;
+}
+
+int main(int argc, char *argv[]) {
+  double rate = argc > 1 ? atof(argv[1]) : 1000.0;
+  double seconds = argc > 2 ? atof(argv[2]) : 10.0;
+  int wheel = argc > 3 && strcmp(argv[3], "wheel") == 0;
+  if (rate <= 0 || seconds <= 0) {
+    printf("keys/sec and seconds must be positive\n");
+    return 1;
+  }
+
+  Display *display = XOpenDisplay(NULL);
+  if (!display) {
+    printf("Failed to open the X display (is DISPLAY set?)\n");
+    return 1;
+  }
+  int event;
+  int error;
+  int major;
+  int minor;
+  if (!XTestQueryExtension(display, &event, &error, &major, &minor)) {
+    printf("The X server has no XTest extension\n");
+    XCloseDisplay(display);
+    return 1;
+  }
+
+  // Keycodes for every keysym typed, looked up once
+  KeyCode letters[26];
+  for (int i = 0; i < 26; i++) {
+    letters[i] = XKeysymToKeycode(display, XK_a + i);
+  }
+  KeyCode space = XKeysymToKeycode(display, XK_space);
+
+  uint64_t total = (uint64_t)(rate * seconds);
+  uint64_t nsPerKey = rate < 1e9 ? (uint64_t)(1e9 / rate) : 1;
+  uint64_t start = monotonicNs();
+  uint64_t sent = 0;
+  uint64_t flushes = 0;
+  uint32_t seed = 12345;
+
+  while (sent < total) {
+    uint64_t now = monotonicNs();
+    uint64_t due = (now - start) / nsPerKey + 1;
+    if (due > total) {
+      due = total;
+    }
+    if (due <= sent) {
+      // Wait for the next key to be due
+      sleepNs(start + sent * nsPerKey - now);
+      continue;
+    }
+
+    // Queue every key that is due, then send them in one write
+    for (; sent < due; sent++) {
+      if (wheel) {
+        XTestFakeButtonEvent(display, WHEEL_DOWN_BUTTON, True, CurrentTime);
+        XTestFakeButtonEvent(display, WHEEL_DOWN_BUTTON, False, CurrentTime);
+        continue;
+      }
+      KeySym keysym = nextKeysym(&seed);
+      KeyCode code = keysym == XK_space ? space : letters[keysym - XK_a];
+      XTestFakeKeyEvent(display, code, True, CurrentTime);
+      XTestFakeKeyEvent(display, code, False, CurrentTime);
+    }
+    XFlush(display);
+    flushes++;
+  }
+  // Wait for the server to have handled every key before timing the run
+  XSync(display, False);
+  XCloseDisplay(display);
+
+  double elapsed = (monotonicNs() - start) / 1e9;
+  printf("Sent %llu %s in %llu flushes over %.2f s (%.0f/sec, target "
+         "%.0f)\n",
+         (unsigned long long)sent, wheel ? "wheel steps" : "keys",
+         (unsigned long long)flushes, elapsed,
+         elapsed > 0 ? sent / elapsed : 0.0, rate);
+  return 0;
+}